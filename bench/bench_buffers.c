@@ -0,0 +1,142 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+ * Measures finding a buffer by name, as done several times for every
+ * incoming line, against the linear walk of the buffer list it replaced.
+ *
+ * Usage: bench_buffers [buffers] [lookups]
+ *
+ * Buffers are channels and queries on one network. Lookups use names in
+ * random case, so each one also checks that the casemapping is honoured.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <buffer.h>
+#include <casemap.h>
+#include <irc.h>
+
+#define DEFAULT_BUFFERS 1000
+#define DEFAULT_LOOKUPS 2000000
+#define NAME_MAX_LEN 32
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * The lookup as it was before the index: a case-sensitive walk of the list.
+ */
+static buffer_node_t* walk_buffers(Irc *irc, const char *name) {
+    buffer_node_t *current = buffer_list_head;
+    do {
+        if (current->irc == irc && strcmp(current->name, name) == 0) {
+            return current;
+        }
+        current = current->next;
+    } while (current != buffer_list_head);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int buffer_total = argc > 1 ? atoi(argv[1]) : DEFAULT_BUFFERS;
+    int lookups = argc > 2 ? atoi(argv[2]) : DEFAULT_LOOKUPS;
+    Irc *irc = (Irc *)calloc(1, sizeof(Irc));
+    char (*names)[NAME_MAX_LEN] = malloc((size_t)(buffer_total > 0 ? buffer_total : 1) * NAME_MAX_LEN);
+    int *order = malloc((size_t)(lookups > 0 ? lookups : 1) * sizeof(int));
+    if (!irc || !names || !order || buffer_total <= 0 || lookups <= 0) {
+        fprintf(stderr, "Failed to set up %d buffers\n", buffer_total);
+        return 1;
+    }
+    irc->isupport.casemapping = CASEMAP_RFC1459;
+
+    // The client-wide status buffer comes first, as in the client
+    add_buffer(create_buffer(NULL, "status"));
+    srand(42);
+    for (int i = 0; i < buffer_total; i++) {
+        snprintf(names[i], NAME_MAX_LEN, "%s%d[%c]", i % 4 == 0 ? "nick" : "#channel", i, 'a' + rand() % 26);
+        add_buffer(create_buffer(irc, names[i]));
+    }
+    for (int i = 0; i < lookups; i++) {
+        order[i] = rand() % buffer_total;
+    }
+    printf("%d buffers, %d lookups\n", buffer_total, lookups);
+
+    // Look each name up in random case and check the right buffer comes back
+    const unsigned char *upper = (const unsigned char *)"ABCDEFGHIJKLMNOPQRSTUVWXYZ[]";
+    for (int i = 0; i < buffer_total; i++) {
+        char mixed[NAME_MAX_LEN];
+        for (int j = 0; ; j++) {
+            unsigned char c = (unsigned char)names[i][j];
+            const char *lower = c ? strchr("abcdefghijklmnopqrstuvwxyz{}", c) : NULL;
+            mixed[j] = lower && rand() % 2 ? (char)upper[lower - "abcdefghijklmnopqrstuvwxyz{}"] : (char)c;
+            if (!c) {
+                break;
+            }
+        }
+        buffer_node_t *found = get_buffer_by_name(irc, mixed);
+        if (!found || strcmp(found->name, names[i]) != 0 || get_buffer_by_name(NULL, names[i])) {
+            printf("MISMATCH: %s found %s\n", mixed, found ? found->name : "nothing");
+            return 1;
+        }
+    }
+
+    int hits = 0;
+    double start = now_seconds();
+    for (int i = 0; i < lookups; i++) {
+        hits += get_buffer_by_name(irc, names[order[i]]) != NULL;
+    }
+    double indexed = now_seconds() - start;
+
+    // The walk is slow at scale, so time a share of the lookups
+    int walks = lookups / 16 > 0 ? lookups / 16 : 1;
+    start = now_seconds();
+    for (int i = 0; i < walks; i++) {
+        hits += walk_buffers(irc, names[order[i]]) != NULL;
+    }
+    double walked = now_seconds() - start;
+    if (hits != lookups + walks) {
+        printf("MISMATCH: %d of %d lookups found their buffer\n", hits, lookups + walks);
+        return 1;
+    }
+
+    printf("index   %8.1f ns/lookup\n", indexed / lookups * 1e9);
+    printf("walk    %8.1f ns/lookup\n", walked / walks * 1e9);
+
+    // Removing every other buffer must leave the rest findable
+    for (int i = 0; i < buffer_total; i += 2) {
+        remove_buffer(get_buffer_by_name(irc, names[i]));
+    }
+    for (int i = 0; i < buffer_total; i++) {
+        if ((get_buffer_by_name(irc, names[i]) != NULL) != (i % 2 == 1)) {
+            printf("MISMATCH: %s after removing half\n", names[i]);
+            return 1;
+        }
+    }
+
+    buffer_list_free();
+    free(order);
+    free(names);
+    free(irc);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures line framing throughput for each scanner, through the same
+ * receive ring (linebuf) and limits that irc_process_buffer() uses.
+ *
+ * Usage: bench_linescan [capture-file]
+ *
+ * The capture is raw server output as received, e.g. saved with
+ * "openssl s_client -quiet -connect irc.libera.chat:6697 > capture.txt"
+ * while joined to busy channels. Without one, a synthetic capture with the
+ * line length mix of a busy channel is generated.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <irc.h>
+#include <linebuf.h>
+#include <linescan.h>
+
+#define SYNTHETIC_SIZE (64 * 1024 * 1024)
+#define MIN_BENCH_BYTES (512ULL * 1024 * 1024)
+
+static const char *scanners[] = {"scalar", "memchr", "sse2", "avx2"};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* load_file(const char *path, size_t *len) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = (char *)malloc(size > 0 ? (size_t)size : 1);
+    if (data && fread(data, 1, (size_t)size, file) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *len = (size_t)size;
+    return data;
+}
+
+/**
+ * Mostly PRIVMSG of varying length, some with IRCv3 tags, plus JOIN/PART/
+ * QUIT noise; a few lines end in a bare LF as some bouncers send them.
+ */
+static char* synthesize(size_t *len) {
+    char *data = (char *)malloc(SYNTHETIC_SIZE);
+    if (!data) {
+        return NULL;
+    }
+    srand(42);
+    size_t pos = 0;
+    char line[1024];
+    while (1) {
+        int kind = rand() % 100;
+        int n;
+        if (kind < 70) {
+            char text[512];
+            int text_len = 10 + rand() % 300;
+            for (int i = 0; i < text_len; i++) {
+                text[i] = (char)('a' + rand() % 26);
+                if (rand() % 6 == 0) text[i] = ' ';
+            }
+            text[text_len] = '\0';
+            if (kind < 20) {
+                n = snprintf(line, sizeof(line), "@time=2025-01-01T12:00:00.000Z;msgid=%08x :nick%d!~user@host.example PRIVMSG #busy :%s",
+                             (unsigned int)rand(), rand() % 500, text);
+            } else {
+                n = snprintf(line, sizeof(line), ":nick%d!~user@host.example PRIVMSG #busy :%s", rand() % 500, text);
+            }
+        } else if (kind < 85) {
+            n = snprintf(line, sizeof(line), ":nick%d!~user@192.0.2.%d JOIN #busy", rand() % 500, rand() % 255);
+        } else if (kind < 95) {
+            n = snprintf(line, sizeof(line), ":nick%d!~user@192.0.2.%d QUIT :Ping timeout: 240 seconds", rand() % 500,
+                         rand() % 255);
+        } else {
+            n = snprintf(line, sizeof(line), "PING :server.example");
+        }
+        const char *ending = rand() % 50 == 0 ? "\n" : "\r\n";
+        size_t ending_len = strlen(ending);
+        if (pos + (size_t)n + ending_len > SYNTHETIC_SIZE) {
+            break;
+        }
+        memcpy(data + pos, line, (size_t)n);
+        memcpy(data + pos + n, ending, ending_len);
+        pos += (size_t)n + ending_len;
+    }
+    *len = pos;
+    return data;
+}
+
+int main(int argc, char *argv[]) {
+    size_t len = 0;
+    char *data = argc > 1 ? load_file(argv[1], &len) : synthesize(&len);
+    if (!data || len == 0) {
+        fprintf(stderr, "Failed to load %s\n", argc > 1 ? argv[1] : "synthetic capture");
+        return 1;
+    }
+
+    int passes = (int)(MIN_BENCH_BYTES / len) + 1;
+    printf("capture: %s, %zu bytes, %d passes\n", argc > 1 ? argv[1] : "synthetic", len, passes);
+
+    linebuf_t lb;
+    if (linebuf_init(&lb, IRC_RECV_BUFFER_SIZE, IRC_MAX_LINE_LEN) != 0) {
+        fprintf(stderr, "Failed to allocate the receive ring\n");
+        free(data);
+        return 1;
+    }
+
+    size_t expected_lines = 0;
+    for (size_t i = 0; i < sizeof(scanners) / sizeof(scanners[0]); i++) {
+        if (linescan_select(scanners[i]) != 0) {
+            printf("%-8s unsupported on this CPU\n", scanners[i]);
+            continue;
+        }
+
+        size_t lines = 0;
+        size_t checksum = 0;
+        double start = now_seconds();
+        for (int pass = 0; pass < passes; pass++) {
+            linebuf_reset(&lb);
+            size_t pos = 0;
+            while (pos < len) {
+                // Stand-in for recv()/SSL_read() into the free part of the ring
+                size_t avail;
+                char *dest = linebuf_write_ptr(&lb, &avail);
+                size_t chunk = len - pos < avail ? len - pos : avail;
+                memcpy(dest, data + pos, chunk);
+                linebuf_commit(&lb, chunk);
+                pos += chunk;
+
+                char *line;
+                size_t line_len;
+                while ((line = linebuf_next_line(&lb, &line_len)) != NULL) {
+                    checksum += line_len;
+                    lines++;
+                }
+            }
+        }
+        double elapsed = now_seconds() - start;
+
+        size_t lines_per_pass = lines / (size_t)passes;
+        if (expected_lines == 0) {
+            expected_lines = lines_per_pass;
+        } else if (lines_per_pass != expected_lines) {
+            printf("%-8s MISMATCH: %zu lines, expected %zu\n", scanners[i], lines_per_pass, expected_lines);
+            return 1;
+        }
+        double bytes = (double)len * passes;
+        printf("%-8s %8.2f GB/s %8.1f Mlines/s (%zu lines per pass, checksum %zu)\n", scanners[i],
+               bytes / elapsed / 1e9, lines / elapsed / 1e6, lines_per_pass, checksum);
+    }
+
+    linebuf_free(&lb);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures joining a large channel: parsing its RPL_NAMREPLY (353) lines,
+ * staging every name and committing the list on RPL_ENDOFNAMES (366).
+ *
+ * Usage: bench_names [members] [rounds]
+ *
+ * Each round starts from an empty member table, as on a fresh JOIN, and
+ * then lists the same channel again, as for a repeated /names. The first
+ * is the join-to-usable time; the second mostly finds existing users.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <irc_message.h>
+#include <members.h>
+
+#define DEFAULT_MEMBERS 50000
+#define DEFAULT_ROUNDS 20
+#define NAMES_LINE_MAX 510
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Packs members into 353 lines the way servers do: "@" for about 1% of
+ * them, "+" for about 5%, nicks of 3 to 15 characters.
+ */
+static char* synthesize(int members, size_t *len, int *lines) {
+    size_t capacity = (size_t)members * 24 + 4096;
+    char *data = (char *)malloc(capacity);
+    if (!data) {
+        return NULL;
+    }
+    srand(42);
+    size_t pos = 0;
+    int line_start = -1;
+    *lines = 0;
+    for (int i = 0; i < members; i++) {
+        char nick[32];
+        int nick_len = 3 + rand() % 13;
+        int n = snprintf(nick, sizeof(nick), "%s%d", rand() % 100 == 0 ? "@" : rand() % 20 == 0 ? "+" : "", i);
+        while (n < nick_len) {
+            nick[n++] = "abcdefghijklmnopqrstuvwxyz_[]"[rand() % 29];
+        }
+        nick[n] = '\0';
+        if (line_start >= 0 && pos - (size_t)line_start + 1 + (size_t)n > NAMES_LINE_MAX) {
+            data[pos++] = '\n';
+            line_start = -1;
+        }
+        if (line_start < 0) {
+            line_start = (int)pos;
+            pos += (size_t)sprintf(data + pos, ":irc.example.net 353 me = #big :%s", nick);
+            (*lines)++;
+        } else {
+            pos += (size_t)sprintf(data + pos, " %s", nick);
+        }
+    }
+    data[pos++] = '\n';
+    *len = pos;
+    return data;
+}
+
+/**
+ * Feeds every line through the parser and the member table.
+ * @return The member count after the commit.
+ */
+static int list_channel(members_t *members, member_channel_t *channel, const char *data, size_t len) {
+    const char *p = data;
+    const char *end = data + len;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        irc_message_t msg;
+        if (irc_message_parse(p, eol - p, &msg) == 0 && msg.param_count == 4) {
+            members_stage_names(members, channel, msg.params[3].ptr, msg.params[3].len, "@+");
+        }
+        p = eol + 1;
+    }
+    members_commit(members, channel);
+    return channel->members.count;
+}
+
+int main(int argc, char *argv[]) {
+    int member_count = argc > 1 ? atoi(argv[1]) : DEFAULT_MEMBERS;
+    int rounds = argc > 2 ? atoi(argv[2]) : DEFAULT_ROUNDS;
+    size_t len;
+    int lines;
+    char *data = synthesize(member_count, &len, &lines);
+    if (!data || rounds <= 0) {
+        fprintf(stderr, "Failed to build the NAMES list\n");
+        return 1;
+    }
+    printf("channel: %d members in %d lines (%zu bytes), %d rounds\n", member_count, lines, len, rounds);
+
+    double join_total = 0, join_best = 1e9, relist_total = 0, relist_best = 1e9, part_total = 0;
+    for (int round = 0; round < rounds; round++) {
+        intern_pool_t names;
+        intern_init(&names, CASEMAP_RFC1459);
+        members_t members;
+        members_init(&members, &names);
+        member_channel_t *channel = members_add_channel(&members, "#big", 4);
+        members_join(&members, channel, "me", 2);
+
+        double start = now_seconds();
+        int listed = list_channel(&members, channel, data, len);
+        double joined = now_seconds();
+        int relisted = list_channel(&members, channel, data, len);
+        double relisted_at = now_seconds();
+        members_remove_channel(&members, channel);
+        double parted = now_seconds();
+
+        if (listed != member_count || relisted != listed || members.user_count != 0 || names.live != 0) {
+            printf("MISMATCH: listed %d, relisted %d, %d users and %d names left\n", listed, relisted,
+                   members.user_count, names.live);
+            return 1;
+        }
+        join_total += joined - start;
+        relist_total += relisted_at - joined;
+        part_total += parted - relisted_at;
+        if (joined - start < join_best) join_best = joined - start;
+        if (relisted_at - joined < relist_best) relist_best = relisted_at - joined;
+        members_clear(&members);
+        intern_clear(&names);
+    }
+
+    printf("join    %7.3f ms avg %7.3f ms best %6.1f ns/member\n", join_total / rounds * 1e3, join_best * 1e3,
+           join_best / member_count * 1e9);
+    printf("relist  %7.3f ms avg %7.3f ms best %6.1f ns/member\n", relist_total / rounds * 1e3, relist_best * 1e3,
+           relist_best / member_count * 1e9);
+    printf("part    %7.3f ms avg\n", part_total / rounds * 1e3);
+
+    free(data);
+    return 0;
+}
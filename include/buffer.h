@@ -20,15 +20,22 @@
 
 #include <stdbool.h>
 
+struct Irc;
+
 // Proposed for a new buffer.h header
 typedef struct buffer_node {
     char *name;                 // e.g., "status", "#channel", "user"
+    struct Irc *irc;            // Owning network, or NULL for client-wide buffers
     char **lines;               // Dynamically allocated array of strings for buffer content
+    long long *times;           // Wall-clock time of each line, ms since the epoch
     int line_count;             // Number of lines in the buffer
     int capacity;               // Current capacity of the lines array
     int active;                 // Flag (1 for active, 0 for inactive)
     int scroll_offset;          // Scroll offset for this buffer
     bool at_bottom;             // True if scrolled to the bottom
+    bool history_pending;       // Older history has been requested from the server
+    bool history_complete;      // The server has nothing older to send
+    unsigned int name_hash;     // Key in the name index, set by add_buffer()
     struct buffer_node *prev;
     struct buffer_node *next;
 } buffer_node_t;
@@ -39,12 +46,18 @@ extern buffer_node_t *active_buffer;
 
 // Buffer management functions
 void buffer_list_init(void);
-buffer_node_t* create_buffer(const char *name);
+buffer_node_t* create_buffer(struct Irc *irc, const char *name);
 void add_buffer(buffer_node_t *buffer);
 void buffer_append_message(buffer_node_t *buffer, const char *message);
-buffer_node_t* get_buffer_by_name(const char *name);
+void buffer_insert_message(buffer_node_t *buffer, const char *message, long long time_ms);
+void buffer_set_wrap_width(int width);
+const char* buffer_wrap_row(const char *line, int width, int *row_len);
+int buffer_line_rows(const char *line);
+buffer_node_t* get_buffer_by_name(struct Irc *irc, const char *name);
+void buffer_reindex(void);
 void set_active_buffer(buffer_node_t *buffer);
 void buffer_free(buffer_node_t *buffer);
 void remove_buffer(buffer_node_t *buffer);
+void buffer_list_free(void);
 
 #endif // BUFFER_H
\ No newline at end of file
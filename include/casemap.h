@@ -0,0 +1,61 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef CASEMAP_H
+#define CASEMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief How a server compares nick and channel names (ISUPPORT CASEMAPPING).
+ */
+typedef enum {
+    CASEMAP_RFC1459,        // A-Z plus []\~ fold to a-z plus {}|^ (the IRC default)
+    CASEMAP_STRICT_RFC1459, // As rfc1459, but ~ and ^ are distinct
+    CASEMAP_ASCII           // Only A-Z fold
+} casemap_t;
+
+/**
+ * @brief Looks up a CASEMAPPING token. Unknown mappings fall back to rfc1459.
+ */
+casemap_t casemap_from_name(const char *name, size_t len);
+
+const char* casemap_name(casemap_t map);
+
+/**
+ * @brief Returns the 256-entry table mapping each byte to its lower-case
+ * form under the mapping, for loops that fold many bytes.
+ */
+const unsigned char* casemap_table(casemap_t map);
+
+/**
+ * @brief Folds one byte to its lower-case form under the mapping.
+ */
+unsigned char casemap_fold(casemap_t map, unsigned char c);
+
+/**
+ * @brief Compares a length-delimited name with a NUL-terminated one.
+ */
+bool casemap_equals(casemap_t map, const char *a, size_t a_len, const char *b);
+
+/**
+ * @brief Hashes a name so that names equal under the mapping hash equally.
+ */
+unsigned int casemap_hash(casemap_t map, const char *s, size_t len);
+
+#endif // CASEMAP_H
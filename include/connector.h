@@ -0,0 +1,65 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef CONNECTOR_H
+#define CONNECTOR_H
+
+#include <netdb.h>
+#include <event_loop.h>
+#include <sockopt.h>
+
+// RFC 8305 recommends 250ms between staggered connection attempts
+#define CONNECTOR_ATTEMPT_DELAY_MS 250
+// Give up on the whole race after this long
+#define CONNECTOR_TIMEOUT_MS 30000
+
+typedef struct connector connector_t;
+
+/**
+ * @brief Called once when the race is decided.
+ * @param fd The connected non-blocking socket, or -1 if every attempt failed.
+ * @param data The opaque pointer given to connector_start().
+ */
+typedef void (*connector_cb)(int fd, void *data);
+
+/**
+ * @brief Starts a non-blocking Happy Eyeballs (RFC 8305) connection race.
+ *
+ * Candidates are interleaved by address family, starting with the family of
+ * the first result, and a new attempt is started every
+ * CONNECTOR_ATTEMPT_DELAY_MS (or immediately when one fails) until one
+ * succeeds. The callback is always invoked from the event loop, never from
+ * within this function, and the connector frees itself afterwards.
+ *
+ * @param loop The event loop driving the attempts.
+ * @param addrs The getaddrinfo() results to race. They are copied.
+ * @param label A name for log messages, e.g. the host name.
+ * @param opts Options applied to every attempt's socket before connect(),
+ *             or NULL for the kernel defaults. They are copied.
+ * @param cb The completion callback.
+ * @param data Opaque pointer handed to the callback.
+ * @return The connector, or NULL if it could not be started.
+ */
+connector_t* connector_start(event_loop_t *loop, const struct addrinfo *addrs, const char *label,
+                             const sockopt_t *opts, connector_cb cb, void *data);
+
+/**
+ * @brief Aborts a pending race without invoking its callback.
+ */
+void connector_cancel(connector_t *conn);
+
+#endif // CONNECTOR_H
@@ -0,0 +1,97 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+// Interest/readiness flags for file descriptor watches
+#define EVENT_READ  0x1
+#define EVENT_WRITE 0x2
+#define EVENT_ERROR 0x4 // Only ever reported, never requested
+
+typedef struct event_loop event_loop_t;
+
+typedef void (*event_fd_cb)(event_loop_t *loop, int fd, int events, void *data);
+typedef void (*event_timer_cb)(event_loop_t *loop, void *data);
+
+/**
+ * @brief Creates a new epoll-backed event loop.
+ * @return The new loop, or NULL on failure.
+ */
+event_loop_t* event_loop_create(void);
+
+/**
+ * @brief Destroys an event loop. Registered fds are not closed.
+ * @param loop The loop to destroy.
+ */
+void event_loop_destroy(event_loop_t *loop);
+
+/**
+ * @brief Starts watching a file descriptor.
+ * @param loop The event loop.
+ * @param fd The file descriptor to watch.
+ * @param events A mask of EVENT_READ and/or EVENT_WRITE.
+ * @param cb The callback invoked when the fd becomes ready.
+ * @param data Opaque pointer handed back to the callback.
+ * @return 0 on success, -1 on failure.
+ */
+int event_loop_add_fd(event_loop_t *loop, int fd, int events, event_fd_cb cb, void *data);
+
+/**
+ * @brief Changes the interest mask of a watched file descriptor.
+ * @return 0 on success, -1 on failure.
+ */
+int event_loop_modify_fd(event_loop_t *loop, int fd, int events);
+
+/**
+ * @brief Stops watching a file descriptor. Safe to call from within a callback.
+ */
+void event_loop_remove_fd(event_loop_t *loop, int fd);
+
+/**
+ * @brief Schedules a timer callback.
+ * @param loop The event loop.
+ * @param delay_ms Milliseconds until the first expiry.
+ * @param interval_ms Repeat interval in milliseconds, or 0 for a one-shot timer.
+ * @param cb The callback invoked on expiry.
+ * @param data Opaque pointer handed back to the callback.
+ * @return A positive timer id, or -1 on failure.
+ */
+long event_loop_add_timer(event_loop_t *loop, long delay_ms, long interval_ms, event_timer_cb cb, void *data);
+
+/**
+ * @brief Cancels a pending timer. Unknown or already-fired ids are ignored.
+ */
+void event_loop_cancel_timer(event_loop_t *loop, long timer_id);
+
+/**
+ * @brief Waits for the next ready fd or due timer and dispatches callbacks.
+ *
+ * Returns early with 0 when interrupted by a signal so the caller can react
+ * to flags set by signal handlers. Timers added by a callback never fire in
+ * the same call, so a 0ms timer re-added every time yields to the fds.
+ *
+ * @return The number of callbacks dispatched, or -1 on failure.
+ */
+int event_loop_run_once(event_loop_t *loop);
+
+/**
+ * @brief Returns a monotonic timestamp in milliseconds.
+ */
+long long event_loop_now_ms(void);
+
+#endif // EVENT_LOOP_H
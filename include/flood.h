@@ -0,0 +1,87 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef FLOOD_H
+#define FLOOD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sendq.h>
+
+// Servers typically allow a short burst, then about one message every two
+// seconds before applying excess flood penalties.
+#define FLOOD_DEFAULT_BURST 5
+#define FLOOD_DEFAULT_INTERVAL_MS 2000
+
+typedef enum {
+    FLOOD_PRIORITY_URGENT,  // PONG, registration, QUIT: never held back
+    FLOOD_PRIORITY_NORMAL,  // Chat and everything else the user types
+    FLOOD_PRIORITY_BULK,    // WHO, WHOIS, MODE, NAMES, LIST and the like
+    FLOOD_PRIORITY_COUNT
+} flood_priority_t;
+
+typedef struct flood_msg flood_msg_t;
+
+/**
+ * @brief A token bucket in front of the send queue.
+ *
+ * Each released message costs one token and tokens refill at one per
+ * interval, up to burst. Urgent messages are released immediately but still
+ * spend tokens, as the server counts them too.
+ */
+typedef struct {
+    flood_msg_t *head[FLOOD_PRIORITY_COUNT];
+    flood_msg_t *tail[FLOOD_PRIORITY_COUNT];
+    int depth;              // Messages held back, all priorities
+    int burst;
+    long long interval_ms;  // 0 disables rate limiting
+    double tokens;
+    long long refilled_ms;  // When tokens were last brought up to date
+} flood_t;
+
+void flood_init(flood_t *flood, int burst, long long interval_ms);
+
+/**
+ * @brief Drops every held message and refills the bucket.
+ */
+void flood_clear(flood_t *flood);
+
+/**
+ * @brief Picks the priority class for one outgoing line by its command.
+ */
+flood_priority_t flood_classify(const char *line, size_t len);
+
+/**
+ * @brief Holds a copy of one line until the bucket allows it out.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int flood_push(flood_t *flood, flood_priority_t priority, const char *line, size_t len);
+
+/**
+ * @brief Moves every message the bucket allows into the send queue,
+ * highest priority first.
+ * @return The number of messages released, or -1 on allocation failure.
+ */
+int flood_release(flood_t *flood, sendq_t *out, long long now_ms);
+
+/**
+ * @brief Returns how long until the next held message may be released,
+ * or -1 if nothing is held.
+ */
+long long flood_next_release_ms(flood_t *flood, long long now_ms);
+
+#endif // FLOOD_H
@@ -0,0 +1,123 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <casemap.h>
+
+#define INTERN_MIN_CAPACITY 16
+
+/**
+ * @brief A small, stable handle for an interned name. 0 is never used.
+ */
+typedef uint32_t intern_id_t;
+
+typedef struct {
+    char *str;                      // NULL while the ID is free
+    unsigned int len;
+    unsigned int hash;
+    unsigned int refs;
+} intern_entry_t;
+
+typedef struct {
+    intern_id_t id;                 // 0 when the slot is free
+    unsigned int hash;
+} intern_slot_t;
+
+/**
+ * @brief Deduplicates the nicks, user@host strings and channel names of one
+ * connection, so each is stored once however often it is referenced.
+ *
+ * Names that are equal under the casemapping share one ID; the spelling
+ * kept is the one last given to intern_respell(), or the first seen. IDs
+ * are reused after release, so they stay small enough to index arrays.
+ */
+typedef struct {
+    casemap_t casemap;
+    intern_entry_t *entries;        // Indexed by ID
+    intern_id_t entry_count;        // Highest ID handed out, plus one
+    intern_id_t entry_capacity;
+    intern_id_t *free_ids;          // Released IDs, reused first
+    intern_id_t free_count;
+    intern_id_t free_capacity;
+    intern_slot_t *slots;           // Linear probing by hash
+    int slot_capacity;              // Power of two
+    int live;                       // Names currently interned
+} intern_pool_t;
+
+void intern_init(intern_pool_t *pool, casemap_t casemap);
+
+/**
+ * @brief Frees every name. Outstanding IDs become invalid.
+ */
+void intern_clear(intern_pool_t *pool);
+
+/**
+ * @brief Switches to the server's CASEMAPPING, rehashing every name.
+ */
+void intern_set_casemap(intern_pool_t *pool, casemap_t casemap);
+
+/**
+ * @brief Hashes a name for the *_hashed variants, which let a caller
+ * hash and prefetch many names before looking any of them up.
+ */
+unsigned int intern_hash(const intern_pool_t *pool, const char *s, size_t len);
+
+/**
+ * @brief Starts loading the table slot a hash maps to.
+ */
+void intern_prefetch(const intern_pool_t *pool, unsigned int hash);
+
+/**
+ * @brief Returns the ID of a name without taking a reference, or 0.
+ */
+intern_id_t intern_find(const intern_pool_t *pool, const char *s, size_t len);
+intern_id_t intern_find_hashed(const intern_pool_t *pool, const char *s, size_t len, unsigned int hash);
+
+/**
+ * @brief Returns the ID of a name, adding it if needed, and takes a reference.
+ * @return The ID, or 0 on allocation failure.
+ */
+intern_id_t intern_acquire(intern_pool_t *pool, const char *s, size_t len);
+intern_id_t intern_acquire_hashed(intern_pool_t *pool, const char *s, size_t len, unsigned int hash);
+
+/**
+ * @brief Takes another reference to an ID.
+ */
+void intern_retain(intern_pool_t *pool, intern_id_t id);
+
+/**
+ * @brief Drops a reference; the name is freed with its last one. 0 is ignored.
+ */
+void intern_release(intern_pool_t *pool, intern_id_t id);
+
+/**
+ * @brief Replaces the stored spelling with one equal under the casemapping,
+ * e.g. when someone changes nick from "bob" to "Bob".
+ */
+void intern_respell(intern_pool_t *pool, intern_id_t id, const char *s, size_t len);
+
+/**
+ * @brief Returns the name of an ID, or "" for 0.
+ */
+const char* intern_str(const intern_pool_t *pool, intern_id_t id);
+
+#endif // INTERN_H
@@ -20,35 +20,163 @@
 
 #include <openssl/ssl.h>
 #include <stdbool.h>
+#include <event_loop.h>
+#include <buffer.h>
+#include <sendq.h>
+#include <flood.h>
+#include <linebuf.h>
+#include <lag.h>
+#include <sockopt.h>
+#include <isupport.h>
+#include <members.h>
 
 typedef enum {
     IRC_STATE_DISCONNECTED,
     IRC_STATE_CONNECTING,
+    IRC_STATE_TLS_HANDSHAKE,
     IRC_STATE_CONNECTED,
+    IRC_STATE_CAP_NEGOTIATING,  // CAP LS sent; registration waits for CAP END
     IRC_STATE_REGISTERING,
     IRC_STATE_REGISTERED
 } IrcConnectionState;
 
+// IRCv3 allows 8191 bytes of message tags in front of the classic 512 byte
+// message, so no valid line is longer than this, CRLF included.
+#define IRC_MAX_LINE_LEN (8191 + 512)
+// Fixed receive ring per connection; must be a power of two above IRC_MAX_LINE_LEN
+#define IRC_RECV_BUFFER_SIZE 16384
+
+// Most bytes read from one connection per loop iteration before yielding
+#define IRC_READ_BUDGET 65536
+
+// Returned by irc_recv() when a non-blocking read has nothing to deliver yet
+#define IRC_IO_WOULD_BLOCK (-2)
+
+// Reconnect backoff: the delay doubles per failed attempt up to the maximum,
+// and a random part of it is spread out so networks do not retry in lockstep.
+#define IRC_RECONNECT_INITIAL_MS 1000
+#define IRC_RECONNECT_MAX_MS 120000
+
+// IRCv3 capabilities chatter requests when the server offers them
+typedef enum {
+    IRC_CAP_BATCH = 1 << 0,         // Related messages grouped by a "batch" tag
+    IRC_CAP_SERVER_TIME = 1 << 1,   // A "time" tag with when the server saw each message
+    IRC_CAP_MESSAGE_TAGS = 1 << 2,  // Client-only tags and msgid
+    IRC_CAP_ECHO_MESSAGE = 1 << 3,  // Our own PRIVMSG/NOTICE are echoed back
+    IRC_CAP_CHATHISTORY = 1 << 4,   // draft/chathistory: older messages on request
+    IRC_CAP_SASL = 1 << 5           // Authentication before registration completes
+} irc_cap_t;
+
+// Longest AUTHENTICATE payload line; longer responses are split
+#define IRC_SASL_CHUNK_SIZE 400
+
+// Messages asked for per CHATHISTORY request
+#define IRC_HISTORY_PAGE_SIZE 50
+
+// Batches that may be open at once; messages of any further batch are
+// applied one at a time as if they were not batched.
+#define IRC_MAX_OPEN_BATCHES 8
+
+typedef struct {
+    char ref[32];               // Reference tag chosen by the server
+    char type[32];              // e.g. "netsplit", "chathistory"
+    char params[128];           // Remaining BATCH parameters, space separated
+    int lines;                  // Messages received inside the batch
+    bool needs_refresh;         // Whether the batch touched the visible buffer
+} irc_batch_t;
+
+// Lag meter: a PING of our own goes out every interval once registered, and
+// a connection whose PONG is this late is treated as dead.
+#define IRC_PING_INTERVAL_MS 30000
+#define IRC_PING_TIMEOUT_MS 15000
+// Prefix of the PING tokens we send, followed by the monotonic send time
+#define IRC_PING_TOKEN_PREFIX "chatter-"
+
+typedef struct connector connector_t;
+typedef struct resolver_request resolver_request_t;
+
 typedef struct Irc {
+    char *network;              // Short name used to namespace this connection's buffers
     int sock;
     SSL *ssl;
-    SSL_CTX *ctx;
+    bool tls_verify;            // Verify the server certificate and host name
+    bool tls_session_offered;   // Whether a cached session was offered for resumption
     char *channel;
     char *nickname;
     char *server;
+    int port;
+    int use_ssl;
     char *username;
     char *realname;
-    char *recv_buffer;
-    size_t recv_buffer_len;
-    size_t recv_buffer_capacity;
+    linebuf_t recvq;            // Received bytes not yet parsed into lines
     IrcConnectionState state;
+    long long connect_started_ms;      // Monotonic time irc_connect() began
+    long long tls_started_ms;          // Monotonic time the TLS handshake began
+    long long registration_sent_ms;    // Monotonic time NICK/USER were written
+    event_loop_t *loop;         // Loop driving this connection
+    resolver_request_t *resolve_req; // Pending name lookup, if any
+    connector_t *connector;     // Pending connection race, if any
+    bool watching;              // Whether sock is registered with loop
+    sockopt_t sockopts;         // TCP options for every connection attempt
+    // SASL and client certificate settings. They are not owned and must
+    // outlive the connection.
+    const char *sasl_mechanism; // "PLAIN", "EXTERNAL", or NULL to skip SASL
+    const char *sasl_username;
+    const char *sasl_password;
+    const char *tls_cert_file;  // Client certificate presented during the handshake
+    const char *tls_key_file;   // Its private key, or NULL if in tls_cert_file
+    bool sasl_in_progress;      // AUTHENTICATE sent, no final numeric yet
+    bool auto_reconnect;        // Reconnect after an unexpected disconnect
+    int reconnect_attempts;     // Consecutive attempts since the last registration
+    long reconnect_timer;       // Pending reconnect, if any
+    int sessions;               // Successful registrations so far
+    bool joined;                // Channels have been (re)joined on this connection
+    isupport_t isupport;        // RPL_ISUPPORT of the current connection
+    intern_pool_t names;        // Nicks, user@host and channel names of this connection
+    members_t members;          // Who is in which of our channels
+    unsigned caps_available;    // irc_cap_t bits offered by the server
+    unsigned caps_enabled;      // irc_cap_t bits acknowledged by the server
+    irc_batch_t batches[IRC_MAX_OPEN_BATCHES];
+    int open_batches;
+    long long line_time_ms;     // server-time of the batched message being handled, or -1
+    flood_t flood;              // Messages held back by flood control
+    sendq_t sendq;              // Outbound data not yet accepted by the socket
+    long flush_timer;           // Pending release/flush of queued output, if any
+    long long flush_due_ms;     // When flush_timer fires
+    long drain_timer;           // Pending read of data TLS has buffered, if any
+    bool want_write;            // Whether the loop is watching for writability
+    long long ping_interval_ms; // 0 disables the lag meter
+    long long ping_timeout_ms;
+    long ping_timer;            // Repeating timer sending our PINGs
+    long ping_timeout_timer;    // Pending dead-connection check, if a PING is out
+    long long ping_sent_ms;     // Monotonic time of the unanswered PING, or 0
+    lag_t lag;                  // Round-trip times on the current connection
+    // Invoked after socket activity has been processed, so the UI can redraw
+    // once per wakeup and notice state changes such as a disconnect.
+    void (*notify)(struct Irc *irc, bool needs_refresh);
+    struct Irc *next;
 } Irc;
 
+// Global list of configured networks, in the order they were added
+extern Irc *irc_list_head;
+
 void irc_init(Irc *irc);
-int irc_connect(Irc *irc, const char *host, int port, const char *nick, const char *user, const char *realname, const char *channel, int use_ssl);
+Irc* irc_new(const char *network);
+void irc_list_add(Irc *irc);
+void irc_free_all(void);
+buffer_node_t* irc_get_status_buffer(Irc *irc);
+int irc_connect(Irc *irc, event_loop_t *loop, const char *host, int port, const char *nick, const char *user, const char *realname, const char *channel, int use_ssl);
 void irc_disconnect(Irc *irc);
 int irc_send(Irc *irc, const char *data);
-int irc_process_buffer(Irc *irc, bool *needs_refresh, char *out_command_buf, int out_command_buf_size);
+int irc_queue_depth(Irc *irc);
+long long irc_lag_ms(Irc *irc);
+bool irc_cap_enabled(Irc *irc, unsigned cap);
+bool irc_is_channel(Irc *irc, const char *name);
+int irc_send_list(Irc *irc, const char *command, const char *const *targets, int count, const char *trailing);
+int irc_send_modes(Irc *irc, const char *channel, bool adding, char mode, const char *const *args, int count);
+int irc_request_history(Irc *irc, buffer_node_t *buffer);
+int irc_process_buffer(Irc *irc, bool *needs_refresh);
 int irc_recv(Irc *irc);
+void irc_detach(Irc *irc);
 
 #endif // IRC_H
\ No newline at end of file
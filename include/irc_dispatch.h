@@ -0,0 +1,78 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IRC_DISPATCH_H
+#define IRC_DISPATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <irc_message.h>
+
+struct Irc;
+
+// Slots for named commands; a power of two comfortably above their number
+#define IRC_DISPATCH_VERB_SLOTS 128
+#define IRC_DISPATCH_NUMERICS 1000
+
+typedef void (*irc_handler_fn)(struct Irc *irc, const irc_message_t *msg, bool *needs_refresh);
+
+/**
+ * @brief A handler for a named command such as "PRIVMSG".
+ */
+typedef struct {
+    const char *verb;
+    irc_handler_fn fn;
+} irc_verb_handler_t;
+
+/**
+ * @brief A handler for a three-digit reply such as 353.
+ */
+typedef struct {
+    int numeric;
+    irc_handler_fn fn;
+} irc_numeric_handler_t;
+
+/**
+ * @brief Maps incoming commands to handlers with one probe.
+ *
+ * Named commands go through a perfect hash: at build time a seed is
+ * searched for under which no two verbs share a slot, so a lookup is one
+ * hash, one slot and one comparison. Numerics index a flat array.
+ */
+typedef struct {
+    uint32_t seed;
+    struct {
+        const char *verb;
+        size_t len;
+        irc_handler_fn fn;
+    } slots[IRC_DISPATCH_VERB_SLOTS];
+    irc_handler_fn numerics[IRC_DISPATCH_NUMERICS];
+} irc_dispatch_t;
+
+/**
+ * @brief Builds the table.
+ * @return 0 on success, -1 if no collision-free seed was found.
+ */
+int irc_dispatch_build(irc_dispatch_t *table, const irc_verb_handler_t *verbs, int verb_count,
+                       const irc_numeric_handler_t *numerics, int numeric_count);
+
+/**
+ * @brief Returns the handler for a parsed message, or NULL if it has none.
+ */
+irc_handler_fn irc_dispatch_lookup(const irc_dispatch_t *table, const irc_message_t *msg);
+
+#endif // IRC_DISPATCH_H
@@ -0,0 +1,95 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IRC_MESSAGE_H
+#define IRC_MESSAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// RFC 2812: at most 14 middle parameters plus one trailing
+#define IRC_MAX_PARAMS 15
+
+/**
+ * @brief A piece of a line that is not NUL-terminated. An absent piece has
+ * ptr NULL and len 0.
+ */
+typedef struct {
+    const char *ptr;
+    size_t len;
+} irc_slice_t;
+
+// Expands to the arguments for a "%.*s" conversion of a slice
+#define IRC_SLICE_ARGS(s) (int)(s).len, ((s).ptr ? (s).ptr : "")
+
+/**
+ * @brief One parsed message. All slices point into the original line.
+ */
+typedef struct {
+    irc_slice_t tags;       // Raw tag section without the '@'
+    irc_slice_t prefix;     // Whole prefix without the ':'
+    irc_slice_t nick;       // Nick, or server name for server prefixes
+    irc_slice_t user;
+    irc_slice_t host;
+    irc_slice_t command;
+    int numeric;            // 0-999 for three-digit replies, else -1
+    irc_slice_t params[IRC_MAX_PARAMS];
+    int param_count;
+    bool has_trailing;      // Whether the last parameter was given with ':'
+} irc_message_t;
+
+/**
+ * @brief Parses one line, without its CRLF, in a single pass.
+ *
+ * The line is neither modified nor required to be NUL-terminated, and
+ * nothing is allocated.
+ *
+ * @return 0 on success, -1 if the line has no command.
+ */
+int irc_message_parse(const char *line, size_t len, irc_message_t *msg);
+
+/**
+ * @brief Looks up a tag by key.
+ * @param value Set to the tag's raw (still escaped) value; empty if the tag
+ *              has no value.
+ * @return true if the tag is present.
+ */
+bool irc_message_tag(const irc_message_t *msg, const char *key, irc_slice_t *value);
+
+/**
+ * @brief Reads the IRCv3 server-time tag, e.g. "time=2025-01-31T12:34:56.789Z".
+ * @return Milliseconds since the epoch, or -1 if the tag is absent or malformed.
+ */
+long long irc_message_time_ms(const irc_message_t *msg);
+
+/**
+ * @brief Returns parameter index, or an empty slice if there is none.
+ */
+irc_slice_t irc_message_param(const irc_message_t *msg, int index);
+
+/**
+ * @brief Compares a slice with a NUL-terminated string.
+ */
+bool irc_slice_equals(irc_slice_t slice, const char *str);
+
+/**
+ * @brief Copies a slice into buf as a NUL-terminated string, truncating to fit.
+ * @return buf.
+ */
+char* irc_slice_copy(irc_slice_t slice, char *buf, size_t buf_size);
+
+#endif // IRC_MESSAGE_H
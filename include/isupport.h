@@ -0,0 +1,94 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef ISUPPORT_H
+#define ISUPPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <casemap.h>
+#include <irc_message.h>
+
+#define ISUPPORT_MAX_PREFIXES 16
+#define ISUPPORT_MAX_LIMITS 16
+
+/**
+ * @brief A per-command or per-mode limit from TARGMAX or MAXLIST.
+ */
+typedef struct {
+    char key[16];           // Command name for TARGMAX, mode letters for MAXLIST
+    int limit;              // 0 means no limit
+} isupport_limit_t;
+
+/**
+ * @brief What a server announced in RPL_ISUPPORT (005). Every field starts
+ * out with the RFC 1459/2812 behaviour and is overridden token by token.
+ */
+typedef struct {
+    char chantypes[16];                             // Characters that start a channel name
+    char prefix_modes[ISUPPORT_MAX_PREFIXES + 1];   // Membership modes, highest rank first
+    char prefix_symbols[ISUPPORT_MAX_PREFIXES + 1]; // Their NAMES/WHO symbols, same order
+    char statusmsg[ISUPPORT_MAX_PREFIXES + 1];      // Symbols allowed in front of a message target
+    char chanmodes[4][64];  // A: lists, B: always a parameter, C: a parameter when set, D: none
+    casemap_t casemapping;
+    int modes;              // Parameterised mode changes per MODE; 0 means no limit
+    int maxtargets;         // Targets for commands TARGMAX does not list; 0 means no limit
+    int chathistory;        // Messages per CHATHISTORY request; 0 means no limit
+    isupport_limit_t targmax[ISUPPORT_MAX_LIMITS];
+    int targmax_count;
+    isupport_limit_t maxlist[ISUPPORT_MAX_LIMITS];
+    int maxlist_count;
+} isupport_t;
+
+void isupport_init(isupport_t *isupport);
+
+/**
+ * @brief Applies the tokens of one 005 reply: <client> <token>... :are supported
+ * @return The number of tokens applied.
+ */
+int isupport_apply(isupport_t *isupport, const irc_message_t *msg);
+
+/**
+ * @brief Whether a name is a channel according to CHANTYPES.
+ */
+bool isupport_is_channel(const isupport_t *isupport, const char *name, size_t len);
+
+/**
+ * @brief Returns the rank of a PREFIX symbol (0 is highest), or -1.
+ */
+int isupport_prefix_rank(const isupport_t *isupport, char symbol);
+
+/**
+ * @brief Whether a channel mode change carries a parameter.
+ */
+bool isupport_mode_has_param(const isupport_t *isupport, char mode, bool adding);
+
+/**
+ * @brief Returns how many targets one command may carry; 0 means no limit.
+ *
+ * TARGMAX decides when the server sent it. Otherwise JOIN and PART take
+ * lists as in RFC 2812, PRIVMSG and NOTICE fall back to MAXTARGETS, and
+ * anything else, such as WHO, is sent one target at a time.
+ */
+int isupport_targmax(const isupport_t *isupport, const char *command);
+
+/**
+ * @brief Returns how many entries a list mode (e.g. b) may hold; 0 means no limit.
+ */
+int isupport_maxlist(const isupport_t *isupport, char mode);
+
+#endif // ISUPPORT_H
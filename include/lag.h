@@ -0,0 +1,54 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LAG_H
+#define LAG_H
+
+// Round-trip times below this many ms get a bucket each; above it every
+// power of two is split into LAG_SUB_BUCKETS buckets, so a percentile is
+// accurate to within 12.5%.
+#define LAG_LINEAR_MS 16
+#define LAG_SUB_BUCKETS 8
+#define LAG_MAX_OCTAVE 17    // Everything from 2^17 ms (131 s) up shares the last bucket
+#define LAG_BUCKETS (LAG_LINEAR_MS + (LAG_MAX_OCTAVE - 4) * LAG_SUB_BUCKETS + 1)
+
+/**
+ * @brief A fixed-size histogram of round-trip times in milliseconds.
+ */
+typedef struct {
+    unsigned long buckets[LAG_BUCKETS];
+    unsigned long samples;
+    long long last_ms;      // Most recent sample, -1 before the first
+    long long max_ms;
+} lag_t;
+
+void lag_init(lag_t *lag);
+
+/**
+ * @brief Adds one round-trip time.
+ */
+void lag_record(lag_t *lag, long long rtt_ms);
+
+/**
+ * @brief Returns the given percentile (0-100), or -1 without samples.
+ *
+ * The result is the upper bound of the bucket the percentile falls in,
+ * capped at the largest sample.
+ */
+long long lag_percentile(const lag_t *lag, double percentile);
+
+#endif // LAG_H
@@ -0,0 +1,81 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LINEBUF_H
+#define LINEBUF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief A fixed-size ring of received bytes that hands out whole lines.
+ *
+ * Memory use is constant: the ring plus one scratch line used only for
+ * lines that wrap around the end of the ring. Lines longer than the cap
+ * are dropped up to their terminator instead of growing anything.
+ */
+typedef struct {
+    char *data;
+    size_t capacity;        // Power of two
+    size_t head;            // Read position, counts up forever
+    size_t tail;            // Write position, counts up forever
+    size_t scanned;         // Bytes after head already known not to hold '\n'
+    size_t max_line;        // Longest accepted line, terminator included
+    char *scratch;          // max_line bytes for lines that wrap
+    bool discarding;        // Inside an over-long line, dropping until '\n'
+    size_t discarded_bytes; // Length of the line being dropped so far
+    unsigned long dropped_lines;
+} linebuf_t;
+
+/**
+ * @brief Allocates the ring and scratch line.
+ * @param capacity Ring size, a power of two larger than max_line.
+ * @param max_line Longest line to deliver, including its CRLF or LF.
+ * @return 0 on success, -1 on failure.
+ */
+int linebuf_init(linebuf_t *lb, size_t capacity, size_t max_line);
+
+void linebuf_free(linebuf_t *lb);
+
+/**
+ * @brief Forgets all buffered bytes, e.g. when a connection is replaced.
+ */
+void linebuf_reset(linebuf_t *lb);
+
+/**
+ * @brief Returns the largest contiguous free region for the next read.
+ * @param avail Set to the region's size; 0 if the ring is full.
+ */
+char* linebuf_write_ptr(linebuf_t *lb, size_t *avail);
+
+/**
+ * @brief Marks count bytes at linebuf_write_ptr() as filled.
+ */
+void linebuf_commit(linebuf_t *lb, size_t count);
+
+/**
+ * @brief Returns the next complete line without its CRLF or LF.
+ *
+ * The line is NUL-terminated and may be modified in place. It stays valid
+ * until the next call or the next write into the ring.
+ *
+ * @param len Set to the line length.
+ * @return The line, or NULL if no complete line is buffered.
+ */
+char* linebuf_next_line(linebuf_t *lb, size_t *len);
+
+#endif // LINEBUF_H
@@ -0,0 +1,44 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LINESCAN_H
+#define LINESCAN_H
+
+#include <stddef.h>
+
+/**
+ * @brief Returns the first '\n' in buf, or NULL.
+ *
+ * The scanner is picked on first use: glibc's memchr() where available,
+ * otherwise AVX2 or SSE2 as the CPU supports, then memchr(). The CHATTER_LINESCAN
+ * environment variable can force one of "avx2", "sse2", "memchr" or
+ * "scalar".
+ */
+const char* linescan_find_newline(const char *buf, size_t len);
+
+/**
+ * @brief Selects a scanner by name, for benchmarks and troubleshooting.
+ * @return 0 on success, -1 if the name is unknown or the CPU lacks support.
+ */
+int linescan_select(const char *name);
+
+/**
+ * @brief Returns the name of the scanner in use.
+ */
+const char* linescan_name(void);
+
+#endif // LINESCAN_H
@@ -0,0 +1,186 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef MEMBERS_H
+#define MEMBERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <intern.h>
+
+#define MEMBERS_MIN_CAPACITY 8
+#define MEMBERS_INLINE_CHANNELS 4   // Channels a user can share with us before their list is allocated
+
+typedef struct member_channel member_channel_t;
+
+/**
+ * @brief Someone we share at least one channel with.
+ *
+ * A user is dropped as soon as the last shared channel is, so QUIT and
+ * NICK only ever concern the channels in this list.
+ */
+typedef struct {
+    intern_id_t nick;
+    intern_id_t userhost;           // "user@host", 0 until seen
+    member_channel_t **channels;    // Points at channels_inline until it grows
+    int channel_count;
+    int channel_capacity;
+    int staged;                     // Pending NAMES lists that name this user
+    member_channel_t *channels_inline[MEMBERS_INLINE_CHANNELS];
+} member_user_t;
+
+/**
+ * @brief One member of a channel.
+ */
+typedef struct {
+    member_user_t *user;            // NULL when the slot is free
+    unsigned int prefixes;          // Bit i is the i-th mode of ISUPPORT PREFIX, e.g. 1 for o
+} member_slot_t;
+
+/**
+ * @brief Open-addressing set of members, probed linearly from the user's address.
+ */
+typedef struct {
+    member_slot_t *slots;
+    int count;
+    int capacity;                   // Power of two
+} member_set_t;
+
+/**
+ * @brief A channel we are in.
+ *
+ * NAMES replies are collected in a separate set and only replace the
+ * member list once RPL_ENDOFNAMES arrives, so a channel is never seen
+ * half-listed and a repeated NAMES also drops members we missed leaving.
+ */
+struct member_channel {
+    intern_id_t name;
+    member_set_t members;
+    member_set_t staged;            // Names from 353 replies since the last 366
+    bool staging;
+    bool synced;                    // RPL_ENDOFNAMES seen since we joined
+};
+
+/**
+ * @brief Every user and channel known on one connection.
+ */
+typedef struct {
+    intern_pool_t *pool;            // Holds the nicks, user@host and channel names
+    member_user_t **users;          // Indexed by nick ID
+    int user_count;
+    intern_id_t user_capacity;
+    member_channel_t **channels;
+    int channel_count;
+    int channel_capacity;
+} members_t;
+
+/**
+ * @param pool The connection's name pool; its CASEMAPPING decides which nicks are equal.
+ */
+void members_init(members_t *members, intern_pool_t *pool);
+
+/**
+ * @brief Forgets every user and channel, e.g. when the connection drops.
+ */
+void members_clear(members_t *members);
+
+member_channel_t* members_find_channel(members_t *members, const char *name, size_t len);
+
+/**
+ * @brief Returns the channel, adding it empty if we were not in it.
+ * @return The channel, or NULL on allocation failure.
+ */
+member_channel_t* members_add_channel(members_t *members, const char *name, size_t len);
+
+/**
+ * @brief Leaves a channel, dropping users who were only seen there.
+ */
+void members_remove_channel(members_t *members, member_channel_t *channel);
+
+member_user_t* members_find_user(members_t *members, const char *nick, size_t len);
+
+const char* members_nick(const members_t *members, const member_user_t *user);
+const char* members_channel_name(const members_t *members, const member_channel_t *channel);
+
+/**
+ * @brief Records the user@host a user was last seen with.
+ */
+void members_set_userhost(members_t *members, member_user_t *user, const char *userhost, size_t len);
+
+/**
+ * @brief Adds a user to a channel. Adding an existing member is a no-op.
+ * @return The user, or NULL on allocation failure.
+ */
+member_user_t* members_join(members_t *members, member_channel_t *channel, const char *nick, size_t len);
+
+/**
+ * @brief Records a name from RPL_NAMREPLY until members_commit() applies the list.
+ * @param prefixes The member's status bits, as in member_slot_t.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int members_stage(members_t *members, member_channel_t *channel, const char *nick, size_t len,
+                  unsigned int prefixes);
+
+/**
+ * @brief Stages every name of a RPL_NAMREPLY list such as "@alice +bob carol".
+ *
+ * Leading status symbols (several with multi-prefix) become prefix bits by
+ * their position in prefix_symbols, and a "!user@host" suffix
+ * (userhost-in-names) is recorded as the user's user@host.
+ *
+ * @param prefix_symbols The ISUPPORT PREFIX symbols, highest rank first.
+ * @return The number of names staged, or -1 on allocation failure.
+ */
+int members_stage_names(members_t *members, member_channel_t *channel, const char *names, size_t len,
+                        const char *prefix_symbols);
+
+/**
+ * @brief Replaces a channel's members with the staged NAMES list (RPL_ENDOFNAMES).
+ */
+void members_commit(members_t *members, member_channel_t *channel);
+
+/**
+ * @brief Returns a member's status bits, or 0 if the user is not in the channel.
+ */
+unsigned int members_prefixes(const member_channel_t *channel, const member_user_t *user);
+
+/**
+ * @brief Sets or clears status bits of a member, e.g. for MODE +o.
+ */
+void members_set_prefixes(member_channel_t *channel, member_user_t *user, unsigned int bits, bool add);
+
+/**
+ * @brief Removes a user from one channel.
+ */
+void members_part(members_t *members, member_channel_t *channel, member_user_t *user);
+
+/**
+ * @brief Removes a user from every channel, as for a QUIT.
+ *
+ * Callers that need to announce the quit read user->channels first.
+ */
+void members_remove_user(members_t *members, member_user_t *user);
+
+/**
+ * @brief Gives a user a new nick; channel memberships are unchanged.
+ * @return 0 on success, -1 on failure.
+ */
+int members_rename(members_t *members, member_user_t *user, const char *nick, size_t len);
+
+bool members_contains(const member_channel_t *channel, const member_user_t *user);
+
+#endif // MEMBERS_H
@@ -0,0 +1,71 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <stdbool.h>
+#include <netdb.h>
+#include <event_loop.h>
+
+// Number of worker threads running getaddrinfo()
+#define RESOLVER_WORKERS 4
+// getaddrinfo() does not expose record TTLs, so successful answers are kept
+// for a fixed, conservative lifetime and failures for a much shorter one.
+#define RESOLVER_CACHE_TTL_MS 60000
+#define RESOLVER_NEGATIVE_TTL_MS 5000
+#define RESOLVER_CACHE_MAX_ENTRIES 64
+
+typedef struct resolver_request resolver_request_t;
+
+/**
+ * @brief Called on the event loop thread when a lookup completes.
+ * @param res The resolved addresses, valid only for the duration of the call,
+ *            or NULL on failure.
+ * @param error 0 on success, otherwise a getaddrinfo() error code.
+ * @param from_cache Whether the answer was served from the cache.
+ * @param data The opaque pointer given to resolver_lookup().
+ */
+typedef void (*resolver_cb)(const struct addrinfo *res, int error, bool from_cache, void *data);
+
+/**
+ * @brief Starts the resolver worker threads and hooks completions into the loop.
+ * @return 0 on success, -1 on failure.
+ */
+int resolver_init(event_loop_t *loop);
+
+/**
+ * @brief Stops the workers and drops the cache. Pending callbacks never fire.
+ */
+void resolver_shutdown(void);
+
+/**
+ * @brief Resolves host and port off the event loop thread.
+ *
+ * The callback always runs later from the event loop, even for cache hits.
+ * Concurrent lookups of the same name share one getaddrinfo() call.
+ *
+ * @return A handle usable with resolver_cancel(), or NULL on failure.
+ */
+resolver_request_t* resolver_lookup(const char *host, int port, resolver_cb cb, void *data);
+
+/**
+ * @brief Cancels a pending lookup so its callback never fires.
+ */
+void resolver_cancel(resolver_request_t *req);
+
+#endif // RESOLVER_H
@@ -0,0 +1,90 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SENDQ_H
+#define SENDQ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <openssl/ssl.h>
+
+// Most lines gathered into one sendmsg() call
+#define SENDQ_MAX_IOV 64
+// Most bytes gathered into one SSL_write(), the size of one TLS record
+#define SENDQ_TLS_STAGING_SIZE 16384
+
+// Returned by sendq_flush() when data is left and the socket is not writable
+#define SENDQ_PENDING 1
+
+typedef struct sendq_chunk sendq_chunk_t;
+
+/**
+ * @brief Outbound bytes waiting for a non-blocking socket.
+ *
+ * Each sendq_push() appends one chunk. Flushing gathers as many chunks as
+ * possible into a single write and remembers how far a short write got.
+ */
+typedef struct {
+    sendq_chunk_t *head;
+    sendq_chunk_t *tail;
+    size_t head_offset;      // Bytes of head already written
+    size_t bytes;            // Bytes not yet written, including staged ones
+    int chunks;              // Chunks in the list
+    // TLS only: bytes handed to SSL_write() that must be retried unchanged
+    char *staging;
+    size_t staging_len;
+    int staged_lines;        // Line ends among the staged bytes
+} sendq_t;
+
+void sendq_init(sendq_t *q);
+
+/**
+ * @brief Drops everything queued and releases the queue's memory.
+ */
+void sendq_clear(sendq_t *q);
+
+/**
+ * @brief Appends a copy of data to the queue.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int sendq_push(sendq_t *q, const char *data, size_t len);
+
+bool sendq_empty(const sendq_t *q);
+
+/**
+ * @brief Returns the number of lines not yet written, counting those
+ * already moved into the TLS staging buffer.
+ */
+int sendq_depth(const sendq_t *q);
+
+/**
+ * @brief Writes as much of the queue as the socket accepts.
+ *
+ * Plain sockets are written with one sendmsg() per batch of up to
+ * SENDQ_MAX_IOV chunks; TLS connections coalesce chunks into one record
+ * sized SSL_write(). Writing stops at the first short write.
+ *
+ * @param q The queue.
+ * @param fd The socket, used when ssl is NULL.
+ * @param ssl The TLS connection, or NULL.
+ * @param writes If not NULL, incremented by the number of write calls made.
+ * @return 0 if the queue was drained, SENDQ_PENDING if data remains and the
+ *         caller should wait for the socket to become writable, -1 on error.
+ */
+int sendq_flush(sendq_t *q, int fd, SSL *ssl, int *writes);
+
+#endif // SENDQ_H
@@ -0,0 +1,64 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SOCKOPT_H
+#define SOCKOPT_H
+
+#include <stdbool.h>
+
+// Keepalive probes start after a minute of silence, and a peer that misses
+// three probes ten seconds apart is given up on. TCP_USER_TIMEOUT bounds how
+// long sent data may stay unacknowledged to the same 90 seconds.
+#define SOCKOPT_DEFAULT_KEEPALIVE_IDLE_S 60
+#define SOCKOPT_DEFAULT_KEEPALIVE_INTERVAL_S 10
+#define SOCKOPT_DEFAULT_KEEPALIVE_COUNT 3
+#define SOCKOPT_DEFAULT_USER_TIMEOUT_MS 90000
+
+/**
+ * @brief Per-network TCP socket options. A value of 0 keeps the kernel's
+ * default for that option.
+ */
+typedef struct {
+    bool nodelay;               // Disable Nagle; the send queue batches writes itself
+    int keepalive_idle_s;       // Seconds of silence before probing; 0 disables keepalive
+    int keepalive_interval_s;
+    int keepalive_count;
+    int rcvbuf;                 // Bytes; setting a size turns off the kernel's autotuning
+    int sndbuf;
+    int user_timeout_ms;
+} sockopt_t;
+
+void sockopt_defaults(sockopt_t *opts);
+
+/**
+ * @brief Applies the options to a TCP socket that is not yet connected.
+ *
+ * Buffer sizes only affect the advertised window scale when set before
+ * connect(). A failing option is logged and skipped.
+ *
+ * @param fd The socket.
+ * @param label A name for log messages.
+ * @return 0 if every option was applied, -1 otherwise.
+ */
+int sockopt_apply(int fd, const sockopt_t *opts, const char *label);
+
+/**
+ * @brief Logs the values the kernel actually uses for a connected socket.
+ */
+void sockopt_log_effective(int fd, const char *label);
+
+#endif // SOCKOPT_H
@@ -0,0 +1,104 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef TLS_H
+#define TLS_H
+
+#include <stdbool.h>
+#include <openssl/ssl.h>
+
+#define TLS_SESSION_CACHE_FILE "chatter.sessions"
+#define TLS_SESSION_CACHE_MAX_ENTRIES 64
+
+/**
+ * @brief Initializes OpenSSL and the shared client SSL_CTX.
+ *
+ * This runs once per process: the library is initialized, the system CA
+ * store is loaded, ALPN ("irc") and the session cache are configured, and
+ * every connection then shares the resulting context.
+ *
+ * @param ca_file An additional PEM bundle to trust, or NULL.
+ * @return 0 on success, -1 on failure.
+ */
+int tls_init(const char *ca_file);
+
+/**
+ * @brief Frees the shared context and the session cache.
+ */
+void tls_shutdown(void);
+
+/**
+ * @brief Creates a client connection object from the shared context.
+ *
+ * Sets SNI (for host names), enables certificate and host name
+ * verification when requested, and offers a cached session.
+ *
+ * @param host The server name as configured.
+ * @param port The server port, used to key the session cache.
+ * @param verify Whether to verify the peer certificate and host name.
+ * @param session_offered Set to whether a cached session was offered.
+ * @return The new SSL object, or NULL on failure.
+ */
+SSL* tls_new_client(const char *host, int port, bool verify, bool *session_offered);
+
+/**
+ * @brief Presents a client certificate on this connection, e.g. for SASL EXTERNAL.
+ * @param cert_file PEM file with the certificate, optionally followed by its chain.
+ * @param key_file PEM file with the private key, or NULL if it is in cert_file.
+ * @return 0 on success, -1 on failure.
+ */
+int tls_use_client_cert(SSL *ssl, const char *cert_file, const char *key_file);
+
+/**
+ * @brief Describes why verification of the peer failed, if it did.
+ * @return A static description, or NULL if verification did not fail.
+ */
+const char* tls_verify_error(SSL *ssl);
+
+/**
+ * @brief Returns the negotiated ALPN protocol, or "none".
+ */
+const char* tls_alpn_protocol(SSL *ssl, char *buf, size_t buf_size);
+
+/**
+ * @brief Loads persisted TLS sessions. A missing file is not an error.
+ * @param path The cache file; it is rewritten whenever a new session arrives.
+ * @return The number of sessions loaded, or -1 on failure.
+ */
+int tls_session_cache_load(const char *path);
+
+/**
+ * @brief Releases all cached sessions.
+ */
+void tls_session_cache_free(void);
+
+/**
+ * @brief Tags a connection with its server and offers a cached session.
+ *
+ * TLS 1.3 tickets are single-use, so an offered 1.3 session is dropped from
+ * the cache; the server's fresh ticket replaces it.
+ *
+ * @return true if a cached session was offered.
+ */
+bool tls_session_resume(SSL *ssl, const char *host, int port);
+
+/**
+ * @brief Records whether a completed handshake resumed and logs the hit rate.
+ */
+void tls_session_report(SSL *ssl, bool offered);
+
+#endif // TLS_H
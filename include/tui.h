@@ -20,6 +20,7 @@
 
 #include <stdbool.h>
 #include <irc.h>
+#include <event_loop.h>
 
 /**
  * @brief Initializes the terminal user interface.
@@ -45,8 +46,9 @@ void tui_destroy(void);
  * @brief The main run loop for the TUI.
  *
  * This function handles user input, updates the screen, and manages
- * the overall flow of the user interface.
+ * the overall flow of the user interface. Terminal input and the sockets
+ * of every network in irc_list_head share the given event loop.
  */
-void tui_run(struct Irc *irc, const char *channel);
+void tui_run(event_loop_t *loop);
 
 #endif // TUI_H
\ No newline at end of file
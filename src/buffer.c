@@ -17,21 +17,46 @@
  */
 #include "buffer.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <version.h>
+#include <casemap.h>
+#include <irc.h>
 #include <stdio.h> // For snprintf
+#include <time.h>
 
 // Global handle to the list of buffers
 buffer_node_t *buffer_list_head = NULL;
 buffer_node_t *active_buffer = NULL;
 
+// Width lines are wrapped to on screen, in columns; 0 until the UI sets it
+static int wrap_width = 0;
+
+#define BUFFER_INDEX_MIN_CAPACITY 16
+
+/*
+ * Buffers are found by name through an open-addressing index with linear
+ * probing, keyed by network and by the name folded under that network's
+ * CASEMAPPING, so "#Chan" and "#chan" are the same buffer. Deletion shifts
+ * the following run back instead of leaving tombstones.
+ */
+typedef struct {
+    buffer_node_t *buffer;      // NULL when the slot is free
+    unsigned int hash;
+} buffer_slot_t;
+
+static buffer_slot_t *index_slots = NULL;
+static int index_capacity = 0;  // Power of two
+static int index_count = 0;
+static int buffer_count = 0;    // Buffers in the list; more than index_count if the index could not grow
+
 /**
  * @brief Initializes the buffer list.
  */
 void buffer_list_init(void) {
     // Create the initial "status" buffer
-    buffer_node_t *status_buffer = create_buffer("status");
+    buffer_node_t *status_buffer = create_buffer(NULL, "status");
     if (status_buffer) {
         add_buffer(status_buffer);
         set_active_buffer(status_buffer);
@@ -44,10 +69,11 @@ void buffer_list_init(void) {
 
 /**
  * @brief Creates a new buffer node.
+ * @param irc The network the buffer belongs to, or NULL for a client-wide buffer.
  * @param name The name of the buffer.
  * @return A pointer to the newly created buffer_node_t, or NULL on failure.
  */
-buffer_node_t* create_buffer(const char *name) {
+buffer_node_t* create_buffer(struct Irc *irc, const char *name) {
     buffer_node_t *new_buffer = (buffer_node_t*) malloc(sizeof(buffer_node_t));
     if (!new_buffer) {
         return NULL; // Memory allocation failed
@@ -59,18 +85,114 @@ buffer_node_t* create_buffer(const char *name) {
         return NULL; // Memory allocation failed
     }
 
+    new_buffer->irc = irc;
     new_buffer->lines = NULL;
+    new_buffer->times = NULL;
     new_buffer->line_count = 0;
     new_buffer->capacity = 0;
     new_buffer->active = 0; // Not active by default
     new_buffer->scroll_offset = 0;
     new_buffer->at_bottom = true;
+    new_buffer->history_pending = false;
+    new_buffer->history_complete = false;
+    new_buffer->name_hash = 0;
     new_buffer->prev = NULL;
     new_buffer->next = NULL;
 
     return new_buffer;
 }
 
+/**
+ * @brief Returns the casemapping names are compared under on a network.
+ */
+static casemap_t buffer_casemap(const struct Irc *irc) {
+    // Client-wide buffers are not IRC names, so only A-Z fold
+    return irc ? irc->isupport.casemapping : CASEMAP_ASCII;
+}
+
+static unsigned int buffer_hash(const struct Irc *irc, const char *name) {
+    unsigned int hash = casemap_hash(buffer_casemap(irc), name, strlen(name));
+    // Mix in the network so the same channel on two networks spreads out
+    return hash ^ (unsigned int)(((uint64_t)(uintptr_t)irc * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static void index_place(buffer_slot_t *slots, int capacity, buffer_slot_t slot) {
+    int mask = capacity - 1;
+    int i = (int)(slot.hash & (unsigned int)mask);
+    while (slots[i].buffer) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+}
+
+/**
+ * @brief Rebuilds the index at the given capacity from the buffer list.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int index_rebuild(int capacity) {
+    buffer_slot_t *slots = (buffer_slot_t*) calloc(capacity, sizeof(buffer_slot_t));
+    if (!slots) {
+        return -1;
+    }
+    index_count = 0;
+    if (buffer_list_head) {
+        buffer_node_t *current = buffer_list_head;
+        do {
+            current->name_hash = buffer_hash(current->irc, current->name);
+            index_place(slots, capacity, (buffer_slot_t){current, current->name_hash});
+            index_count++;
+            current = current->next;
+        } while (current != buffer_list_head);
+    }
+    free(index_slots);
+    index_slots = slots;
+    index_capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Adds a buffer that is already in the list to the index.
+ */
+static void index_insert(buffer_node_t *buffer) {
+    buffer->name_hash = buffer_hash(buffer->irc, buffer->name);
+    if (index_count == buffer_count - 1 && buffer_count * 4 <= index_capacity * 3) {
+        index_place(index_slots, index_capacity, (buffer_slot_t){buffer, buffer->name_hash});
+        index_count++;
+        return;
+    }
+    // Grow, or retry a rebuild that failed earlier. Lookups walk the list
+    // until the index holds every buffer again.
+    int capacity = index_capacity ? index_capacity : BUFFER_INDEX_MIN_CAPACITY;
+    while (buffer_count * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    index_rebuild(capacity);
+}
+
+static void index_remove(buffer_node_t *buffer) {
+    if (!index_slots) {
+        return;
+    }
+    int mask = index_capacity - 1;
+    int hole = (int)(buffer->name_hash & (unsigned int)mask);
+    while (index_slots[hole].buffer != buffer) {
+        if (!index_slots[hole].buffer) {
+            return; // Not indexed
+        }
+        hole = (hole + 1) & mask;
+    }
+    for (int i = (hole + 1) & mask; index_slots[i].buffer; i = (i + 1) & mask) {
+        int home = (int)(index_slots[i].hash & (unsigned int)mask);
+        // Move the entry back if the hole lies between its home and its slot
+        if (hole <= i ? (home <= hole || home > i) : (home <= hole && home > i)) {
+            index_slots[hole] = index_slots[i];
+            hole = i;
+        }
+    }
+    index_slots[hole].buffer = NULL;
+    index_count--;
+}
+
 /**
  * @brief Adds a buffer to the global buffer list.
  * @param buffer The buffer to add.
@@ -91,10 +213,16 @@ void add_buffer(buffer_node_t *buffer) {
         buffer->next = buffer_list_head;
         buffer_list_head->prev = buffer;
     }
+    buffer_count++;
+    index_insert(buffer);
 }
 
 /**
  * @brief Appends a message to a buffer.
+ *
+ * The line is stamped with the current time, or with the newest time
+ * already in the buffer if the clock is behind it, so it always lands last.
+ *
  * @param buffer The buffer to append the message to.
  * @param message The message string to append.
  */
@@ -103,6 +231,31 @@ void buffer_append_message(buffer_node_t *buffer, const char *message) {
         return;
     }
 
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long now_ms = (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    if (buffer->line_count > 0 && buffer->times[buffer->line_count - 1] > now_ms) {
+        now_ms = buffer->times[buffer->line_count - 1];
+    }
+    buffer_insert_message(buffer, message, now_ms);
+}
+
+/**
+ * @brief Inserts a message in time order.
+ *
+ * Lines carrying their own timestamp, such as bouncer playback, can be older
+ * than what is already shown. They are placed after every line with the same
+ * or an earlier time, and a reader scrolled up stays on the same text.
+ *
+ * @param buffer The buffer to insert the message into.
+ * @param message The message string to insert.
+ * @param time_ms When the message was sent, in ms since the epoch.
+ */
+void buffer_insert_message(buffer_node_t *buffer, const char *message, long long time_ms) {
+    if (!buffer || !message) {
+        return;
+    }
+
     // Reallocate if capacity is reached
     if (buffer->line_count >= buffer->capacity) {
         int new_capacity = buffer->capacity == 0 ? 10 : buffer->capacity * 2; // Start with 10, then double
@@ -112,38 +265,135 @@ void buffer_append_message(buffer_node_t *buffer, const char *message) {
             return;
         }
         buffer->lines = new_lines;
+        long long *new_times = (long long*) realloc(buffer->times, new_capacity * sizeof(long long));
+        if (!new_times) {
+            return;
+        }
+        buffer->times = new_times;
         buffer->capacity = new_capacity;
     }
 
-    buffer->lines[buffer->line_count] = strdup(message);
-    if (!buffer->lines[buffer->line_count]) {
+    char *line = strdup(message);
+    if (!line) {
         // Handle strdup failure
         return;
     }
+
+    // Live traffic is newer than everything else, so this rarely moves
+    int pos = buffer->line_count;
+    while (pos > 0 && buffer->times[pos - 1] > time_ms) {
+        pos--;
+    }
+    if (pos < buffer->line_count) {
+        memmove(&buffer->lines[pos + 1], &buffer->lines[pos], (buffer->line_count - pos) * sizeof(char*));
+        memmove(&buffer->times[pos + 1], &buffer->times[pos], (buffer->line_count - pos) * sizeof(long long));
+    }
+    buffer->lines[pos] = line;
+    buffer->times[pos] = time_ms;
     buffer->line_count++;
+
     if (buffer->at_bottom) {
         // This is a simplified calculation. A more accurate calculation would need to
         // account for line wrapping, which requires knowledge of the window width.
         // For now, we'll just scroll to the last line.
-        if (buffer->line_count > 0) {
-            buffer->scroll_offset = buffer->line_count - 1;
+        buffer->scroll_offset = buffer->line_count - 1;
+    } else {
+        // scroll_offset counts screen rows, so shift it by the rows the new
+        // line takes if it landed at or above the top of the view.
+        int row = 0;
+        for (int i = 0; i < pos && row <= buffer->scroll_offset; i++) {
+            row += buffer_line_rows(buffer->lines[i]);
+        }
+        if (row <= buffer->scroll_offset) {
+            buffer->scroll_offset += buffer_line_rows(line);
         }
     }
 }
 
 /**
- * @brief Gets a buffer by its name.
+ * @brief Sets the width lines are wrapped to, so inserts can keep the view.
+ * @param width The text width in columns.
+ */
+void buffer_set_wrap_width(int width) {
+    wrap_width = width;
+}
+
+/**
+ * @brief Word-wraps one screen row off the front of a line.
+ *
+ * The row ends at the last space within width, or mid-word if there is
+ * none; the space itself is skipped. This is the wrapping the TUI draws.
+ *
+ * @param line The rest of the line to lay out.
+ * @param width The text width in columns.
+ * @param row_len Set to the number of characters on the row.
+ * @return Where the next row starts, or NULL if this was the last one.
+ */
+const char* buffer_wrap_row(const char *line, int width, int *row_len) {
+    size_t len = width > 0 ? strnlen(line, (size_t)width + 1) : strlen(line);
+    if (width <= 0 || len <= (size_t)width) {
+        *row_len = (int)strlen(line);
+        return NULL;
+    }
+    int break_pos = width;
+    while (break_pos > 0 && line[break_pos] != ' ') {
+        break_pos--;
+    }
+    if (break_pos == 0) {
+        break_pos = width;
+    }
+    *row_len = break_pos;
+    const char *next = line + break_pos;
+    return *next == ' ' ? next + 1 : next;
+}
+
+/**
+ * @brief Returns how many screen rows a line takes at the current wrap
+ * width, always at least 1.
+ */
+int buffer_line_rows(const char *line) {
+    int rows = 0;
+    int row_len;
+    do {
+        rows++;
+        line = buffer_wrap_row(line, wrap_width, &row_len);
+    } while (line);
+    return rows;
+}
+
+/**
+ * @brief Gets a buffer by its name within a network's namespace.
+ *
+ * Names are compared under the network's CASEMAPPING.
+ *
+ * @param irc The network to search, or NULL for client-wide buffers.
  * @param name The name of the buffer to find.
  * @return A pointer to the buffer_node_t if found, or NULL if not found.
  */
-buffer_node_t* get_buffer_by_name(const char *name) {
+buffer_node_t* get_buffer_by_name(struct Irc *irc, const char *name) {
     if (!buffer_list_head || !name) {
         return NULL;
     }
 
+    casemap_t casemap = buffer_casemap(irc);
+    size_t len = strlen(name);
+    if (index_count == buffer_count) {
+        unsigned int hash = buffer_hash(irc, name);
+        int mask = index_capacity - 1;
+        for (int i = (int)(hash & (unsigned int)mask); index_slots[i].buffer; i = (i + 1) & mask) {
+            buffer_node_t *current = index_slots[i].buffer;
+            if (index_slots[i].hash == hash && current->irc == irc &&
+                casemap_equals(casemap, name, len, current->name)) {
+                return current;
+            }
+        }
+        return NULL;
+    }
+
+    // The index could not grow; walk the list instead
     buffer_node_t *current = buffer_list_head;
     do {
-        if (strcmp(current->name, name) == 0) {
+        if (current->irc == irc && casemap_equals(casemap, name, len, current->name)) {
             return current;
         }
         current = current->next;
@@ -152,6 +402,19 @@ buffer_node_t* get_buffer_by_name(const char *name) {
     return NULL;
 }
 
+/**
+ * @brief Rehashes the buffer index after a network's CASEMAPPING changed.
+ */
+void buffer_reindex(void) {
+    if (index_capacity > 0 && index_rebuild(index_capacity) != 0) {
+        // The old hashes are wrong now; walk the list until the next add rebuilds
+        free(index_slots);
+        index_slots = NULL;
+        index_capacity = 0;
+        index_count = 0;
+    }
+}
+
 /**
  * @brief Sets the given buffer as the active buffer.
  * @param buffer The buffer to set as active.
@@ -184,6 +447,7 @@ void buffer_free(buffer_node_t *buffer) {
 
     // Free the lines array
     free(buffer->lines);
+    free(buffer->times);
 
     // Free the buffer name
     free(buffer->name);
@@ -216,6 +480,33 @@ void remove_buffer(buffer_node_t *buffer) {
 
     buffer->prev->next = buffer->next;
     buffer->next->prev = buffer->prev;
+    index_remove(buffer);
+    buffer_count--;
 
     buffer_free(buffer);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Frees every buffer and the name index.
+ */
+void buffer_list_free(void) {
+    if (buffer_list_head) {
+        // Break the circle to treat it as a simple list
+        buffer_list_head->prev->next = NULL;
+
+        buffer_node_t *current = buffer_list_head;
+        while (current != NULL) {
+            buffer_node_t *next = current->next;
+            buffer_free(current);
+            current = next;
+        }
+        buffer_list_head = NULL;
+    }
+    active_buffer = NULL;
+
+    free(index_slots);
+    index_slots = NULL;
+    index_capacity = 0;
+    index_count = 0;
+    buffer_count = 0;
+}
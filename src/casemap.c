@@ -0,0 +1,106 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <string.h>
+
+#include <casemap.h>
+
+static unsigned char fold_tables[3][256];
+static bool tables_ready = false;
+
+static void build_tables(void) {
+    for (int map = 0; map < 3; map++) {
+        for (int c = 0; c < 256; c++) {
+            unsigned char folded = (unsigned char)c;
+            if (c >= 'A' && c <= 'Z') {
+                folded = (unsigned char)(c + ('a' - 'A'));
+            } else if (map != CASEMAP_ASCII && c >= '[' && c <= (map == CASEMAP_RFC1459 ? '^' : ']')) {
+                folded = (unsigned char)(c + ('{' - '['));
+            }
+            fold_tables[map][c] = folded;
+        }
+    }
+    tables_ready = true;
+}
+
+const unsigned char* casemap_table(casemap_t map) {
+    if (!tables_ready) {
+        build_tables();
+    }
+    return fold_tables[map];
+}
+
+unsigned char casemap_fold(casemap_t map, unsigned char c) {
+    return casemap_table(map)[c];
+}
+
+casemap_t casemap_from_name(const char *name, size_t len) {
+    if (len == 5 && memcmp(name, "ascii", 5) == 0) {
+        return CASEMAP_ASCII;
+    }
+    if (len == 14 && memcmp(name, "strict-rfc1459", 14) == 0) {
+        return CASEMAP_STRICT_RFC1459;
+    }
+    return CASEMAP_RFC1459;
+}
+
+const char* casemap_name(casemap_t map) {
+    switch (map) {
+        case CASEMAP_ASCII: return "ascii";
+        case CASEMAP_STRICT_RFC1459: return "strict-rfc1459";
+        default: return "rfc1459";
+    }
+}
+
+bool casemap_equals(casemap_t map, const char *a, size_t a_len, const char *b) {
+    // Folding keeps the length, so a name of another length never matches.
+    // Checking that first also keeps the comparisons below inside b.
+    if (strnlen(b, a_len + 1) != a_len) {
+        return false;
+    }
+    // Names are usually spelled the same way each time they appear
+    if (memcmp(a, b, a_len) == 0) {
+        return true;
+    }
+    const unsigned char *fold = casemap_table(map);
+    for (size_t i = 0; i < a_len; i++) {
+        if (fold[(unsigned char)a[i]] != fold[(unsigned char)b[i]]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned int casemap_hash(casemap_t map, const char *s, size_t len) {
+    // Folds eight bytes at a time into a word and mixes each word in with
+    // one multiply, so the table lookups do not wait on each other.
+    const unsigned char *fold = casemap_table(map);
+    const uint64_t k = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = (uint64_t)len * k;
+    size_t i = 0;
+    while (i < len) {
+        uint64_t word = 0;
+        for (int shift = 0; shift < 64 && i < len; shift += 8, i++) {
+            word |= (uint64_t)fold[(unsigned char)s[i]] << shift;
+        }
+        hash = (hash ^ word) * k;
+        hash ^= hash >> 29;
+    }
+    return (unsigned int)(hash ^ (hash >> 32));
+}
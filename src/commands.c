@@ -27,6 +27,12 @@
 static void handle_join_command(Irc *irc, const char **args, buffer_node_t *active_buffer);
 static void handle_part_command(Irc *irc, const char **args, buffer_node_t *active_buffer);
 static void handle_nick(Irc *irc, const char **args, buffer_node_t *active_buffer);
+static void handle_msg(Irc *irc, const char **args, buffer_node_t *active_buffer);
+static void handle_op(Irc *irc, const char **args, buffer_node_t *active_buffer);
+static void handle_deop(Irc *irc, const char **args, buffer_node_t *active_buffer);
+static void handle_voice(Irc *irc, const char **args, buffer_node_t *active_buffer);
+static void handle_devoice(Irc *irc, const char **args, buffer_node_t *active_buffer);
+static void handle_who(Irc *irc, const char **args, buffer_node_t *active_buffer);
 
 // Example command definitions
 const command_arg join_args[] = {
@@ -42,22 +48,159 @@ const command_arg nick_args[] = {
     {"nickname", ARG_TYPE_NICKNAME, ARG_NECESSITY_OPTIONAL}
 };
 
+const command_arg msg_args[] = {
+    {"targets", ARG_TYPE_STRING, ARG_NECESSITY_REQUIRED},
+    {"message", ARG_TYPE_STRING, ARG_NECESSITY_REQUIRED}
+};
+
+const command_arg who_args[] = {
+    {"targets", ARG_TYPE_STRING, ARG_NECESSITY_REQUIRED}
+};
+
+const command_arg mode_nick_args[] = {
+    {"nickname", ARG_TYPE_NICKNAME, ARG_NECESSITY_REQUIRED}
+};
+
 const command_def command_defs[] = {
     {"join", (void (*)(Irc*, const char**, buffer_node_t*))handle_join_command, join_args, sizeof(join_args) / sizeof(command_arg)},
     {"part", (void (*)(Irc*, const char**, buffer_node_t*))handle_part_command, part_args, sizeof(part_args) / sizeof(command_arg)},
-    {"nick", (void (*)(Irc*, const char**, buffer_node_t*))handle_nick, nick_args, sizeof(nick_args) / sizeof(command_arg)}
+    {"nick", (void (*)(Irc*, const char**, buffer_node_t*))handle_nick, nick_args, sizeof(nick_args) / sizeof(command_arg)},
+    {"msg", (void (*)(Irc*, const char**, buffer_node_t*))handle_msg, msg_args, sizeof(msg_args) / sizeof(command_arg)},
+    {"op", (void (*)(Irc*, const char**, buffer_node_t*))handle_op, mode_nick_args, sizeof(mode_nick_args) / sizeof(command_arg)},
+    {"deop", (void (*)(Irc*, const char**, buffer_node_t*))handle_deop, mode_nick_args, sizeof(mode_nick_args) / sizeof(command_arg)},
+    {"voice", (void (*)(Irc*, const char**, buffer_node_t*))handle_voice, mode_nick_args, sizeof(mode_nick_args) / sizeof(command_arg)},
+    {"devoice", (void (*)(Irc*, const char**, buffer_node_t*))handle_devoice, mode_nick_args, sizeof(mode_nick_args) / sizeof(command_arg)},
+    {"who", (void (*)(Irc*, const char**, buffer_node_t*))handle_who, who_args, sizeof(who_args) / sizeof(command_arg)}
 };
 
 const int num_command_defs = sizeof(command_defs) / sizeof(command_def);
 
+/**
+ * @brief Splits "a,b c" style arguments into one list of names.
+ * @return The number of names stored in names.
+ */
+static int collect_targets(const char **args, char *work, size_t work_size, const char **names, int max_names) {
+    int count = 0;
+    size_t offset = 0;
+    for (int i = 0; args[i] != NULL; i++) {
+        int written = snprintf(work + offset, work_size - offset, "%s%s", offset ? "," : "", args[i]);
+        if (written < 0 || (size_t)written >= work_size - offset) {
+            break;
+        }
+        offset += written;
+    }
+    char *rest = work;
+    char *token;
+    while (count < max_names && (token = strtok_r(rest, ",", &rest)) != NULL) {
+        names[count++] = token;
+    }
+    return count;
+}
+
 static void handle_join_command(Irc *irc, const char **args, buffer_node_t *active_buffer) {
     if (args[0] == NULL) {
         // In a real implementation, we would print an error to the server buffer
         return;
     }
-    char send_buf[MAX_MSG_LEN];
-    snprintf(send_buf, sizeof(send_buf), "JOIN %s\r\n", args[0]);
-    irc_send(irc, send_buf);
+    if (args[1] == NULL && strchr(args[0], ',') == NULL) {
+        char send_buf[MAX_MSG_LEN];
+        snprintf(send_buf, sizeof(send_buf), "JOIN %s\r\n", args[0]);
+        irc_send(irc, send_buf);
+        return;
+    }
+
+    // Several channels: let the server's TARGMAX decide how many per JOIN
+    char work[MAX_MSG_LEN * 2];
+    const char *channels[64];
+    int count = collect_targets(args, work, sizeof(work), channels, 64);
+    irc_send_list(irc, "JOIN", channels, count, NULL);
+}
+
+static void handle_msg(Irc *irc, const char **args, buffer_node_t *active_buffer) {
+    if (args[0] == NULL || args[1] == NULL) {
+        buffer_append_message(irc_get_status_buffer(irc), "Usage: /msg <target>[,<target>...] <message>");
+        return;
+    }
+
+    char text[MAX_MSG_LEN] = {0};
+    int offset = 0;
+    for (int i = 1; args[i] != NULL; i++) {
+        int written = snprintf(text + offset, sizeof(text) - offset, "%s%s", (i > 1 ? " " : ""), args[i]);
+        if (written < 0 || (size_t)written >= sizeof(text) - offset) {
+            break;
+        }
+        offset += written;
+    }
+
+    const char *first[2] = {args[0], NULL};
+    char work[MAX_MSG_LEN];
+    const char *targets[64];
+    int count = collect_targets(first, work, sizeof(work), targets, 64);
+    if (irc_send_list(irc, "PRIVMSG", targets, count, text) < 0) {
+        return;
+    }
+
+    // Show the message in any open buffer for its targets, unless the
+    // server echoes it back (echo-message)
+    if (!irc_cap_enabled(irc, IRC_CAP_ECHO_MESSAGE)) {
+        // Room for the nick as well as a full line of text
+        char formatted_msg[MAX_MSG_LEN * 2];
+        snprintf(formatted_msg, sizeof(formatted_msg), "<%s> %s", irc->nickname, text);
+        for (int i = 0; i < count; i++) {
+            buffer_node_t *buffer = get_buffer_by_name(irc, targets[i]);
+            if (buffer) {
+                buffer_append_message(buffer, formatted_msg);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Sends WHO for each target, several per line if the server's
+ * TARGMAX allows it. Flood control paces WHO as a bulk query.
+ */
+static void handle_who(Irc *irc, const char **args, buffer_node_t *active_buffer) {
+    if (args[0] == NULL) {
+        buffer_append_message(irc_get_status_buffer(irc), "Usage: /who <target>[,<target>...]");
+        return;
+    }
+    char work[MAX_MSG_LEN * 2];
+    const char *targets[64];
+    int count = collect_targets(args, work, sizeof(work), targets, 64);
+    irc_send_list(irc, "WHO", targets, count, NULL);
+}
+
+/**
+ * @brief Applies a prefix mode to the given nicks in the active channel,
+ * as few MODE lines as the server's MODES limit allows.
+ */
+static void handle_member_mode(Irc *irc, const char **args, buffer_node_t *active_buffer, bool adding, char mode,
+                               const char *usage) {
+    if (args[0] == NULL || !active_buffer || !irc_is_channel(irc, active_buffer->name)) {
+        buffer_append_message(irc_get_status_buffer(irc), usage);
+        return;
+    }
+    int count = 0;
+    while (args[count] != NULL) {
+        count++;
+    }
+    irc_send_modes(irc, active_buffer->name, adding, mode, args, count);
+}
+
+static void handle_op(Irc *irc, const char **args, buffer_node_t *active_buffer) {
+    handle_member_mode(irc, args, active_buffer, true, 'o', "Usage: /op <nickname>... (in a channel)");
+}
+
+static void handle_deop(Irc *irc, const char **args, buffer_node_t *active_buffer) {
+    handle_member_mode(irc, args, active_buffer, false, 'o', "Usage: /deop <nickname>... (in a channel)");
+}
+
+static void handle_voice(Irc *irc, const char **args, buffer_node_t *active_buffer) {
+    handle_member_mode(irc, args, active_buffer, true, 'v', "Usage: /voice <nickname>... (in a channel)");
+}
+
+static void handle_devoice(Irc *irc, const char **args, buffer_node_t *active_buffer) {
+    handle_member_mode(irc, args, active_buffer, false, 'v', "Usage: /devoice <nickname>... (in a channel)");
 }
 
 static void handle_part_command(Irc *irc, const char **args, buffer_node_t *active_buffer) {
@@ -66,13 +209,13 @@ static void handle_part_command(Irc *irc, const char **args, buffer_node_t *acti
     const char *part_message = "";
     int message_arg_start_index = -1;
 
-    if (args[0] && get_buffer_by_name(args[0]) != NULL) {
+    if (args[0] && get_buffer_by_name(irc, args[0]) != NULL) {
         // First argument is a channel
         channel_to_part = args[0];
         message_arg_start_index = 1;
     } else {
         // First argument is not a channel, or no arguments
-        if (active_buffer && active_buffer->name[0] == '#') {
+        if (active_buffer && irc_is_channel(irc, active_buffer->name)) {
             channel_to_part = active_buffer->name;
             if (args[0]) {
                 message_arg_start_index = 0;
@@ -80,15 +223,15 @@ static void handle_part_command(Irc *irc, const char **args, buffer_node_t *acti
         } else {
             // /part used in non-channel buffer. A channel must be specified.
             if (args[0] == NULL) {
-                buffer_append_message(get_buffer_by_name("status"), "Usage: /part [#channel] [message]");
+                buffer_append_message(irc_get_status_buffer(irc), "Usage: /part [#channel] [message]");
                 return;
             }
 
             // If we are here, it means args[0] was given, but it's not a valid channel
-            // because the initial check `get_buffer_by_name(args[0])` failed.
+            // because the initial check `get_buffer_by_name(irc, args[0])` failed.
             char error_msg[MAX_MSG_LEN];
             snprintf(error_msg, sizeof(error_msg), "Invalid channel: %s", args[0]);
-            buffer_append_message(get_buffer_by_name("status"), error_msg);
+            buffer_append_message(irc_get_status_buffer(irc), error_msg);
             return;
         }
     }
@@ -114,10 +257,10 @@ static void handle_part_command(Irc *irc, const char **args, buffer_node_t *acti
     // Log the command to the server buffer
     char log_msg[MAX_MSG_LEN];
     snprintf(log_msg, sizeof(log_msg), "--> PART %s (%s)", channel_to_part, part_message);
-    buffer_append_message(get_buffer_by_name("status"), log_msg);
+    buffer_append_message(irc_get_status_buffer(irc), log_msg);
 
     // Find and remove the buffer
-    buffer_node_t *buffer_to_remove = get_buffer_by_name(channel_to_part);
+    buffer_node_t *buffer_to_remove = get_buffer_by_name(irc, channel_to_part);
     if (buffer_to_remove) {
         remove_buffer(buffer_to_remove);
     }
@@ -125,7 +268,7 @@ static void handle_part_command(Irc *irc, const char **args, buffer_node_t *acti
 
 static void handle_nick(Irc *irc, const char **args, buffer_node_t *active_buffer) {
     if (args[0] == NULL) {
-        buffer_append_message(get_buffer_by_name("status"), "Usage: /nick <new_nickname>");
+        buffer_append_message(irc_get_status_buffer(irc), "Usage: /nick <new_nickname>");
         return;
     }
     char send_buf[MAX_MSG_LEN];
@@ -140,15 +283,18 @@ void parse_command(Irc *irc, const char *input, buffer_node_t *active_buffer) {
 
     if (input[1] == '/') {
         // Handle escaped slash command as a regular message
-        if (active_buffer && active_buffer->name[0] == '#') {
+        if (active_buffer && irc_is_channel(irc, active_buffer->name)) {
             char send_buf[MAX_MSG_LEN];
             snprintf(send_buf, sizeof(send_buf), "PRIVMSG %s :%s\r\n", active_buffer->name, input + 1);
             irc_send(irc, send_buf);
 
-            // Also append the message to the local buffer
-            char formatted_msg[MAX_MSG_LEN];
-            snprintf(formatted_msg, sizeof(formatted_msg), "<%s> %s", irc->nickname, input + 1);
-            buffer_append_message(active_buffer, formatted_msg);
+            // Also append the message to the local buffer, unless the
+            // server echoes it back (echo-message)
+            if (!irc_cap_enabled(irc, IRC_CAP_ECHO_MESSAGE)) {
+                char formatted_msg[MAX_MSG_LEN];
+                snprintf(formatted_msg, sizeof(formatted_msg), "<%s> %s", irc->nickname, input + 1);
+                buffer_append_message(active_buffer, formatted_msg);
+            }
         } else {
             // Send as a raw command
             char send_buf[MAX_MSG_LEN];
@@ -196,7 +342,7 @@ void parse_command(Irc *irc, const char *input, buffer_node_t *active_buffer) {
     if (!command_found) {
         char error_msg[MAX_MSG_LEN];
         snprintf(error_msg, sizeof(error_msg), "Unknown command: /%s", command_name);
-        buffer_append_message(get_buffer_by_name("status"), error_msg);
+        buffer_append_message(irc_get_status_buffer(irc), error_msg);
     }
 
     free(work_str);
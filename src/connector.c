@@ -0,0 +1,319 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <connector.h>
+#include <log.h>
+
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    int family;
+    int socktype;
+    int protocol;
+    char text[INET6_ADDRSTRLEN + 8]; // "[addr]:port" for log messages
+    int fd;                          // -1 when not in flight
+    long long started_ms;
+} connect_candidate_t;
+
+struct connector {
+    event_loop_t *loop;
+    char *label;
+    sockopt_t opts;
+    bool has_opts;
+    connector_cb cb;
+    void *data;
+
+    connect_candidate_t *candidates;
+    int count;
+    int next;       // Next candidate to start
+    int in_flight;  // Attempts currently waiting for the handshake
+
+    long attempt_timer;
+    long timeout_timer;
+    long long started_ms;
+};
+
+static void start_next_attempt(connector_t *conn);
+
+static void format_candidate(connect_candidate_t *cand) {
+    char host[INET6_ADDRSTRLEN] = "?";
+    int port = 0;
+    if (cand->family == AF_INET6) {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&cand->addr;
+        inet_ntop(AF_INET6, &sin6->sin6_addr, host, sizeof(host));
+        port = ntohs(sin6->sin6_port);
+        snprintf(cand->text, sizeof(cand->text), "[%s]:%d", host, port);
+    } else if (cand->family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&cand->addr;
+        inet_ntop(AF_INET, &sin->sin_addr, host, sizeof(host));
+        port = ntohs(sin->sin_port);
+        snprintf(cand->text, sizeof(cand->text), "%s:%d", host, port);
+    } else {
+        snprintf(cand->text, sizeof(cand->text), "family %d", cand->family);
+    }
+}
+
+/**
+ * Copies the resolver results, interleaving address families as described
+ * in RFC 8305 section 4, starting with the family of the first result.
+ */
+static int copy_candidates(connector_t *conn, const struct addrinfo *addrs) {
+    int total = 0;
+    for (const struct addrinfo *ai = addrs; ai; ai = ai->ai_next) {
+        total++;
+    }
+    if (total == 0) {
+        return -1;
+    }
+
+    conn->candidates = (connect_candidate_t *)calloc(total, sizeof(connect_candidate_t));
+    if (!conn->candidates) {
+        return -1;
+    }
+
+    int first_family = addrs->ai_family;
+    const struct addrinfo *preferred = addrs;
+    const struct addrinfo *other = addrs;
+    bool take_preferred = true;
+
+    while (conn->count < total) {
+        // Advance each cursor to its next matching entry
+        while (preferred && preferred->ai_family != first_family) preferred = preferred->ai_next;
+        while (other && other->ai_family == first_family) other = other->ai_next;
+
+        const struct addrinfo *pick;
+        if (take_preferred && preferred) {
+            pick = preferred;
+            preferred = preferred->ai_next;
+        } else if (other) {
+            pick = other;
+            other = other->ai_next;
+        } else {
+            pick = preferred;
+            preferred = preferred->ai_next;
+        }
+        take_preferred = !take_preferred;
+
+        connect_candidate_t *cand = &conn->candidates[conn->count++];
+        memcpy(&cand->addr, pick->ai_addr, pick->ai_addrlen);
+        cand->addr_len = pick->ai_addrlen;
+        cand->family = pick->ai_family;
+        cand->socktype = pick->ai_socktype;
+        cand->protocol = pick->ai_protocol;
+        cand->fd = -1;
+        format_candidate(cand);
+    }
+    return 0;
+}
+
+static void connector_free(connector_t *conn) {
+    for (int i = 0; i < conn->count; i++) {
+        connect_candidate_t *cand = &conn->candidates[i];
+        if (cand->fd >= 0) {
+            event_loop_remove_fd(conn->loop, cand->fd);
+            close(cand->fd);
+        }
+    }
+    event_loop_cancel_timer(conn->loop, conn->attempt_timer);
+    event_loop_cancel_timer(conn->loop, conn->timeout_timer);
+    free(conn->candidates);
+    free(conn->label);
+    free(conn);
+}
+
+static void connector_finish(connector_t *conn, int fd) {
+    connector_cb cb = conn->cb;
+    void *data = conn->data;
+    connector_free(conn);
+    cb(fd, data);
+}
+
+static void log_attempt_failure(connector_t *conn, connect_candidate_t *cand, int err) {
+    log_message("Connect %s: attempt to %s failed after %lld ms: %s", conn->label, cand->text,
+                event_loop_now_ms() - cand->started_ms, strerror(err));
+}
+
+static void attempt_failed(connector_t *conn, connect_candidate_t *cand, int err) {
+    log_attempt_failure(conn, cand, err);
+    event_loop_remove_fd(conn->loop, cand->fd);
+    close(cand->fd);
+    cand->fd = -1;
+    conn->in_flight--;
+
+    // A failure frees up a slot in the race, so there is no reason to wait
+    // out the attempt delay before trying the next address.
+    if (conn->next < conn->count || conn->in_flight == 0) {
+        start_next_attempt(conn);
+    }
+}
+
+static void attempt_ready_cb(event_loop_t *loop, int fd, int events, void *data) {
+    connector_t *conn = (connector_t *)data;
+    connect_candidate_t *cand = NULL;
+    for (int i = 0; i < conn->count; i++) {
+        if (conn->candidates[i].fd == fd) {
+            cand = &conn->candidates[i];
+            break;
+        }
+    }
+    if (!cand) {
+        return;
+    }
+
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0) {
+        err = errno;
+    }
+    if (err != 0) {
+        attempt_failed(conn, cand, err);
+        return;
+    }
+
+    long long now = event_loop_now_ms();
+    log_message("Connect %s: connected to %s in %lld ms (%lld ms since start, attempt %d of %d)", conn->label,
+                cand->text, now - cand->started_ms, now - conn->started_ms, (int)(cand - conn->candidates) + 1,
+                conn->count);
+
+    // Hand the winner over and let connector_free() close the losers
+    event_loop_remove_fd(conn->loop, fd);
+    cand->fd = -1;
+    conn->in_flight--;
+    for (int i = 0; i < conn->count; i++) {
+        if (conn->candidates[i].fd >= 0) {
+            log_message("Connect %s: abandoning attempt to %s after %lld ms", conn->label, conn->candidates[i].text,
+                        now - conn->candidates[i].started_ms);
+        }
+    }
+    connector_finish(conn, fd);
+}
+
+static void attempt_delay_cb(event_loop_t *loop, void *data) {
+    connector_t *conn = (connector_t *)data;
+    conn->attempt_timer = 0;
+    start_next_attempt(conn);
+}
+
+static void timeout_cb(event_loop_t *loop, void *data) {
+    connector_t *conn = (connector_t *)data;
+    conn->timeout_timer = 0;
+    log_message("Connect %s: timed out after %d ms", conn->label, CONNECTOR_TIMEOUT_MS);
+    connector_finish(conn, -1);
+}
+
+static void start_next_attempt(connector_t *conn) {
+    event_loop_cancel_timer(conn->loop, conn->attempt_timer);
+    conn->attempt_timer = 0;
+
+    while (conn->next < conn->count) {
+        connect_candidate_t *cand = &conn->candidates[conn->next++];
+        cand->started_ms = event_loop_now_ms();
+
+        int fd = socket(cand->family, cand->socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, cand->protocol);
+        if (fd < 0) {
+            log_attempt_failure(conn, cand, errno);
+            continue;
+        }
+
+        if (conn->has_opts) {
+            sockopt_apply(fd, &conn->opts, conn->label); // Failures are logged; connect anyway
+        }
+
+        if (connect(fd, (struct sockaddr *)&cand->addr, cand->addr_len) != 0 && errno != EINPROGRESS) {
+            log_attempt_failure(conn, cand, errno);
+            close(fd);
+            continue;
+        }
+
+        // Even an immediate success is reported through the loop so the
+        // callback never runs inside connector_start().
+        if (event_loop_add_fd(conn->loop, fd, EVENT_WRITE, attempt_ready_cb, conn) != 0) {
+            log_attempt_failure(conn, cand, EIO);
+            close(fd);
+            continue;
+        }
+        cand->fd = fd;
+        conn->in_flight++;
+        log_message("Connect %s: attempt %d of %d to %s started at +%lld ms", conn->label, conn->next, conn->count,
+                    cand->text, cand->started_ms - conn->started_ms);
+
+        if (conn->next < conn->count) {
+            conn->attempt_timer = event_loop_add_timer(conn->loop, CONNECTOR_ATTEMPT_DELAY_MS, 0, attempt_delay_cb, conn);
+        }
+        return;
+    }
+
+    if (conn->in_flight == 0) {
+        log_message("Connect %s: all %d addresses failed after %lld ms", conn->label, conn->count,
+                    event_loop_now_ms() - conn->started_ms);
+        connector_finish(conn, -1);
+    }
+}
+
+static void first_attempt_cb(event_loop_t *loop, void *data) {
+    start_next_attempt((connector_t *)data);
+}
+
+connector_t* connector_start(event_loop_t *loop, const struct addrinfo *addrs, const char *label,
+                             const sockopt_t *opts, connector_cb cb, void *data) {
+    if (!loop || !addrs || !cb) {
+        return NULL;
+    }
+
+    connector_t *conn = (connector_t *)calloc(1, sizeof(connector_t));
+    if (!conn) {
+        return NULL;
+    }
+    conn->loop = loop;
+    conn->cb = cb;
+    conn->data = data;
+    conn->label = strdup(label ? label : "");
+    conn->started_ms = event_loop_now_ms();
+    if (opts) {
+        conn->opts = *opts;
+        conn->has_opts = true;
+    }
+
+    if (!conn->label || copy_candidates(conn, addrs) != 0) {
+        free(conn->candidates);
+        free(conn->label);
+        free(conn);
+        return NULL;
+    }
+
+    conn->timeout_timer = event_loop_add_timer(loop, CONNECTOR_TIMEOUT_MS, 0, timeout_cb, conn);
+    conn->attempt_timer = event_loop_add_timer(loop, 0, 0, first_attempt_cb, conn);
+    return conn;
+}
+
+void connector_cancel(connector_t *conn) {
+    if (conn) {
+        connector_free(conn);
+    }
+}
@@ -0,0 +1,352 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include <event_loop.h>
+#include <log.h>
+
+#define EVENT_LOOP_MAX_EVENTS 64
+
+typedef struct {
+    event_fd_cb cb;
+    void *data;
+    int events;
+    uint32_t generation; // Bumped on every add/remove so stale events are ignored
+} fd_watch_t;
+
+typedef struct {
+    long id;
+    long long due_ms;
+    long interval_ms;
+    event_timer_cb cb;
+    void *data;
+} timer_entry_t;
+
+struct event_loop {
+    int epoll_fd;
+
+    // Watches are indexed directly by fd; lookups are O(1) and the table
+    // only grows to the highest fd ever registered.
+    fd_watch_t *watches;
+    int watch_capacity;
+
+    // Binary min-heap ordered by due_ms, then by id so that timers due at
+    // the same time fire in the order they were added
+    timer_entry_t *timers;
+    int timer_count;
+    int timer_capacity;
+    long next_timer_id;
+};
+
+long long event_loop_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint32_t to_epoll_events(int events) {
+    uint32_t ev = 0;
+    if (events & EVENT_READ) ev |= EPOLLIN;
+    if (events & EVENT_WRITE) ev |= EPOLLOUT;
+    return ev;
+}
+
+static int from_epoll_events(uint32_t ev) {
+    int events = 0;
+    if (ev & EPOLLIN) events |= EVENT_READ;
+    if (ev & EPOLLOUT) events |= EVENT_WRITE;
+    if (ev & (EPOLLERR | EPOLLHUP)) events |= EVENT_ERROR;
+    return events;
+}
+
+event_loop_t* event_loop_create(void) {
+    event_loop_t *loop = (event_loop_t*) calloc(1, sizeof(event_loop_t));
+    if (!loop) {
+        return NULL;
+    }
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        log_message("ERROR: epoll_create1 failed: %s", strerror(errno));
+        free(loop);
+        return NULL;
+    }
+    loop->next_timer_id = 1;
+    return loop;
+}
+
+void event_loop_destroy(event_loop_t *loop) {
+    if (!loop) {
+        return;
+    }
+    close(loop->epoll_fd);
+    free(loop->watches);
+    free(loop->timers);
+    free(loop);
+}
+
+static int ensure_watch_capacity(event_loop_t *loop, int fd) {
+    if (fd < loop->watch_capacity) {
+        return 0;
+    }
+    int new_capacity = loop->watch_capacity == 0 ? 64 : loop->watch_capacity;
+    while (new_capacity <= fd) {
+        new_capacity *= 2;
+    }
+    fd_watch_t *new_watches = (fd_watch_t*) realloc(loop->watches, new_capacity * sizeof(fd_watch_t));
+    if (!new_watches) {
+        return -1;
+    }
+    memset(new_watches + loop->watch_capacity, 0, (new_capacity - loop->watch_capacity) * sizeof(fd_watch_t));
+    loop->watches = new_watches;
+    loop->watch_capacity = new_capacity;
+    return 0;
+}
+
+int event_loop_add_fd(event_loop_t *loop, int fd, int events, event_fd_cb cb, void *data) {
+    if (!loop || fd < 0 || !cb) {
+        return -1;
+    }
+    if (ensure_watch_capacity(loop, fd) != 0) {
+        log_message("ERROR: Failed to grow fd watch table");
+        return -1;
+    }
+
+    fd_watch_t *watch = &loop->watches[fd];
+    watch->generation++;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = to_epoll_events(events);
+    ev.data.u64 = ((uint64_t)watch->generation << 32) | (uint32_t)fd;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        log_message("ERROR: epoll_ctl(ADD, %d) failed: %s", fd, strerror(errno));
+        return -1;
+    }
+
+    watch->cb = cb;
+    watch->data = data;
+    watch->events = events;
+    return 0;
+}
+
+int event_loop_modify_fd(event_loop_t *loop, int fd, int events) {
+    if (!loop || fd < 0 || fd >= loop->watch_capacity || !loop->watches[fd].cb) {
+        return -1;
+    }
+
+    fd_watch_t *watch = &loop->watches[fd];
+    if (watch->events == events) {
+        return 0;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = to_epoll_events(events);
+    ev.data.u64 = ((uint64_t)watch->generation << 32) | (uint32_t)fd;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) != 0) {
+        log_message("ERROR: epoll_ctl(MOD, %d) failed: %s", fd, strerror(errno));
+        return -1;
+    }
+    watch->events = events;
+    return 0;
+}
+
+void event_loop_remove_fd(event_loop_t *loop, int fd) {
+    if (!loop || fd < 0 || fd >= loop->watch_capacity || !loop->watches[fd].cb) {
+        return;
+    }
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    fd_watch_t *watch = &loop->watches[fd];
+    watch->cb = NULL;
+    watch->data = NULL;
+    watch->events = 0;
+    watch->generation++;
+}
+
+static void timer_heap_swap(event_loop_t *loop, int a, int b) {
+    timer_entry_t tmp = loop->timers[a];
+    loop->timers[a] = loop->timers[b];
+    loop->timers[b] = tmp;
+}
+
+static int timer_before(const timer_entry_t *a, const timer_entry_t *b) {
+    return a->due_ms < b->due_ms || (a->due_ms == b->due_ms && a->id < b->id);
+}
+
+static void timer_heap_up(event_loop_t *loop, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!timer_before(&loop->timers[i], &loop->timers[parent])) {
+            break;
+        }
+        timer_heap_swap(loop, parent, i);
+        i = parent;
+    }
+}
+
+static void timer_heap_down(event_loop_t *loop, int i) {
+    for (;;) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int smallest = i;
+        if (left < loop->timer_count && timer_before(&loop->timers[left], &loop->timers[smallest])) {
+            smallest = left;
+        }
+        if (right < loop->timer_count && timer_before(&loop->timers[right], &loop->timers[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        timer_heap_swap(loop, i, smallest);
+        i = smallest;
+    }
+}
+
+static void timer_heap_remove_at(event_loop_t *loop, int i) {
+    loop->timer_count--;
+    if (i == loop->timer_count) {
+        return;
+    }
+    loop->timers[i] = loop->timers[loop->timer_count];
+    timer_heap_up(loop, i);
+    timer_heap_down(loop, i);
+}
+
+static int timer_heap_push(event_loop_t *loop, const timer_entry_t *entry) {
+    if (loop->timer_count >= loop->timer_capacity) {
+        int new_capacity = loop->timer_capacity == 0 ? 16 : loop->timer_capacity * 2;
+        timer_entry_t *new_timers = (timer_entry_t*) realloc(loop->timers, new_capacity * sizeof(timer_entry_t));
+        if (!new_timers) {
+            return -1;
+        }
+        loop->timers = new_timers;
+        loop->timer_capacity = new_capacity;
+    }
+    loop->timers[loop->timer_count] = *entry;
+    timer_heap_up(loop, loop->timer_count);
+    loop->timer_count++;
+    return 0;
+}
+
+long event_loop_add_timer(event_loop_t *loop, long delay_ms, long interval_ms, event_timer_cb cb, void *data) {
+    if (!loop || !cb) {
+        return -1;
+    }
+    if (delay_ms < 0) {
+        delay_ms = 0;
+    }
+
+    timer_entry_t entry;
+    entry.id = loop->next_timer_id++;
+    entry.due_ms = event_loop_now_ms() + delay_ms;
+    entry.interval_ms = interval_ms > 0 ? interval_ms : 0;
+    entry.cb = cb;
+    entry.data = data;
+
+    if (timer_heap_push(loop, &entry) != 0) {
+        log_message("ERROR: Failed to grow timer heap");
+        return -1;
+    }
+    return entry.id;
+}
+
+void event_loop_cancel_timer(event_loop_t *loop, long timer_id) {
+    if (!loop || timer_id <= 0) {
+        return;
+    }
+    // Cancellation is rare compared to expiry, so a scan is acceptable here.
+    for (int i = 0; i < loop->timer_count; i++) {
+        if (loop->timers[i].id == timer_id) {
+            timer_heap_remove_at(loop, i);
+            return;
+        }
+    }
+}
+
+static int dispatch_timers(event_loop_t *loop) {
+    int dispatched = 0;
+    long long now = event_loop_now_ms();
+    // Ids are handed out in increasing order, so anything at or past this
+    // one was added by a callback during this pass.
+    long first_new_id = loop->next_timer_id;
+
+    // Only fire timers that existed and were due on entry. A callback that
+    // re-adds a 0ms timer (a connection yielding its read budget) then waits
+    // for the next iteration, after epoll_wait has served the other fds.
+    // Timers due at the same time are ordered by id, so the first new one at
+    // the top means every older due timer has already fired.
+    while (loop->timer_count > 0 && loop->timers[0].due_ms <= now && loop->timers[0].id < first_new_id) {
+        timer_entry_t entry = loop->timers[0];
+        if (entry.interval_ms > 0) {
+            // Reschedule before the callback so it may cancel itself by id
+            loop->timers[0].due_ms = now + entry.interval_ms;
+            timer_heap_down(loop, 0);
+        } else {
+            timer_heap_remove_at(loop, 0);
+        }
+        entry.cb(loop, entry.data);
+        dispatched++;
+    }
+    return dispatched;
+}
+
+int event_loop_run_once(event_loop_t *loop) {
+    int timeout = -1;
+    if (loop->timer_count > 0) {
+        long long wait = loop->timers[0].due_ms - event_loop_now_ms();
+        timeout = wait > 0 ? (int)wait : 0;
+    }
+
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    int n = epoll_wait(loop->epoll_fd, events, EVENT_LOOP_MAX_EVENTS, timeout);
+    if (n < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        log_message("ERROR: epoll_wait failed: %s", strerror(errno));
+        return -1;
+    }
+
+    int dispatched = 0;
+    for (int i = 0; i < n; i++) {
+        int fd = (int)(uint32_t)events[i].data.u64;
+        uint32_t generation = (uint32_t)(events[i].data.u64 >> 32);
+        if (fd >= loop->watch_capacity) {
+            continue;
+        }
+        fd_watch_t *watch = &loop->watches[fd];
+        // The watch may have been removed (or replaced) by an earlier callback
+        if (!watch->cb || watch->generation != generation) {
+            continue;
+        }
+        watch->cb(loop, fd, from_epoll_events(events[i].events), watch->data);
+        dispatched++;
+    }
+
+    dispatched += dispatch_timers(loop);
+    return dispatched;
+}
@@ -0,0 +1,167 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <flood.h>
+
+struct flood_msg {
+    struct flood_msg *next;
+    size_t len;
+    char data[];
+};
+
+static const char *urgent_commands[] = {
+    "PONG", "PING", "PASS", "NICK", "USER", "CAP", "AUTHENTICATE", "QUIT", NULL
+};
+
+static const char *bulk_commands[] = {
+    "WHO", "WHOIS", "WHOWAS", "MODE", "NAMES", "LIST", "CHATHISTORY", NULL
+};
+
+void flood_init(flood_t *flood, int burst, long long interval_ms) {
+    memset(flood, 0, sizeof(flood_t));
+    flood->burst = burst > 0 ? burst : 1;
+    flood->interval_ms = interval_ms > 0 ? interval_ms : 0;
+    flood->tokens = flood->burst;
+}
+
+void flood_clear(flood_t *flood) {
+    for (int p = 0; p < FLOOD_PRIORITY_COUNT; p++) {
+        flood_msg_t *msg = flood->head[p];
+        while (msg) {
+            flood_msg_t *next = msg->next;
+            free(msg);
+            msg = next;
+        }
+        flood->head[p] = NULL;
+        flood->tail[p] = NULL;
+    }
+    flood->depth = 0;
+    // The server's flood counter starts over with each connection
+    flood->tokens = flood->burst;
+    flood->refilled_ms = 0;
+}
+
+static bool command_in(const char *command, size_t len, const char **list) {
+    for (int i = 0; list[i]; i++) {
+        if (strlen(list[i]) == len && strncasecmp(command, list[i], len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+flood_priority_t flood_classify(const char *line, size_t len) {
+    size_t command_len = 0;
+    while (command_len < len && line[command_len] != ' ' && line[command_len] != '\r' && line[command_len] != '\n') {
+        command_len++;
+    }
+    if (command_in(line, command_len, urgent_commands)) {
+        return FLOOD_PRIORITY_URGENT;
+    }
+    if (command_in(line, command_len, bulk_commands)) {
+        return FLOOD_PRIORITY_BULK;
+    }
+    return FLOOD_PRIORITY_NORMAL;
+}
+
+int flood_push(flood_t *flood, flood_priority_t priority, const char *line, size_t len) {
+    flood_msg_t *msg = (flood_msg_t *)malloc(sizeof(flood_msg_t) + len);
+    if (!msg) {
+        return -1;
+    }
+    msg->next = NULL;
+    msg->len = len;
+    memcpy(msg->data, line, len);
+
+    if (flood->tail[priority]) {
+        flood->tail[priority]->next = msg;
+    } else {
+        flood->head[priority] = msg;
+    }
+    flood->tail[priority] = msg;
+    flood->depth++;
+    return 0;
+}
+
+static void flood_refill(flood_t *flood, long long now_ms) {
+    if (flood->refilled_ms == 0) {
+        flood->refilled_ms = now_ms;
+    }
+    if (flood->interval_ms > 0 && now_ms > flood->refilled_ms) {
+        flood->tokens += (double)(now_ms - flood->refilled_ms) / (double)flood->interval_ms;
+        if (flood->tokens > flood->burst) {
+            flood->tokens = flood->burst;
+        }
+    }
+    flood->refilled_ms = now_ms;
+}
+
+static int flood_pop_into(flood_t *flood, int priority, sendq_t *out) {
+    flood_msg_t *msg = flood->head[priority];
+    if (sendq_push(out, msg->data, msg->len) != 0) {
+        return -1;
+    }
+    flood->head[priority] = msg->next;
+    if (!flood->head[priority]) {
+        flood->tail[priority] = NULL;
+    }
+    flood->depth--;
+    flood->tokens -= 1.0;
+    free(msg);
+    return 0;
+}
+
+int flood_release(flood_t *flood, sendq_t *out, long long now_ms) {
+    flood_refill(flood, now_ms);
+
+    int released = 0;
+    while (flood->head[FLOOD_PRIORITY_URGENT]) {
+        if (flood_pop_into(flood, FLOOD_PRIORITY_URGENT, out) != 0) {
+            return -1;
+        }
+        released++;
+    }
+
+    for (int p = FLOOD_PRIORITY_NORMAL; p < FLOOD_PRIORITY_COUNT; p++) {
+        while (flood->head[p] && (flood->interval_ms == 0 || flood->tokens >= 1.0)) {
+            if (flood_pop_into(flood, p, out) != 0) {
+                return -1;
+            }
+            released++;
+        }
+        if (flood->head[p]) {
+            break; // Lower priorities wait behind this one
+        }
+    }
+    return released;
+}
+
+long long flood_next_release_ms(flood_t *flood, long long now_ms) {
+    if (flood->depth == 0) {
+        return -1;
+    }
+    flood_refill(flood, now_ms);
+    if (flood->head[FLOOD_PRIORITY_URGENT] || flood->interval_ms == 0 || flood->tokens >= 1.0) {
+        return 0;
+    }
+    double wait = (1.0 - flood->tokens) * (double)flood->interval_ms;
+    return (long long)wait + 1;
+}
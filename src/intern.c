@@ -0,0 +1,226 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <intern.h>
+
+void intern_init(intern_pool_t *pool, casemap_t casemap) {
+    memset(pool, 0, sizeof(intern_pool_t));
+    pool->casemap = casemap;
+    pool->entry_count = 1; // ID 0 means "none"
+}
+
+void intern_clear(intern_pool_t *pool) {
+    for (intern_id_t id = 1; id < pool->entry_count; id++) {
+        free(pool->entries[id].str);
+    }
+    free(pool->entries);
+    free(pool->free_ids);
+    free(pool->slots);
+    intern_init(pool, pool->casemap);
+}
+
+unsigned int intern_hash(const intern_pool_t *pool, const char *s, size_t len) {
+    return casemap_hash(pool->casemap, s, len);
+}
+
+void intern_prefetch(const intern_pool_t *pool, unsigned int hash) {
+    if (pool->slots) {
+        __builtin_prefetch(&pool->slots[hash & (unsigned int)(pool->slot_capacity - 1)]);
+    }
+}
+
+static void intern_place(intern_slot_t *slots, int capacity, intern_slot_t slot) {
+    int mask = capacity - 1;
+    int i = (int)(slot.hash & (unsigned int)mask);
+    while (slots[i].id) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+}
+
+/**
+ * @brief Makes room for one more name, doubling the table past 3/4 full.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int intern_reserve(intern_pool_t *pool) {
+    if (pool->slots && (pool->live + 1) * 4 <= pool->slot_capacity * 3) {
+        return 0;
+    }
+    int capacity = pool->slot_capacity ? pool->slot_capacity * 2 : INTERN_MIN_CAPACITY;
+    intern_slot_t *grown = (intern_slot_t *)calloc(capacity, sizeof(intern_slot_t));
+    if (!grown) {
+        return -1;
+    }
+    for (int i = 0; i < pool->slot_capacity; i++) {
+        if (pool->slots[i].id) {
+            intern_place(grown, capacity, pool->slots[i]);
+        }
+    }
+    free(pool->slots);
+    pool->slots = grown;
+    pool->slot_capacity = capacity;
+    return 0;
+}
+
+void intern_set_casemap(intern_pool_t *pool, casemap_t casemap) {
+    if (casemap == pool->casemap) {
+        return;
+    }
+    pool->casemap = casemap;
+    if (!pool->slots) {
+        return;
+    }
+    // Names that only now compare equal keep their own IDs; lookups find
+    // whichever comes first. Servers announce CASEMAPPING before any JOIN.
+    memset(pool->slots, 0, pool->slot_capacity * sizeof(intern_slot_t));
+    for (intern_id_t id = 1; id < pool->entry_count; id++) {
+        intern_entry_t *entry = &pool->entries[id];
+        if (entry->str) {
+            entry->hash = casemap_hash(casemap, entry->str, entry->len);
+            intern_place(pool->slots, pool->slot_capacity, (intern_slot_t){id, entry->hash});
+        }
+    }
+}
+
+intern_id_t intern_find_hashed(const intern_pool_t *pool, const char *s, size_t len, unsigned int hash) {
+    if (!pool->slots) {
+        return 0;
+    }
+    int mask = pool->slot_capacity - 1;
+    for (int i = (int)(hash & (unsigned int)mask); pool->slots[i].id; i = (i + 1) & mask) {
+        if (pool->slots[i].hash == hash) {
+            const intern_entry_t *entry = &pool->entries[pool->slots[i].id];
+            if (entry->len == len && casemap_equals(pool->casemap, s, len, entry->str)) {
+                return pool->slots[i].id;
+            }
+        }
+    }
+    return 0;
+}
+
+intern_id_t intern_find(const intern_pool_t *pool, const char *s, size_t len) {
+    return intern_find_hashed(pool, s, len, casemap_hash(pool->casemap, s, len));
+}
+
+/**
+ * @brief Takes a free ID, or a new one at the end of the entry array.
+ * @return The ID, or 0 on allocation failure.
+ */
+static intern_id_t intern_new_id(intern_pool_t *pool) {
+    if (pool->free_count > 0) {
+        return pool->free_ids[--pool->free_count];
+    }
+    if (pool->entry_count >= pool->entry_capacity) {
+        intern_id_t capacity = pool->entry_capacity ? pool->entry_capacity * 2 : INTERN_MIN_CAPACITY;
+        intern_entry_t *grown = (intern_entry_t *)realloc(pool->entries, capacity * sizeof(intern_entry_t));
+        if (!grown) {
+            return 0;
+        }
+        pool->entries = grown;
+        pool->entry_capacity = capacity;
+    }
+    return pool->entry_count++;
+}
+
+intern_id_t intern_acquire_hashed(intern_pool_t *pool, const char *s, size_t len, unsigned int hash) {
+    intern_id_t id = intern_find_hashed(pool, s, len, hash);
+    if (id) {
+        pool->entries[id].refs++;
+        return id;
+    }
+    if (intern_reserve(pool) != 0) {
+        return 0;
+    }
+    char *str = (char *)malloc(len + 1);
+    if (!str) {
+        return 0;
+    }
+    id = intern_new_id(pool);
+    if (!id) {
+        free(str);
+        return 0;
+    }
+    memcpy(str, s, len);
+    str[len] = '\0';
+    pool->entries[id] = (intern_entry_t){str, (unsigned int)len, hash, 1};
+    intern_place(pool->slots, pool->slot_capacity, (intern_slot_t){id, hash});
+    pool->live++;
+    return id;
+}
+
+intern_id_t intern_acquire(intern_pool_t *pool, const char *s, size_t len) {
+    return intern_acquire_hashed(pool, s, len, casemap_hash(pool->casemap, s, len));
+}
+
+void intern_retain(intern_pool_t *pool, intern_id_t id) {
+    if (id) {
+        pool->entries[id].refs++;
+    }
+}
+
+/**
+ * @brief Removes an ID from the table, shifting the following run back.
+ */
+static void intern_unplace(intern_pool_t *pool, intern_id_t id) {
+    int mask = pool->slot_capacity - 1;
+    int hole = (int)(pool->entries[id].hash & (unsigned int)mask);
+    while (pool->slots[hole].id != id) {
+        hole = (hole + 1) & mask;
+    }
+    for (int i = (hole + 1) & mask; pool->slots[i].id; i = (i + 1) & mask) {
+        int home = (int)(pool->slots[i].hash & (unsigned int)mask);
+        if (hole <= i ? (home <= hole || home > i) : (home <= hole && home > i)) {
+            pool->slots[hole] = pool->slots[i];
+            hole = i;
+        }
+    }
+    pool->slots[hole].id = 0;
+}
+
+void intern_release(intern_pool_t *pool, intern_id_t id) {
+    if (!id || --pool->entries[id].refs > 0) {
+        return;
+    }
+    if (pool->free_count == pool->free_capacity) {
+        intern_id_t capacity = pool->free_capacity ? pool->free_capacity * 2 : INTERN_MIN_CAPACITY;
+        intern_id_t *grown = (intern_id_t *)realloc(pool->free_ids, capacity * sizeof(intern_id_t));
+        if (!grown) {
+            pool->entries[id].refs = 1; // Keep the name rather than lose track of its ID
+            return;
+        }
+        pool->free_ids = grown;
+        pool->free_capacity = capacity;
+    }
+    intern_unplace(pool, id);
+    free(pool->entries[id].str);
+    pool->entries[id].str = NULL;
+    pool->free_ids[pool->free_count++] = id;
+    pool->live--;
+}
+
+void intern_respell(intern_pool_t *pool, intern_id_t id, const char *s, size_t len) {
+    if (id && pool->entries[id].len == len) {
+        memcpy(pool->entries[id].str, s, len); // Same length: folding maps byte to byte
+    }
+}
+
+const char* intern_str(const intern_pool_t *pool, intern_id_t id) {
+    return id ? pool->entries[id].str : "";
+}
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -26,434 +27,1956 @@
 #include <arpa/inet.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+#include <errno.h>
+#include <time.h>
 
 #include <irc.h>
+#include <connector.h>
+#include <resolver.h>
+#include <tls.h>
+#include <irc_message.h>
+#include <irc_dispatch.h>
+#include <isupport.h>
+#include <casemap.h>
 #include <log.h>
 #include <buffer.h>
-#include <ctype.h>
 #include <globals.h>
 
-#define RECV_BUFFER_INITIAL_CAPACITY 4096
+Irc *irc_list_head = NULL;
+
+static void irc_dispatch_setup(void);
 
 void irc_init(Irc *irc) {
     memset(irc, 0, sizeof(Irc));
     irc->state = IRC_STATE_DISCONNECTED;
+    irc->line_time_ms = -1;
 }
 
-int irc_connect(Irc *irc, const char *host, int port, const char *nick, const char *user, const char *realname, const char *channel, int use_ssl) {
+/**
+ * @brief Allocates and initializes a new network connection object.
+ * @param network The short name used to namespace the network's buffers.
+ * @return The new Irc object, or NULL on failure.
+ */
+Irc* irc_new(const char *network) {
+    Irc *irc = (Irc *)malloc(sizeof(Irc));
+    if (!irc) {
+        return NULL;
+    }
+    irc_dispatch_setup();
     irc_init(irc);
+    irc->tls_verify = true;
+    irc->ping_interval_ms = IRC_PING_INTERVAL_MS;
+    irc->ping_timeout_ms = IRC_PING_TIMEOUT_MS;
+    lag_init(&irc->lag);
+    sockopt_defaults(&irc->sockopts);
+    isupport_init(&irc->isupport);
+    intern_init(&irc->names, irc->isupport.casemapping);
+    members_init(&irc->members, &irc->names);
+    flood_init(&irc->flood, FLOOD_DEFAULT_BURST, FLOOD_DEFAULT_INTERVAL_MS);
+    irc->network = strdup(network);
+    if (!irc->network) {
+        free(irc);
+        return NULL;
+    }
+    return irc;
+}
+
+/**
+ * @brief Appends a network to the global network list.
+ * @param irc The network to add.
+ */
+void irc_list_add(Irc *irc) {
+    Irc **tail = &irc_list_head;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    irc->next = NULL;
+    *tail = irc;
+}
 
-    struct addrinfo hints, *res;
-    char port_str[6];
-    snprintf(port_str, sizeof(port_str), "%d", port);
+/**
+ * @brief Disconnects and frees every network in the global list.
+ */
+void irc_free_all(void) {
+    Irc *current = irc_list_head;
+    while (current) {
+        Irc *next = current->next;
+        irc_disconnect(current);
+        free(current->network);
+        free(current);
+        current = next;
+    }
+    irc_list_head = NULL;
+}
 
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
+/**
+ * @brief Returns the network's status buffer, creating it on first use.
+ * @param irc The network.
+ * @return The status buffer, or NULL on allocation failure.
+ */
+buffer_node_t* irc_get_status_buffer(Irc *irc) {
+    buffer_node_t *status_buf = get_buffer_by_name(irc, "status");
+    if (!status_buf) {
+        status_buf = create_buffer(irc, "status");
+        add_buffer(status_buf);
+    }
+    return status_buf;
+}
 
-    if (getaddrinfo(host, port_str, &hints, &res) != 0) {
-        log_message("ERROR: Failed to get address info");
+/**
+ * @brief Sends the registration burst as a single pipelined write.
+ *
+ * Registration does not depend on anything the server says first, so CAP LS,
+ * NICK and USER go out together as soon as the transport is up instead of
+ * waiting for the first line from the server. A server that supports CAP
+ * holds registration until CAP END; one that does not simply ignores it.
+ */
+static int irc_register(Irc *irc) {
+    char buf[MAX_MSG_LEN * 2];
+    snprintf(buf, sizeof(buf), "CAP LS 302\r\nNICK %s\r\nUSER %s 0 * :%s\r\n", irc->nickname, irc->username,
+             irc->realname);
+    irc->registration_sent_ms = event_loop_now_ms();
+    if (irc_send(irc, buf) < 0) {
+        log_message("ERROR: Failed to send registration");
         return -1;
     }
+    irc->state = IRC_STATE_CAP_NEGOTIATING;
+    return 0;
+}
+
+static void irc_io_cb(event_loop_t *loop, int fd, int events, void *data);
+static void irc_connection_lost(Irc *irc, const char *reason);
+static void irc_flush_timer_cb(event_loop_t *loop, void *data);
+static void irc_schedule_reconnect(Irc *irc);
+static void irc_schedule_drain(Irc *irc);
 
-    if ((irc->sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) < 0) {
-        log_message("ERROR: Failed to create socket");
-        freeaddrinfo(res);
+/**
+ * @brief Writes queued output and watches for writability while any is left.
+ * @return 0 on success (including data left for later), -1 on write error.
+ */
+static int irc_flush(Irc *irc) {
+    int chunks = irc->sendq.chunks;
+    size_t bytes = irc->sendq.bytes;
+    int writes = 0;
+    int ret = sendq_flush(&irc->sendq, irc->sock, irc->ssl, &writes);
+    if (ret < 0) {
+        log_message("ERROR: Failed to write to %s: %s", irc->network, irc->ssl ? "TLS error" : strerror(errno));
         return -1;
     }
+    if (chunks > 1) {
+        log_message("Flushed %zu of %zu bytes (%d messages) to %s in %d write(s)", bytes - irc->sendq.bytes, bytes,
+                    chunks, irc->network, writes);
+    }
+
+    bool want_write = ret == SENDQ_PENDING;
+    if (want_write != irc->want_write && irc->watching) {
+        event_loop_modify_fd(irc->loop, irc->sock, want_write ? EVENT_READ | EVENT_WRITE : EVENT_READ);
+        irc->want_write = want_write;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs the output pipeline once after delay_ms, or sooner if it is
+ * already scheduled sooner.
+ */
+static void irc_schedule_flush(Irc *irc, long long delay_ms) {
+    long long due = event_loop_now_ms() + delay_ms;
+    if (irc->flush_timer) {
+        if (irc->flush_due_ms <= due) {
+            return;
+        }
+        event_loop_cancel_timer(irc->loop, irc->flush_timer);
+    }
+    irc->flush_timer = event_loop_add_timer(irc->loop, delay_ms, 0, irc_flush_timer_cb, irc);
+    irc->flush_due_ms = due;
+}
 
-    if (connect(irc->sock, res->ai_addr, res->ai_addrlen) < 0) {
-        log_message("ERROR: Failed to connect to server");
-        freeaddrinfo(res);
+/**
+ * @brief Releases what flood control allows into the send queue, writes it
+ * and schedules the next release if messages are still held back.
+ * @return 0 on success, -1 on failure.
+ */
+static int irc_pump(Irc *irc) {
+    long long now = event_loop_now_ms();
+    if (flood_release(&irc->flood, &irc->sendq, now) < 0) {
+        log_message("ERROR: Failed to queue held messages for %s", irc->network);
+        return -1;
+    }
+    if (!irc->want_write && irc_flush(irc) != 0) {
         return -1;
     }
 
-    irc->state = IRC_STATE_CONNECTING;
+    long long wait = flood_next_release_ms(&irc->flood, now);
+    if (wait >= 0) {
+        irc_schedule_flush(irc, wait);
+    }
+    return 0;
+}
+
+static void irc_flush_timer_cb(event_loop_t *loop, void *data) {
+    Irc *irc = (Irc *)data;
+    irc->flush_timer = 0;
+    int depth = irc_queue_depth(irc);
+    if (irc_pump(irc) != 0) {
+        irc_connection_lost(irc, "Write error");
+        return;
+    }
+    // Keep the queue depth in the status bar current while it drains
+    if (depth != irc_queue_depth(irc) && irc->notify) {
+        irc->notify(irc, true);
+    }
+}
 
-    freeaddrinfo(res);
+/**
+ * @brief Stops the lag meter and logs what it measured on this connection.
+ */
+static void irc_lag_stop(Irc *irc) {
+    event_loop_cancel_timer(irc->loop, irc->ping_timer);
+    irc->ping_timer = 0;
+    event_loop_cancel_timer(irc->loop, irc->ping_timeout_timer);
+    irc->ping_timeout_timer = 0;
+    irc->ping_sent_ms = 0;
+    if (irc->lag.samples > 0) {
+        log_message("Lag on %s: p50 %lld ms, p99 %lld ms, max %lld ms over %lu PINGs", irc->network,
+                    lag_percentile(&irc->lag, 50), lag_percentile(&irc->lag, 99), irc->lag.max_ms, irc->lag.samples);
+    }
+}
 
-    irc->recv_buffer = (char *)malloc(RECV_BUFFER_INITIAL_CAPACITY);
-    if (!irc->recv_buffer) {
-        log_message("ERROR: Failed to allocate receive buffer");
+/**
+ * @brief Forgets outstanding history requests, which will not be answered.
+ */
+static void irc_history_cancel(Irc *irc) {
+    buffer_node_t *node = buffer_list_head;
+    do {
+        if (node && node->irc == irc) {
+            node->history_pending = false;
+        }
+        node = node ? node->next : NULL;
+    } while (node && node != buffer_list_head);
+}
+
+/**
+ * @brief Tears down the socket and TLS state but keeps the configuration.
+ * @param irc The network.
+ * @param graceful Whether to attempt a TLS close_notify first.
+ */
+static void irc_close_transport(Irc *irc, bool graceful) {
+    if (irc->resolve_req) {
+        resolver_cancel(irc->resolve_req);
+        irc->resolve_req = NULL;
+    }
+    if (irc->connector) {
+        connector_cancel(irc->connector);
+        irc->connector = NULL;
+    }
+    if (graceful && irc->state >= IRC_STATE_CONNECTED) {
+        // Best effort: whatever the socket takes right now, e.g. a QUIT
+        flood_release(&irc->flood, &irc->sendq, event_loop_now_ms());
+        sendq_flush(&irc->sendq, irc->sock, irc->ssl, NULL);
+    }
+    event_loop_cancel_timer(irc->loop, irc->flush_timer);
+    irc->flush_timer = 0;
+    event_loop_cancel_timer(irc->loop, irc->drain_timer);
+    irc->drain_timer = 0;
+    irc_lag_stop(irc);
+    sendq_clear(&irc->sendq);
+    flood_clear(&irc->flood);
+    irc_detach(irc);
+    irc->want_write = false;
+    // A partial line from the old connection must not prefix the new one
+    linebuf_reset(&irc->recvq);
+    // Capabilities, open batches and history requests belong to the connection
+    irc->caps_available = 0;
+    irc->caps_enabled = 0;
+    irc->open_batches = 0;
+    irc->sasl_in_progress = false;
+    irc->joined = false;
+    // The next server may differ, so forget what this one announced
+    casemap_t casemap = irc->isupport.casemapping;
+    isupport_init(&irc->isupport);
+    members_clear(&irc->members);
+    intern_clear(&irc->names);
+    intern_set_casemap(&irc->names, irc->isupport.casemapping);
+    if (irc->isupport.casemapping != casemap) {
+        buffer_reindex();
+    }
+    irc_history_cancel(irc);
+
+    if (irc->ssl) {
+        if (graceful) {
+            SSL_shutdown(irc->ssl);
+        }
+        SSL_free(irc->ssl);
+        irc->ssl = NULL;
+    }
+    if (irc->sock > 0) {
         close(irc->sock);
+        irc->sock = -1;
+    }
+    irc->state = IRC_STATE_DISCONNECTED;
+}
+
+static int irc_start_connect(Irc *irc);
+
+static void irc_reconnect_timer_cb(event_loop_t *loop, void *data) {
+    Irc *irc = (Irc *)data;
+    irc->reconnect_timer = 0;
+    log_message("Reconnecting to %s (attempt %d)", irc->network, irc->reconnect_attempts);
+    if (irc_start_connect(irc) != 0) {
+        irc_schedule_reconnect(irc);
+    }
+    if (irc->notify) {
+        irc->notify(irc, true);
+    }
+}
+
+/**
+ * @brief Arms the reconnect timer using jittered exponential backoff.
+ *
+ * The nominal delay doubles with every failed attempt; the actual delay is
+ * drawn from its upper half ("equal jitter").
+ */
+static void irc_schedule_reconnect(Irc *irc) {
+    if (irc->reconnect_timer) {
+        return;
+    }
+    long long delay = IRC_RECONNECT_INITIAL_MS;
+    for (int i = 0; i < irc->reconnect_attempts && delay < IRC_RECONNECT_MAX_MS; i++) {
+        delay *= 2;
+    }
+    if (delay > IRC_RECONNECT_MAX_MS) {
+        delay = IRC_RECONNECT_MAX_MS;
+    }
+    delay = delay / 2 + rand() % (delay / 2 + 1);
+    irc->reconnect_attempts++;
+
+    irc->reconnect_timer = event_loop_add_timer(irc->loop, delay, 0, irc_reconnect_timer_cb, irc);
+    if (irc->reconnect_timer <= 0) {
+        irc->reconnect_timer = 0;
+        log_message("ERROR: Failed to schedule reconnect to %s", irc->network);
+        return;
+    }
+
+    log_message("Reconnecting to %s in %lld ms (attempt %d)", irc->network, delay, irc->reconnect_attempts);
+    char msg[MAX_MSG_LEN];
+    snprintf(msg, sizeof(msg), "-!- Reconnecting in %.1f seconds", delay / 1000.0);
+    buffer_append_message(irc_get_status_buffer(irc), msg);
+}
+
+/**
+ * @brief Handles an unexpected end of the connection and tells the UI.
+ * @param irc The network.
+ * @param reason A short description for the log and status buffer.
+ */
+static void irc_connection_lost(Irc *irc, const char *reason) {
+    log_message("Connection to %s lost: %s", irc->network, reason);
+    char msg[MAX_MSG_LEN];
+    snprintf(msg, sizeof(msg), "-!- Disconnected: %s", reason);
+    buffer_append_message(irc_get_status_buffer(irc), msg);
+
+    irc_close_transport(irc, false);
+    if (irc->auto_reconnect) {
+        irc_schedule_reconnect(irc);
+    }
+    if (irc->notify) {
+        irc->notify(irc, true);
+    }
+}
+
+static void irc_log_ssl_errors(const char *what) {
+    unsigned long err;
+    char err_buf[256];
+    bool logged = false;
+    while ((err = ERR_get_error()) != 0) {
+        ERR_error_string_n(err, err_buf, sizeof(err_buf));
+        log_message("ERROR: %s: %s", what, err_buf);
+        logged = true;
+    }
+    if (!logged) {
+        log_message("ERROR: %s", what);
+    }
+}
+
+/**
+ * @brief Drives the non-blocking TLS handshake one step further.
+ * @return 0 if the handshake completed or is still in progress, -1 on failure.
+ */
+static int irc_tls_continue(Irc *irc) {
+    int ret = SSL_connect(irc->ssl);
+    if (ret == 1) {
+        char alpn[32];
+        log_message("TLS handshake with %s completed in %lld ms (%s, %s, ALPN %s, certificate %s)", irc->server,
+                    event_loop_now_ms() - irc->tls_started_ms, SSL_get_version(irc->ssl), SSL_get_cipher(irc->ssl),
+                    tls_alpn_protocol(irc->ssl, alpn, sizeof(alpn)), irc->tls_verify ? "verified" : "not verified");
+        tls_session_report(irc->ssl, irc->tls_session_offered);
+        event_loop_modify_fd(irc->loop, irc->sock, EVENT_READ);
+        irc->state = IRC_STATE_CONNECTED;
+        return irc_register(irc);
+    }
+
+    switch (SSL_get_error(irc->ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+            event_loop_modify_fd(irc->loop, irc->sock, EVENT_READ);
+            return 0;
+        case SSL_ERROR_WANT_WRITE:
+            event_loop_modify_fd(irc->loop, irc->sock, EVENT_WRITE);
+            return 0;
+        default: {
+            const char *verify_error = tls_verify_error(irc->ssl);
+            if (verify_error) {
+                char msg[MAX_MSG_LEN];
+                log_message("ERROR: Certificate verification for %s failed: %s", irc->server, verify_error);
+                snprintf(msg, sizeof(msg), "-!- Certificate verification for %s failed: %s (use verify=0 to skip)",
+                         irc->server, verify_error);
+                buffer_append_message(irc_get_status_buffer(irc), msg);
+            }
+            irc_log_ssl_errors("Failed to perform SSL handshake");
+            return -1;
+        }
+    }
+}
+
+static int irc_tls_start(Irc *irc) {
+    irc->ssl = tls_new_client(irc->server, irc->port, irc->tls_verify, &irc->tls_session_offered);
+    if (!irc->ssl) {
+        return -1;
+    }
+    SSL_set_fd(irc->ssl, irc->sock);
+    if (irc->tls_cert_file && tls_use_client_cert(irc->ssl, irc->tls_cert_file, irc->tls_key_file) != 0) {
+        // Connect anyway; SASL EXTERNAL will fail and say so
+        log_message("ERROR: Failed to use client certificate %s for %s", irc->tls_cert_file, irc->network);
+    }
+
+    irc->tls_started_ms = event_loop_now_ms();
+    irc->state = IRC_STATE_TLS_HANDSHAKE;
+    return irc_tls_continue(irc);
+}
+
+static void irc_connected_cb(int fd, void *data) {
+    Irc *irc = (Irc *)data;
+    irc->connector = NULL;
+
+    if (fd < 0) {
+        irc_connection_lost(irc, "Failed to connect");
+        return;
+    }
+
+    irc->sock = fd;
+    sockopt_log_effective(fd, irc->network);
+    if (event_loop_add_fd(irc->loop, fd, EVENT_READ, irc_io_cb, irc) != 0) {
+        irc_connection_lost(irc, "Failed to watch socket");
+        return;
+    }
+    irc->watching = true;
+
+    int ret;
+    if (irc->use_ssl) {
+        ret = irc_tls_start(irc);
+    } else {
+        irc->state = IRC_STATE_CONNECTED;
+        ret = irc_register(irc);
+    }
+    if (ret != 0) {
+        irc_connection_lost(irc, irc->use_ssl ? "TLS handshake failed" : "Registration failed");
+        return;
+    }
+
+    if (irc->notify) {
+        irc->notify(irc, true);
+    }
+}
+
+static void irc_resolved_cb(const struct addrinfo *res, int error, bool from_cache, void *data) {
+    Irc *irc = (Irc *)data;
+    irc->resolve_req = NULL;
+
+    if (error != 0) {
+        char reason[MAX_MSG_LEN];
+        snprintf(reason, sizeof(reason), "Failed to resolve %s: %s", irc->server, gai_strerror(error));
+        irc_connection_lost(irc, reason);
+        return;
+    }
+
+    irc->connector = connector_start(irc->loop, res, irc->server, &irc->sockopts, irc_connected_cb, irc);
+    if (!irc->connector) {
+        irc_connection_lost(irc, "Failed to start connecting");
+    }
+}
+
+/**
+ * @brief Starts connecting a network. Name resolution runs on a resolver
+ * thread and the connection completes asynchronously on the given event
+ * loop, racing every resolved address (Happy Eyeballs). If the connection
+ * is lost later, it is re-established automatically with backoff.
+ * @return 0 if the attempt was started, -1 on immediate failure.
+ */
+int irc_connect(Irc *irc, event_loop_t *loop, const char *host, int port, const char *nick, const char *user, const char *realname, const char *channel, int use_ssl) {
+    irc->loop = loop;
+
+    if (linebuf_init(&irc->recvq, IRC_RECV_BUFFER_SIZE, IRC_MAX_LINE_LEN) != 0) {
+        log_message("ERROR: Failed to allocate receive buffer");
         return -1;
     }
-    irc->recv_buffer_capacity = RECV_BUFFER_INITIAL_CAPACITY;
-    irc->recv_buffer_len = 0;
 
     irc->nickname = strdup(nick);
     irc->username = strdup(user);
     irc->realname = strdup(realname);
     irc->channel = strdup(channel);
     irc->server = strdup(host);
+    irc->port = port;
+    irc->use_ssl = use_ssl;
+    irc->auto_reconnect = true;
 
-    if (use_ssl) {
-        SSL_library_init();
-        OpenSSL_add_all_algorithms();
-        SSL_load_error_strings();
-
-        irc->ctx = SSL_CTX_new(TLS_client_method());
-        if (irc->ctx == NULL) {
-            log_message("ERROR: Failed to create SSL context");
-            ERR_print_errors_fp(stderr);
-            return -1;
-        }
-
-        irc->ssl = SSL_new(irc->ctx);
-        SSL_set_fd(irc->ssl, irc->sock);
+    return irc_start_connect(irc);
+}
 
-        if (SSL_connect(irc->ssl) <= 0) {
-            log_message("ERROR: Failed to perform SSL handshake");
-            ERR_print_errors_fp(stderr);
-            return -1;
-        }
+/**
+ * @brief Starts resolving and connecting with the stored configuration.
+ * Used for the first connection and for every reconnect.
+ */
+static int irc_start_connect(Irc *irc) {
+    irc->connect_started_ms = event_loop_now_ms();
+    irc->resolve_req = resolver_lookup(irc->server, irc->port, irc_resolved_cb, irc);
+    if (!irc->resolve_req) {
+        log_message("ERROR: Failed to start resolving %s", irc->server);
+        return -1;
     }
 
-    irc->state = IRC_STATE_CONNECTED;
+    irc->state = IRC_STATE_CONNECTING;
     return 0;
 }
 
 void irc_disconnect(Irc *irc) {
+    irc->auto_reconnect = false;
+    event_loop_cancel_timer(irc->loop, irc->reconnect_timer);
+    irc->reconnect_timer = 0;
+    irc_close_transport(irc, true);
+
     if (irc->nickname) free(irc->nickname);
     if (irc->username) free(irc->username);
     if (irc->realname) free(irc->realname);
     if (irc->channel) free(irc->channel);
     if (irc->server) free(irc->server);
+    irc->nickname = NULL;
+    irc->username = NULL;
+    irc->realname = NULL;
+    irc->channel = NULL;
+    irc->server = NULL;
 
-    if (irc->ssl) {
-        SSL_shutdown(irc->ssl);
-        SSL_free(irc->ssl);
-    }
-    if (irc->ctx) {
-        SSL_CTX_free(irc->ctx);
+    linebuf_free(&irc->recvq);
+}
+
+/**
+ * @brief Queues lines like irc_send() but without logging or echoing them,
+ * for data such as credentials or the periodic lag PING.
+ */
+static int irc_send_quiet(Irc *irc, const char *data) {
+    if (irc->state < IRC_STATE_CONNECTED) {
+        log_message("ERROR: Not connected to %s, dropping message", irc->network);
+        return -1;
     }
-    if (irc->sock > 0) {
-        close(irc->sock);
+
+    // Each line is classified on its own so a PONG never waits behind chat
+    const char *line = data;
+    while (*line) {
+        const char *newline = strstr(line, "\r\n");
+        size_t line_len = newline ? (size_t)(newline - line) + 2 : strlen(line);
+        if (flood_push(&irc->flood, flood_classify(line, line_len), line, line_len) != 0) {
+            log_message("ERROR: Failed to queue message for %s", irc->network);
+            return -1;
+        }
+        line += line_len;
     }
-    if (irc->recv_buffer) {
-        free(irc->recv_buffer);
-        irc->recv_buffer = NULL;
+
+    // Everything sent during this wakeup goes out together once the
+    // current callbacks are done, unless flood control holds it back.
+    long long wait = flood_next_release_ms(&irc->flood, event_loop_now_ms());
+    if (wait >= 0) {
+        irc_schedule_flush(irc, wait);
     }
+    return 0;
 }
 
+/**
+ * @brief Queues one or more CRLF-terminated lines for the server.
+ *
+ * Nothing is written here. Lines pass flood control (see flood.h), and
+ * those released during one wakeup leave in a single write.
+ *
+ * @return 0 if the data was queued, -1 on failure.
+ */
 int irc_send(Irc *irc, const char *data) {
     log_message("SEND: %s", data);
-    buffer_node_t *status_buf = get_buffer_by_name("status");
+    buffer_node_t *status_buf = irc_get_status_buffer(irc);
     if (status_buf) {
-        char formatted_msg[MAX_MSG_LEN];
-        snprintf(formatted_msg, sizeof(formatted_msg), "-> %s", data);
-        // Remove trailing \r\n for display
-        char *newline = strstr(formatted_msg, "\r\n");
-        if (newline) {
-            *newline = '\0';
+        // Pipelined writes may carry several lines; echo each one separately
+        const char *line = data;
+        while (*line) {
+            const char *newline = strstr(line, "\r\n");
+            int line_len = newline ? (int)(newline - line) : (int)strlen(line);
+            char formatted_msg[MAX_MSG_LEN];
+            snprintf(formatted_msg, sizeof(formatted_msg), "-> %.*s", line_len, line);
+            buffer_append_message(status_buf, formatted_msg);
+            if (!newline) {
+                break;
+            }
+            line = newline + 2;
         }
-        buffer_append_message(status_buf, formatted_msg);
     }
+    return irc_send_quiet(irc, data);
+}
 
-    if (irc->ssl) {
-        return SSL_write(irc->ssl, data, strlen(data));
-    } else {
-        return send(irc->sock, data, strlen(data), 0);
+/**
+ * @brief Returns the number of messages queued but not yet written.
+ */
+int irc_queue_depth(Irc *irc) {
+    return irc->flood.depth + sendq_depth(&irc->sendq);
+}
+
+/**
+ * @brief Returns the current lag in ms, or -1 if it has not been measured.
+ *
+ * While a PING is outstanding for longer than the last round trip took, the
+ * time it has been waiting is reported, so a stalling connection shows up
+ * before its PONG (or the timeout) arrives.
+ */
+long long irc_lag_ms(Irc *irc) {
+    if (irc->state != IRC_STATE_REGISTERED) {
+        return -1;
+    }
+    long long lag = irc->lag.last_ms;
+    if (irc->ping_sent_ms) {
+        long long waiting = event_loop_now_ms() - irc->ping_sent_ms;
+        if (waiting > lag) {
+            lag = waiting;
+        }
     }
+    return lag;
 }
 
-int irc_process_buffer(Irc *irc, bool *needs_refresh, char *out_command_buf, int out_command_buf_size) {
-    char *current_pos = irc->recv_buffer;
-    char *line_end;
-    int lines_processed = 0;
-    *needs_refresh = false; // Initialize output parameter
+static void irc_ping_timeout_cb(event_loop_t *loop, void *data) {
+    Irc *irc = (Irc *)data;
+    irc->ping_timeout_timer = 0;
+    log_message("No PONG from %s within %lld ms, assuming the connection is dead", irc->network,
+                irc->ping_timeout_ms);
+    irc_connection_lost(irc, "Ping timeout");
+}
 
-    while ((line_end = strstr(current_pos, "\r\n")) != NULL) {
-        lines_processed++;
-        *line_end = '\0'; // Null-terminate the current line
-        char *parse_line = current_pos;
+static void irc_ping_timer_cb(event_loop_t *loop, void *data) {
+    Irc *irc = (Irc *)data;
+    if (irc->ping_sent_ms) {
+        return; // Still waiting; the timeout decides
+    }
+    long long now = event_loop_now_ms();
+    char buf[64];
+    snprintf(buf, sizeof(buf), "PING :" IRC_PING_TOKEN_PREFIX "%lld\r\n", now);
+    // The probe repeats for as long as the connection lasts; keep it out of scrollback
+    if (irc_send_quiet(irc, buf) < 0) {
+        return;
+    }
+    irc->ping_sent_ms = now;
+    irc->ping_timeout_timer = event_loop_add_timer(irc->loop, irc->ping_timeout_ms, 0, irc_ping_timeout_cb, irc);
+}
 
-        // Always append the raw incoming line to the status buffer
-        buffer_node_t *status_buf = get_buffer_by_name("status");
-        if (status_buf) {
-            buffer_append_message(status_buf, parse_line);
-            if (status_buf == active_buffer) {
-                *needs_refresh = true;
-            }
-        }
+/**
+ * @brief Starts measuring lag on a freshly registered connection.
+ */
+static void irc_lag_start(Irc *irc) {
+    lag_init(&irc->lag);
+    if (irc->ping_interval_ms > 0) {
+        irc->ping_timer = event_loop_add_timer(irc->loop, irc->ping_interval_ms, irc->ping_interval_ms,
+                                               irc_ping_timer_cb, irc);
+    }
+}
 
-        // Handle PING requests
-        if (strncmp(parse_line, "PING :", 6) == 0) {
-            char pong_buf[512];
-            snprintf(pong_buf, sizeof(pong_buf), "PONG :%s\r\n", parse_line + 6);
-            irc_send(irc, pong_buf);
-        } else {
-            // Parse IRC message to determine target buffer
-            char *prefix = NULL; // Will point to the start of the prefix in parse_line (if any)
-            char *command_start_ptr = NULL; // Will point to the start of the command in parse_line
-            char *params_start_ptr = NULL; // Will point to the start of the parameters in parse_line
-
-            // 1. Check if the message starts with a prefix (i.e., the first character is a colon).
-            if (parse_line[0] == ':') {
-                prefix = parse_line + 1; // Prefix starts after the colon
-                char *space_after_prefix = strchr(prefix, ' ');
-                if (space_after_prefix) {
-                    *space_after_prefix = '\0'; // Null-terminate the prefix in parse_line for later use
-                    // 2. If a prefix exists, find the first space after the prefix to locate the beginning of the command.
-                    command_start_ptr = space_after_prefix + 1;
-                    // Skip any additional spaces after the first one
-                    while (*command_start_ptr == ' ') {
-                        command_start_ptr++;
-                    }
-                } else {
-                    // Malformed message: prefix but no space, so no command or params.
-                    // The raw line is already appended to status_buf.
-                    current_pos = line_end + 2;
-                    continue;
-                }
-            } else {
-                // 3. If there's no prefix, the command starts at the beginning of the message.
-                command_start_ptr = parse_line;
-                // Skip any leading spaces before the command
-                while (*command_start_ptr == ' ') {
-                    command_start_ptr++;
-                }
-            }
+/**
+ * @brief Returns whether the server acknowledged the given irc_cap_t bits.
+ */
+bool irc_cap_enabled(Irc *irc, unsigned cap) {
+    return irc && (irc->caps_enabled & cap) == cap;
+}
 
-            // Ensure command_start_ptr is valid (not pointing to null terminator or empty string)
-            if (*command_start_ptr == '\0') {
-                current_pos = line_end + 2;
-                continue;
-            }
+/**
+ * @brief The number of messages to ask for per CHATHISTORY request, capped by
+ * the server's advertised limit.
+ */
+static int irc_history_page_size(Irc *irc) {
+    int limit = irc->isupport.chathistory;
+    return limit > 0 && limit < IRC_HISTORY_PAGE_SIZE ? limit : IRC_HISTORY_PAGE_SIZE;
+}
+
+/**
+ * @brief Asks the server for the page of history before a buffer's oldest line.
+ *
+ * Nothing is fetched up front; the UI calls this when the reader scrolls to
+ * the top of a buffer. At most one request per buffer is in flight, and the
+ * reply arrives as a chathistory batch whose lines are placed by server-time.
+ *
+ * @return 0 if a request was sent, -1 if there is nothing to request.
+ */
+int irc_request_history(Irc *irc, buffer_node_t *buffer) {
+    if (!irc || !buffer || buffer->irc != irc || irc->state != IRC_STATE_REGISTERED ||
+        !irc_cap_enabled(irc, IRC_CAP_CHATHISTORY | IRC_CAP_BATCH | IRC_CAP_SERVER_TIME)) {
+        return -1;
+    }
+    if (buffer->history_pending || buffer->history_complete || strcmp(buffer->name, "status") == 0) {
+        return -1;
+    }
 
-            // 4. Once the command is located, find the next space to determine its end.
-            char *space_after_command = strchr(command_start_ptr, ' ');
-            size_t command_len;
+    char buf[MAX_MSG_LEN];
+    if (buffer->line_count == 0) {
+        snprintf(buf, sizeof(buf), "CHATHISTORY LATEST %s * %d\r\n", buffer->name, irc_history_page_size(irc));
+    } else {
+        long long oldest_ms = buffer->times[0];
+        time_t seconds = (time_t)(oldest_ms / 1000);
+        struct tm tm;
+        gmtime_r(&seconds, &tm);
+        snprintf(buf, sizeof(buf), "CHATHISTORY BEFORE %s timestamp=%04d-%02d-%02dT%02d:%02d:%02d.%03dZ %d\r\n",
+                 buffer->name, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                 (int)(oldest_ms % 1000), irc_history_page_size(irc));
+    }
+    if (irc_send(irc, buf) < 0) {
+        return -1;
+    }
+    buffer->history_pending = true;
+    return 0;
+}
 
-            if (space_after_command) {
-                command_len = space_after_command - command_start_ptr;
-                params_start_ptr = space_after_command + 1;
-                // Skip leading spaces for params
-                while (*params_start_ptr == ' ') {
-                    params_start_ptr++;
-                }
-            } else {
-                command_len = strlen(command_start_ptr);
-                params_start_ptr = NULL; // No parameters
-            }
+/**
+ * @brief Returns whether a name is a channel on this network (CHANTYPES).
+ */
+bool irc_is_channel(Irc *irc, const char *name) {
+    return name && isupport_is_channel(&irc->isupport, name, strlen(name));
+}
 
-            // 5. Copy the command into out_command_buf.
-            // This out_command_buf will be used for strcmp checks later.
-            if (out_command_buf && command_start_ptr) {
-                if (command_len >= out_command_buf_size) {
-                    command_len = out_command_buf_size - 1; // Truncate if too long
-                }
-                strncpy(out_command_buf, command_start_ptr, command_len);
-                out_command_buf[command_len] = '\0'; // Null-terminate the command
-                log_message("DEBUG: Parsed command: [%s]", out_command_buf);
-            }
+static bool irc_slice_is_channel(Irc *irc, irc_slice_t name) {
+    return isupport_is_channel(&irc->isupport, name.ptr, name.len);
+}
 
-            // Set the 'command' and 'params' pointers for the rest of the irc_recv logic.
-            char *command = out_command_buf; // Use the null-terminated extracted command
-            char *params = params_start_ptr; // Use the determined params_start_ptr
-            if (space_after_command) {
-                params = space_after_command + 1;
-            }
+/**
+ * @brief Compares a name from a message with our nick under the server's casemapping.
+ */
+static bool irc_is_me(Irc *irc, irc_slice_t nick) {
+    return nick.len > 0 && irc->nickname && casemap_equals(irc->isupport.casemapping, nick.ptr, nick.len, irc->nickname);
+}
 
-            if (irc->state == IRC_STATE_REGISTERING && (strcmp(command, "001") == 0 || strcmp(command, "376") == 0)) {
-                char buf[512];
-                snprintf(buf, sizeof(buf), "JOIN %s\r\n", irc->channel);
-                if (irc_send(irc, buf) < 0) {
-                    log_message("ERROR: Failed to send JOIN");
-                }
-                irc->state = IRC_STATE_REGISTERED;
+/**
+ * @brief Sends a command to many targets in as few lines as the server allows.
+ *
+ * Targets are joined with commas, up to the command's TARGMAX (see
+ * isupport_targmax()) and the 512 byte line limit, and each line carries
+ * the same trailing parameter, if any.
+ *
+ * @return The number of lines sent, or -1 on failure.
+ */
+int irc_send_list(Irc *irc, const char *command, const char *const *targets, int count, const char *trailing) {
+    int limit = isupport_targmax(&irc->isupport, command);
+    size_t tail_len = trailing ? strlen(trailing) + 2 : 0; // " :" plus the text
+    char buf[MAX_MSG_LEN];
+    size_t len = 0;
+    int in_line = 0;
+    int lines = 0;
+
+    for (int i = 0; i <= count; i++) {
+        size_t target_len = i < count ? strlen(targets[i]) : 0;
+        bool full = in_line > 0 && (i == count || (limit > 0 && in_line == limit) ||
+                                    len + 1 + target_len + tail_len + 2 > sizeof(buf) - 1);
+        if (full) {
+            snprintf(buf + len, sizeof(buf) - len, "%s%s\r\n", trailing ? " :" : "", trailing ? trailing : "");
+            if (irc_send(irc, buf) < 0) {
+                return -1;
             }
+            lines++;
+            len = 0;
+            in_line = 0;
+        }
+        if (i == count) {
+            break;
+        }
+        if (strlen(command) + 1 + target_len + tail_len + 2 > sizeof(buf) - 1) {
+            log_message("ERROR: %s target too long for one line on %s, skipping", command, irc->network);
+            continue;
+        }
+        len += (size_t)snprintf(buf + len, sizeof(buf) - len, in_line == 0 ? "%s %s" : ",%s",
+                                in_line == 0 ? command : targets[i], targets[i]);
+        in_line++;
+    }
+    return lines;
+}
 
-            buffer_node_t *target_buffer = NULL;
-
-            if (strcmp(command, "PRIVMSG") == 0 && params) {
-                char *target = params;
-                char *message_start = strchr(params, ':');
-                if (message_start) {
-                    *message_start = '\0';
-                    message_start++;
-                    
-                    // Trim target whitespace
-                    while (isspace((unsigned char)*target)) target++;
-                    char *end = target + strlen(target) - 1;
-                    while (end > target && isspace((unsigned char)*end)) end--;
-                    *(end + 1) = '\0';
-
-                    // Determine target buffer
-                    if (target[0] == '#') { // Channel message
-                        target_buffer = get_buffer_by_name(target);
-                        if (!target_buffer) {
-                            target_buffer = create_buffer(target);
-                            add_buffer(target_buffer);
-                        }
-                    } else if (strcmp(target, irc->nickname) == 0) { // Private message to us
-                        // Use sender's nick as buffer name
-                        char *sender_nick = prefix;
-                        if (sender_nick) {
-                            char *excl = strchr(sender_nick, '!');
-                            if (excl) *excl = '\0'; // Trim hostname
-                            target_buffer = get_buffer_by_name(sender_nick);
-                            if (!target_buffer) {
-                                target_buffer = create_buffer(sender_nick);
-                                add_buffer(target_buffer);
-                            }
-                        }
-                    } else { // Fallback to status buffer for unknown targets
-                        target_buffer = get_buffer_by_name("status");
-                    }
-                    
-                    if (target_buffer) {
-                        char formatted_msg[MAX_MSG_LEN];
-                        if (prefix) {
-                            char *nick_only = prefix;
-                            char *excl = strchr(nick_only, '!');
-                            if (excl) *excl = '\0';
-                            snprintf(formatted_msg, sizeof(formatted_msg), "<%s> %s", nick_only, message_start);
-                        } else {
-                            snprintf(formatted_msg, sizeof(formatted_msg), "%s", message_start);
-                        }
-                        // Only append to target buffer if it's not the status buffer
-                        // as the raw line is already appended to status buffer
-                        if (target_buffer != status_buf) {
-                            buffer_append_message(target_buffer, formatted_msg);
-                            if (target_buffer == active_buffer) {
-                                *needs_refresh = true;
-                            }
-                        }
-                    }
-                }
-            } else if (strcmp(command, "JOIN") == 0 && params) {
-                char *joined_channel_param = params;
-                if (joined_channel_param[0] == ':') {
-                    joined_channel_param++;
-                }
+/**
+ * @brief Applies one mode letter to many arguments, e.g. +o for several nicks.
+ *
+ * Changes are packed up to the server's MODES limit per line. For list
+ * modes such as +b, no more entries are sent than MAXLIST allows.
+ *
+ * @return The number of lines sent, or -1 on failure.
+ */
+int irc_send_modes(Irc *irc, const char *channel, bool adding, char mode, const char *const *args, int count) {
+    if (!isupport_mode_has_param(&irc->isupport, mode, adding)) {
+        log_message("ERROR: Mode %c takes no parameter on %s", mode, irc->network);
+        return -1;
+    }
+    int maxlist = isupport_maxlist(&irc->isupport, mode);
+    if (adding && maxlist > 0 && count > maxlist) {
+        log_message("MAXLIST on %s allows %d entries for +%c, dropping %d", irc->network, maxlist, mode,
+                    count - maxlist);
+        count = maxlist;
+    }
+    int per_line = irc->isupport.modes > 0 ? irc->isupport.modes : count;
 
-                char *sender_nick = prefix;
-                if (sender_nick) {
-                    char *excl = strchr(sender_nick, '!');
-                    if (excl) *excl = '\0';
-                    if (strcmp(sender_nick, irc->nickname) == 0) {
-                        buffer_node_t *channel_buffer = get_buffer_by_name(joined_channel_param);
-                        if (!channel_buffer) {
-                            channel_buffer = create_buffer(joined_channel_param);
-                            add_buffer(channel_buffer);
-                            set_active_buffer(channel_buffer);
-                        }
-                    }
-
-                    buffer_node_t *channel_buffer = get_buffer_by_name(joined_channel_param);
-                    if (channel_buffer) {
-                        char join_msg[MAX_MSG_LEN];
-                        snprintf(join_msg, sizeof(join_msg), "%s has joined %s", sender_nick, joined_channel_param);
-                        buffer_append_message(channel_buffer, join_msg);
-                        if (channel_buffer == active_buffer) {
-                            *needs_refresh = true;
-                        }
-                    }
-                }
-            } else if (strcmp(command, "NOTICE") == 0 && params) {
-                // Notices are typically sent to the server buffer
-                buffer_node_t *server_buffer = get_buffer_by_name("status");
-                if (server_buffer) {
-                    char formatted_msg[MAX_MSG_LEN];
-                    snprintf(formatted_msg, sizeof(formatted_msg), "-!- %s", params);
-                    buffer_append_message(server_buffer, formatted_msg);
-                    if (server_buffer == active_buffer) {
-                        *needs_refresh = true;
-                    }
-                }
-            } else if (strcmp(command, "NICK") == 0 && prefix && params) {
-               char *old_nick = prefix;
-               char *excl = strchr(old_nick, '!');
-               if (excl) *excl = '\0';
-
-               if (strcmp(old_nick, irc->nickname) == 0) {
-                   char *new_nick = params;
-                   if (new_nick[0] == ':') {
-                       new_nick++;
-                   }
-
-                   free(irc->nickname);
-                   irc->nickname = strdup(new_nick);
-
-                   // Announce nick change in all channel buffers
-                   char nick_change_msg[MAX_MSG_LEN];
-                   snprintf(nick_change_msg, sizeof(nick_change_msg), "-!- %s is now known as %s", old_nick, irc->nickname);
-                   
-                   if (buffer_list_head) {
-                       buffer_node_t *current = buffer_list_head;
-                       do {
-                           if (current->name && current->name[0] == '#') {
-                               buffer_append_message(current, nick_change_msg);
-                           }
-                           current = current->next;
-                       } while (current != buffer_list_head);
-                   }
-                   *needs_refresh = true;
-               }
-           } else if (strcmp(command, "433") == 0 && params) {
-               // Nickname in use error
-               buffer_node_t *server_buffer = get_buffer_by_name("status");
-               if (server_buffer) {
-                   char *failed_nick = strchr(params, ' ');
-                   if (failed_nick) {
-                       failed_nick++; // Move past space
-                       char *end_of_nick = strchr(failed_nick, ' ');
-                       if (end_of_nick) {
-                           *end_of_nick = '\0';
-                       }
-                       char error_msg[MAX_MSG_LEN];
-                       snprintf(error_msg, sizeof(error_msg), "-!- Nickname '%s' is already in use.", failed_nick);
-                       buffer_append_message(server_buffer, error_msg);
-                       if (server_buffer == active_buffer) {
-                           *needs_refresh = true;
-                       }
-                   }
-               }
-           }
-        }
-        current_pos = line_end + 2; // Move past the \r\n
-    }
-
-    // Move any remaining partial message to the beginning of the buffer
-    size_t remaining_len = irc->recv_buffer_len - (current_pos - irc->recv_buffer);
-    if (remaining_len > 0) {
-        memmove(irc->recv_buffer, current_pos, remaining_len);
-    }
-    irc->recv_buffer_len = remaining_len;
-    irc->recv_buffer[irc->recv_buffer_len] = '\0'; // Null-terminate the new end
+    int lines = 0;
+    for (int start = 0; start < count;) {
+        char modes[64];
+        char params[MAX_MSG_LEN];
+        int n = 0;
+        size_t params_len = 0;
+        size_t fixed = strlen("MODE ") + strlen(channel) + 2 + 2; // " +", CRLF
+        while (start + n < count && n < per_line && n < (int)sizeof(modes) - 2) {
+            size_t arg_len = strlen(args[start + n]);
+            if (n > 0 && fixed + n + 1 + params_len + 1 + arg_len > MAX_MSG_LEN - 1) {
+                break;
+            }
+            params_len += (size_t)snprintf(params + params_len, sizeof(params) - params_len, " %s", args[start + n]);
+            modes[n++] = mode;
+        }
+        modes[n] = '\0';
 
-    return lines_processed;
+        char buf[MAX_MSG_LEN * 2];
+        snprintf(buf, sizeof(buf), "MODE %s %c%s%s\r\n", channel, adding ? '+' : '-', modes, params);
+        if (irc_send(irc, buf) < 0) {
+            return -1;
+        }
+        lines++;
+        start += n;
+    }
+    return lines;
 }
 
-int irc_recv(Irc *irc) {
-    // Ensure there's enough space in the buffer for new data + null terminator
-    // We try to read up to a reasonable chunk size.
-    size_t read_size = irc->recv_buffer_capacity - irc->recv_buffer_len -1;
-    if (read_size < 1024) {
-        size_t new_capacity = irc->recv_buffer_capacity * 2;
-        char *new_buffer = (char *)realloc(irc->recv_buffer, new_capacity);
-        if (!new_buffer) {
-            log_message("ERROR: Failed to reallocate receive buffer");
-            return -1;
+/**
+ * @brief Joins the configured channel, or after a reconnect every channel
+ * that still has a buffer, in as few JOINs as the server allows.
+ */
+static void irc_join_channels(Irc *irc) {
+    if (irc->sessions == 0) {
+        char buf[MAX_MSG_LEN];
+        snprintf(buf, sizeof(buf), "JOIN %s\r\n", irc->channel);
+        if (irc_send(irc, buf) < 0) {
+            log_message("ERROR: Failed to send JOIN");
         }
-        irc->recv_buffer = new_buffer;
-        irc->recv_buffer_capacity = new_capacity;
+        return;
     }
-    read_size = irc->recv_buffer_capacity - irc->recv_buffer_len - 1;
 
+    int count = 0;
+    int capacity = 0;
+    const char **names = NULL;
+    buffer_node_t *node = buffer_list_head;
+    do {
+        if (node && node->irc == irc && irc_is_channel(irc, node->name)) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                const char **grown = (const char **)realloc(names, capacity * sizeof(char *));
+                if (!grown) {
+                    break;
+                }
+                names = grown;
+            }
+            names[count++] = node->name;
+        }
+        node = node ? node->next : NULL;
+    } while (node && node != buffer_list_head);
 
-    int bytes_received;
-    if (irc->ssl) {
-        bytes_received = SSL_read(irc->ssl, irc->recv_buffer + irc->recv_buffer_len, read_size);
+    int lines = count > 0 ? irc_send_list(irc, "JOIN", names, count, NULL) : 0;
+    free(names);
+    log_message("Rejoining %d channel(s) on %s in %d JOIN(s)", count, irc->network, lines);
+}
+
+/**
+ * @brief Appends a line to a buffer and requests a redraw if it is visible.
+ *
+ * Lines of a batched message that carried a server-time tag, such as
+ * history or bouncer playback, are placed by that time.
+ */
+static void irc_buffer_message(Irc *irc, buffer_node_t *buffer, const char *text, bool *needs_refresh) {
+    if (!buffer) {
+        return;
+    }
+    if (irc->line_time_ms >= 0) {
+        buffer_insert_message(buffer, text, irc->line_time_ms);
     } else {
-        bytes_received = recv(irc->sock, irc->recv_buffer + irc->recv_buffer_len, read_size, 0);
+        buffer_append_message(buffer, text);
     }
-
-    if (bytes_received > 0) {
-        irc->recv_buffer_len += bytes_received;
-        irc->recv_buffer[irc->recv_buffer_len] = '\0'; // Null-terminate the accumulated buffer
+    if (buffer == active_buffer) {
+        *needs_refresh = true;
+    }
+}
+
+/**
+ * @brief Returns the network's existing buffer with the given name, or NULL.
+ */
+static buffer_node_t* irc_find_buffer(Irc *irc, irc_slice_t name) {
+    char name_buf[MAX_MSG_LEN];
+    return get_buffer_by_name(irc, irc_slice_copy(name, name_buf, sizeof(name_buf)));
+}
+
+/**
+ * @brief Returns the network's buffer with the given name, creating it if needed.
+ */
+static buffer_node_t* irc_buffer_for(Irc *irc, irc_slice_t name) {
+    char name_buf[MAX_MSG_LEN];
+    irc_slice_copy(name, name_buf, sizeof(name_buf));
+    buffer_node_t *buffer = get_buffer_by_name(irc, name_buf);
+    if (!buffer) {
+        buffer = create_buffer(irc, name_buf);
+        add_buffer(buffer);
+    }
+    return buffer;
+}
+
+static void irc_handle_ping(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    irc_slice_t token = irc_message_param(msg, 0);
+    char pong_buf[MAX_MSG_LEN];
+    snprintf(pong_buf, sizeof(pong_buf), "PONG :%.*s\r\n", (int)token.len, token.ptr ? token.ptr : "");
+    irc_send(irc, pong_buf);
+}
+
+// PONG <server> :<token>; only answers to our own PINGs are of interest
+static void irc_handle_pong(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    irc_slice_t token = irc_message_param(msg, msg->param_count - 1);
+    size_t prefix_len = strlen(IRC_PING_TOKEN_PREFIX);
+    if (!irc->ping_sent_ms || token.len <= prefix_len || memcmp(token.ptr, IRC_PING_TOKEN_PREFIX, prefix_len) != 0) {
+        return;
+    }
+    char sent[32];
+    irc_slice_t stamp = { token.ptr + prefix_len, token.len - prefix_len };
+    if (atoll(irc_slice_copy(stamp, sent, sizeof(sent))) != irc->ping_sent_ms) {
+        return; // A stale answer to a PING from before a timeout
+    }
+
+    long long rtt = event_loop_now_ms() - irc->ping_sent_ms;
+    lag_record(&irc->lag, rtt);
+    irc->ping_sent_ms = 0;
+    event_loop_cancel_timer(irc->loop, irc->ping_timeout_timer);
+    irc->ping_timeout_timer = 0;
+    log_message("Lag on %s: %lld ms (p50 %lld ms, p99 %lld ms, max %lld ms)", irc->network, rtt,
+                lag_percentile(&irc->lag, 50), lag_percentile(&irc->lag, 99), irc->lag.max_ms);
+    *needs_refresh = true; // The status bar shows the lag
+}
+
+static void irc_handle_welcome(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    // Still negotiating means the server ignored CAP LS
+    if (irc->state != IRC_STATE_REGISTERING && irc->state != IRC_STATE_CAP_NEGOTIATING) {
+        return;
+    }
+    long long now = event_loop_now_ms();
+    log_message("Registered on %s: %.*s after %lld ms (%lld ms since registration was sent)", irc->network,
+                (int)msg->command.len, msg->command.ptr, now - irc->connect_started_ms, now - irc->registration_sent_ms);
+    irc->state = IRC_STATE_REGISTERED;
+    irc->reconnect_attempts = 0;
+    // Servers only start flood accounting once a client is registered, so
+    // the CAP exchange must not delay the first JOIN.
+    irc->flood.tokens = irc->flood.burst;
+    irc_lag_start(irc);
+}
+
+// 376 RPL_ENDOFMOTD, 422 ERR_NOMOTD: ISUPPORT has arrived, so join now
+static void irc_handle_motd_end(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    irc_handle_welcome(irc, msg, needs_refresh); // For servers that skip 001
+    if (irc->state != IRC_STATE_REGISTERED || irc->joined) {
+        return;
+    }
+    const isupport_t *is = &irc->isupport;
+    log_message("ISUPPORT on %s: CHANTYPES=%s PREFIX=(%s)%s CASEMAPPING=%s MODES=%d TARGMAX entries %d MAXLIST "
+                "entries %d", irc->network, is->chantypes, is->prefix_modes, is->prefix_symbols,
+                casemap_name(is->casemapping), is->modes, is->targmax_count, is->maxlist_count);
+    irc->joined = true;
+    irc_join_channels(irc);
+    irc->sessions++;
+}
+
+// 005 RPL_ISUPPORT: <client> <token>... :are supported by this server
+static void irc_handle_isupport(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    casemap_t casemap = irc->isupport.casemapping;
+    isupport_apply(&irc->isupport, msg);
+    intern_set_casemap(&irc->names, irc->isupport.casemapping);
+    if (irc->isupport.casemapping != casemap) {
+        buffer_reindex();
+    }
+}
+
+static void irc_handle_privmsg(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 2) {
+        return;
+    }
+    irc_slice_t target = msg->params[0];
+    irc_slice_t text = msg->params[1];
+
+    // A STATUSMSG target such as "@#chan" reaches only the channel's ops
+    // but belongs in the channel's buffer.
+    while (target.len > 1 && strchr(irc->isupport.statusmsg, target.ptr[0]) &&
+           isupport_is_channel(&irc->isupport, target.ptr + 1, target.len - 1)) {
+        target.ptr++;
+        target.len--;
+    }
+
+    buffer_node_t *target_buffer = NULL;
+    if (irc_slice_is_channel(irc, target)) {
+        target_buffer = irc_buffer_for(irc, target);
+    } else if (irc_is_me(irc, target) && msg->nick.len > 0) {
+        // Private message to us, kept in a buffer named after the sender
+        target_buffer = irc_buffer_for(irc, msg->nick);
+    } else if (irc_is_me(irc, msg->nick)) {
+        // echo-message: our own private message, shown with the recipient
+        target_buffer = irc_buffer_for(irc, target);
+    }
+    // Anything else is only shown as the raw line in the status buffer
+
+    if (target_buffer) {
+        char formatted_msg[MAX_MSG_LEN];
+        if (msg->nick.len > 0) {
+            snprintf(formatted_msg, sizeof(formatted_msg), "<%.*s> %.*s", (int)msg->nick.len, msg->nick.ptr,
+                     (int)text.len, text.ptr);
+        } else {
+            snprintf(formatted_msg, sizeof(formatted_msg), "%.*s", (int)text.len, text.ptr);
+        }
+        irc_buffer_message(irc, target_buffer, formatted_msg, needs_refresh);
+    }
+}
+
+static void irc_handle_join(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 1 || msg->nick.len == 0) {
+        return;
+    }
+    irc_slice_t channel = msg->params[0];
+    char channel_name[MAX_MSG_LEN];
+    irc_slice_copy(channel, channel_name, sizeof(channel_name));
+
+    buffer_node_t *channel_buffer = get_buffer_by_name(irc, channel_name);
+    if (!channel_buffer && irc_is_me(irc, msg->nick)) {
+        channel_buffer = create_buffer(irc, channel_name);
+        add_buffer(channel_buffer);
+        set_active_buffer(channel_buffer);
+    }
+
+    member_channel_t *channel_members = irc_is_me(irc, msg->nick)
+                                            ? members_add_channel(&irc->members, channel.ptr, channel.len)
+                                            : members_find_channel(&irc->members, channel.ptr, channel.len);
+    if (channel_members) {
+        member_user_t *user = members_join(&irc->members, channel_members, msg->nick.ptr, msg->nick.len);
+        if (user && msg->user.len > 0 && msg->host.len > 0) {
+            char userhost[MAX_MSG_LEN];
+            snprintf(userhost, sizeof(userhost), "%.*s@%.*s", (int)msg->user.len, msg->user.ptr, (int)msg->host.len,
+                     msg->host.ptr);
+            members_set_userhost(&irc->members, user, userhost, strlen(userhost));
+        }
+    }
+    if (channel_buffer) {
+        char join_msg[MAX_MSG_LEN];
+        snprintf(join_msg, sizeof(join_msg), "%.*s has joined %.*s", IRC_SLICE_ARGS(msg->nick), IRC_SLICE_ARGS(channel));
+        irc_buffer_message(irc, channel_buffer, join_msg, needs_refresh);
+    }
+}
+
+static void irc_handle_notice(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    // Notices are shown in the status buffer
+    irc_slice_t text = irc_message_param(msg, msg->param_count - 1);
+    char formatted_msg[MAX_MSG_LEN];
+    snprintf(formatted_msg, sizeof(formatted_msg), "-!- %.*s", (int)text.len, text.ptr ? text.ptr : "");
+    irc_buffer_message(irc, irc_get_status_buffer(irc), formatted_msg, needs_refresh);
+}
+
+/**
+ * @brief Shows a line about a user in each channel they share with us and
+ * in their query buffer, if one is open.
+ * @param user The user's membership record, or NULL if we share no channel.
+ */
+static void irc_user_message(Irc *irc, const member_user_t *user, irc_slice_t nick, const char *text,
+                             bool *needs_refresh) {
+    for (int i = 0; user && i < user->channel_count; i++) {
+        const char *channel = members_channel_name(&irc->members, user->channels[i]);
+        irc_buffer_message(irc, get_buffer_by_name(irc, channel), text, needs_refresh);
+    }
+    if (!irc_slice_is_channel(irc, nick)) {
+        irc_buffer_message(irc, irc_find_buffer(irc, nick), text, needs_refresh);
+    }
+}
+
+static void irc_handle_nick(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 1 || msg->nick.len == 0) {
+        return;
+    }
+    irc_slice_t new_nick = msg->params[0];
+    char nick_change_msg[MAX_MSG_LEN];
+    snprintf(nick_change_msg, sizeof(nick_change_msg), "-!- %.*s is now known as %.*s", IRC_SLICE_ARGS(msg->nick),
+             IRC_SLICE_ARGS(new_nick));
+
+    // Only the channels the user is in hear about it
+    member_user_t *user = members_find_user(&irc->members, msg->nick.ptr, msg->nick.len);
+    irc_user_message(irc, user, msg->nick, nick_change_msg, needs_refresh);
+    if (user) {
+        members_rename(&irc->members, user, new_nick.ptr, new_nick.len);
+    }
+
+    if (irc_is_me(irc, msg->nick)) {
+        char nick_buf[MAX_MSG_LEN];
+        free(irc->nickname);
+        irc->nickname = strdup(irc_slice_copy(new_nick, nick_buf, sizeof(nick_buf)));
+        irc_buffer_message(irc, irc_get_status_buffer(irc), nick_change_msg, needs_refresh);
+        *needs_refresh = true; // The status bar shows our nick
+    }
+}
+
+static void irc_handle_nickname_in_use(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 2) {
+        return;
+    }
+    char error_msg[MAX_MSG_LEN];
+    snprintf(error_msg, sizeof(error_msg), "-!- Nickname '%.*s' is already in use.", (int)msg->params[1].len,
+             msg->params[1].ptr);
+    irc_buffer_message(irc, irc_get_status_buffer(irc), error_msg, needs_refresh);
+}
+
+/**
+ * @brief Removes someone from a channel's member set; when it is us, the
+ * channel itself is forgotten.
+ */
+static void irc_member_left(Irc *irc, irc_slice_t channel, irc_slice_t nick) {
+    member_channel_t *channel_members = members_find_channel(&irc->members, channel.ptr, channel.len);
+    if (!channel_members) {
+        return;
+    }
+    if (irc_is_me(irc, nick)) {
+        members_remove_channel(&irc->members, channel_members);
+        return;
+    }
+    member_user_t *user = members_find_user(&irc->members, nick.ptr, nick.len);
+    if (user) {
+        members_part(&irc->members, channel_members, user);
+    }
+}
+
+static void irc_handle_part(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 1) {
+        return;
+    }
+    irc_member_left(irc, msg->params[0], msg->nick);
+    buffer_node_t *channel_buffer = irc_find_buffer(irc, msg->params[0]);
+    if (!channel_buffer) {
+        return; // Already closed locally by /part
+    }
+    if (irc_is_me(irc, msg->nick)) {
+        remove_buffer(channel_buffer);
+        *needs_refresh = true;
+        return;
+    }
+    irc_slice_t reason = irc_message_param(msg, 1);
+    char part_msg[MAX_MSG_LEN];
+    snprintf(part_msg, sizeof(part_msg), "-!- %.*s has left %.*s%s%.*s%s", IRC_SLICE_ARGS(msg->nick),
+             IRC_SLICE_ARGS(msg->params[0]), reason.len ? " (" : "", IRC_SLICE_ARGS(reason), reason.len ? ")" : "");
+    irc_buffer_message(irc, channel_buffer, part_msg, needs_refresh);
+}
+
+static void irc_handle_quit(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->nick.len == 0) {
+        return;
+    }
+    irc_slice_t reason = irc_message_param(msg, 0);
+    char quit_msg[MAX_MSG_LEN];
+    snprintf(quit_msg, sizeof(quit_msg), "-!- %.*s has quit (%.*s)", IRC_SLICE_ARGS(msg->nick), IRC_SLICE_ARGS(reason));
+
+    member_user_t *user = members_find_user(&irc->members, msg->nick.ptr, msg->nick.len);
+    irc_user_message(irc, user, msg->nick, quit_msg, needs_refresh);
+    if (user) {
+        members_remove_user(&irc->members, user);
+    }
+}
+
+static void irc_handle_kick(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 2) {
+        return;
+    }
+    irc_member_left(irc, msg->params[0], msg->params[1]);
+    buffer_node_t *channel_buffer = irc_find_buffer(irc, msg->params[0]);
+    if (!channel_buffer) {
+        return;
+    }
+    irc_slice_t reason = irc_message_param(msg, 2);
+    char kick_msg[MAX_MSG_LEN];
+    if (irc_is_me(irc, msg->params[1])) {
+        // Keep the buffer so the scrollback and the reason stay visible
+        snprintf(kick_msg, sizeof(kick_msg), "-!- You were kicked from %.*s by %.*s (%.*s)",
+                 IRC_SLICE_ARGS(msg->params[0]), IRC_SLICE_ARGS(msg->nick), IRC_SLICE_ARGS(reason));
+    } else {
+        snprintf(kick_msg, sizeof(kick_msg), "-!- %.*s was kicked from %.*s by %.*s (%.*s)",
+                 IRC_SLICE_ARGS(msg->params[1]), IRC_SLICE_ARGS(msg->params[0]), IRC_SLICE_ARGS(msg->nick),
+                 IRC_SLICE_ARGS(reason));
+    }
+    irc_buffer_message(irc, channel_buffer, kick_msg, needs_refresh);
+}
+
+/**
+ * @brief Applies the membership modes (e.g. +o nick) of a channel MODE to
+ * the member list, skipping over the arguments of other modes.
+ */
+static void irc_apply_member_modes(Irc *irc, member_channel_t *channel, const irc_message_t *msg) {
+    irc_slice_t modes = msg->params[1];
+    int arg = 2;
+    bool adding = true;
+    for (size_t i = 0; i < modes.len; i++) {
+        char mode = modes.ptr[i];
+        if (mode == '+' || mode == '-') {
+            adding = mode == '+';
+            continue;
+        }
+        if (!isupport_mode_has_param(&irc->isupport, mode, adding)) {
+            continue;
+        }
+        irc_slice_t target = irc_message_param(msg, arg++);
+        const char *rank = strchr(irc->isupport.prefix_modes, mode);
+        if (!rank || target.len == 0) {
+            continue;
+        }
+        member_user_t *user = members_find_user(&irc->members, target.ptr, target.len);
+        if (user) {
+            members_set_prefixes(channel, user, 1u << (rank - irc->isupport.prefix_modes), adding);
+        }
+    }
+}
+
+static void irc_handle_mode(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 2) {
+        return;
+    }
+    member_channel_t *channel_members = members_find_channel(&irc->members, msg->params[0].ptr, msg->params[0].len);
+    if (channel_members) {
+        irc_apply_member_modes(irc, channel_members, msg);
+    }
+
+    // Channel modes go to the channel, user modes to the status buffer
+    buffer_node_t *buffer = irc_find_buffer(irc, msg->params[0]);
+    if (!buffer) {
+        buffer = irc_get_status_buffer(irc);
+    }
+
+    char mode_msg[MAX_MSG_LEN];
+    int len = snprintf(mode_msg, sizeof(mode_msg), "-!- mode/%.*s [", IRC_SLICE_ARGS(msg->params[0]));
+    for (int i = 1; i < msg->param_count && len < (int)sizeof(mode_msg); i++) {
+        len += snprintf(mode_msg + len, sizeof(mode_msg) - len, "%s%.*s", i > 1 ? " " : "", IRC_SLICE_ARGS(msg->params[i]));
+    }
+    if (len < (int)sizeof(mode_msg)) {
+        snprintf(mode_msg + len, sizeof(mode_msg) - len, "] by %.*s", IRC_SLICE_ARGS(msg->nick));
+    }
+    irc_buffer_message(irc, buffer, mode_msg, needs_refresh);
+}
+
+static void irc_handle_topic(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 2) {
+        return;
+    }
+    buffer_node_t *channel_buffer = irc_find_buffer(irc, msg->params[0]);
+    if (!channel_buffer) {
+        return;
+    }
+    char topic_msg[MAX_MSG_LEN];
+    snprintf(topic_msg, sizeof(topic_msg), "-!- %.*s changed the topic of %.*s to: %.*s", IRC_SLICE_ARGS(msg->nick),
+             IRC_SLICE_ARGS(msg->params[0]), IRC_SLICE_ARGS(msg->params[1]));
+    irc_buffer_message(irc, channel_buffer, topic_msg, needs_refresh);
+}
+
+// 332 RPL_TOPIC: <client> <channel> :<topic>
+static void irc_handle_topic_reply(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 3) {
+        return;
+    }
+    buffer_node_t *channel_buffer = irc_find_buffer(irc, msg->params[1]);
+    if (!channel_buffer) {
+        return;
+    }
+    char topic_msg[MAX_MSG_LEN];
+    snprintf(topic_msg, sizeof(topic_msg), "-!- Topic for %.*s: %.*s", IRC_SLICE_ARGS(msg->params[1]),
+             IRC_SLICE_ARGS(msg->params[2]));
+    irc_buffer_message(irc, channel_buffer, topic_msg, needs_refresh);
+}
+
+// 353 RPL_NAMREPLY: <client> <symbol> <channel> :[prefix]<nick>{ [prefix]<nick>}
+static void irc_handle_names_reply(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 4) {
+        return;
+    }
+    // Names of our channels are collected silently and shown as a summary
+    // once the list is complete (366).
+    member_channel_t *channel_members = members_find_channel(&irc->members, msg->params[2].ptr, msg->params[2].len);
+    if (channel_members) {
+        if (members_stage_names(&irc->members, channel_members, msg->params[3].ptr, msg->params[3].len,
+                                irc->isupport.prefix_symbols) < 0) {
+            log_message("ERROR: Out of memory listing %.*s on %s", IRC_SLICE_ARGS(msg->params[2]), irc->network);
+        }
+        return;
+    }
+    buffer_node_t *channel_buffer = irc_find_buffer(irc, msg->params[2]);
+    if (!channel_buffer) {
+        return;
+    }
+    char names_msg[MAX_MSG_LEN];
+    snprintf(names_msg, sizeof(names_msg), "-!- Users on %.*s: %.*s", IRC_SLICE_ARGS(msg->params[2]),
+             IRC_SLICE_ARGS(msg->params[3]));
+    irc_buffer_message(irc, channel_buffer, names_msg, needs_refresh);
+}
+
+// 366 RPL_ENDOFNAMES: <client> <channel> :End of /NAMES list
+static void irc_handle_names_end(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 2) {
+        return;
+    }
+    member_channel_t *channel_members = members_find_channel(&irc->members, msg->params[1].ptr, msg->params[1].len);
+    buffer_node_t *channel_buffer = irc_find_buffer(irc, msg->params[1]);
+    if (!channel_members) {
+        if (channel_buffer) {
+            irc_buffer_message(irc, channel_buffer, "-!- End of names", needs_refresh);
+        }
+        return;
+    }
+    members_commit(&irc->members, channel_members);
+    if (!channel_buffer) {
+        return;
+    }
+
+    // Count members by their highest status, e.g. "3 nicks (1 @, 1 +)"
+    const char *symbols = irc->isupport.prefix_symbols;
+    int counts[ISUPPORT_MAX_PREFIXES] = {0};
+    const member_set_t *set = &channel_members->members;
+    for (int i = 0; i < set->capacity; i++) {
+        if (set->slots[i].user && set->slots[i].prefixes) {
+            int rank = __builtin_ctz(set->slots[i].prefixes);
+            if (rank < ISUPPORT_MAX_PREFIXES) {
+                counts[rank]++;
+            }
+        }
+    }
+    char names_msg[MAX_MSG_LEN];
+    int len = snprintf(names_msg, sizeof(names_msg), "-!- %.*s: %d nicks", IRC_SLICE_ARGS(msg->params[1]), set->count);
+    const char *sep = " (";
+    for (int i = 0; symbols[i] && len < (int)sizeof(names_msg); i++) {
+        if (counts[i] > 0) {
+            len += snprintf(names_msg + len, sizeof(names_msg) - len, "%s%d %c", sep, counts[i], symbols[i]);
+            sep = ", ";
+        }
+    }
+    if (sep[0] == ',' && len < (int)sizeof(names_msg)) {
+        snprintf(names_msg + len, sizeof(names_msg) - len, ")");
+    }
+    irc_buffer_message(irc, channel_buffer, names_msg, needs_refresh);
+}
+
+static const struct {
+    const char *name;
+    unsigned flag;
+} irc_caps[] = {
+    {"batch", IRC_CAP_BATCH},
+    {"server-time", IRC_CAP_SERVER_TIME},
+    {"message-tags", IRC_CAP_MESSAGE_TAGS},
+    {"echo-message", IRC_CAP_ECHO_MESSAGE},
+    {"draft/chathistory", IRC_CAP_CHATHISTORY},
+    {"sasl", IRC_CAP_SASL},
+};
+
+#define IRC_CAP_COUNT (sizeof(irc_caps) / sizeof(irc_caps[0]))
+
+/**
+ * @brief Collects the known capabilities in a space-separated CAP list.
+ *
+ * Values ("sasl=PLAIN") are ignored. Names prefixed with '-', as an ACK
+ * reports disabled capabilities, go into removed instead.
+ */
+static unsigned irc_cap_mask(irc_slice_t list, unsigned *removed) {
+    unsigned mask = 0;
+    const char *p = list.ptr;
+    const char *end = p + list.len;
+    while (p && p < end) {
+        while (p < end && *p == ' ') p++;
+        const char *start = p;
+        while (p < end && *p != ' ') p++;
+        bool negated = start < p && *start == '-';
+        if (negated) {
+            start++;
+        }
+        const char *name_end = memchr(start, '=', (size_t)(p - start));
+        if (!name_end) {
+            name_end = p;
+        }
+        irc_slice_t name = { start, (size_t)(name_end - start) };
+        for (size_t i = 0; i < IRC_CAP_COUNT; i++) {
+            if (irc_slice_equals(name, irc_caps[i].name)) {
+                if (negated) {
+                    *removed |= irc_caps[i].flag;
+                } else {
+                    mask |= irc_caps[i].flag;
+                }
+            }
+        }
+    }
+    return mask;
+}
+
+/**
+ * @brief Formats the names of the capabilities in mask, space separated.
+ */
+static char* irc_cap_names(unsigned mask, char *buf, size_t buf_size) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (size_t i = 0; i < IRC_CAP_COUNT && len < buf_size; i++) {
+        if (mask & irc_caps[i].flag) {
+            len += snprintf(buf + len, buf_size - len, "%s%s", len ? " " : "", irc_caps[i].name);
+        }
+    }
+    return buf;
+}
+
+/**
+ * @brief Finishes negotiation and lets registration complete.
+ */
+static void irc_cap_end(Irc *irc) {
+    char names[128];
+    log_message("CAP on %s: negotiated in %lld ms, enabled: %s", irc->network,
+                event_loop_now_ms() - irc->registration_sent_ms,
+                irc->caps_enabled ? irc_cap_names(irc->caps_enabled, names, sizeof(names)) : "none");
+    irc->state = IRC_STATE_REGISTERING;
+    irc_send(irc, "CAP END\r\n");
+}
+
+/**
+ * @brief Requests the given capabilities, ending negotiation if there are none.
+ *
+ * SASL is only requested during registration and when configured. Its
+ * AUTHENTICATE goes out in the same write as the request; the server
+ * handles both in order, which saves a round trip before the ACK.
+ */
+static void irc_cap_request(Irc *irc, unsigned mask) {
+    if (!irc->sasl_mechanism || irc->state != IRC_STATE_CAP_NEGOTIATING) {
+        mask &= ~IRC_CAP_SASL;
+    }
+    if (mask == 0) {
+        if (irc->state == IRC_STATE_CAP_NEGOTIATING) {
+            irc_cap_end(irc);
+        }
+        return;
+    }
+    char names[128];
+    char buf[MAX_MSG_LEN];
+    int len = snprintf(buf, sizeof(buf), "CAP REQ :%s\r\n", irc_cap_names(mask, names, sizeof(names)));
+    if (mask & IRC_CAP_SASL) {
+        snprintf(buf + len, sizeof(buf) - len, "AUTHENTICATE %s\r\n", irc->sasl_mechanism);
+        irc->sasl_in_progress = true;
+    }
+    irc_send(irc, buf);
+}
+
+/**
+ * @brief Checks a "sasl=MECH1,MECH2" value from CAP LS for our mechanism.
+ * An absent value (CAP 301 style) does not rule anything out.
+ */
+static bool irc_sasl_offered(Irc *irc, irc_slice_t list) {
+    const char *p = list.ptr;
+    const char *end = p + list.len;
+    while (p && p < end) {
+        while (p < end && *p == ' ') p++;
+        const char *start = p;
+        while (p < end && *p != ' ') p++;
+        if ((size_t)(p - start) <= 5 || memcmp(start, "sasl=", 5) != 0) {
+            continue;
+        }
+        size_t mech_len = strlen(irc->sasl_mechanism);
+        for (const char *m = start + 5; m < p;) {
+            const char *comma = memchr(m, ',', (size_t)(p - m));
+            const char *m_end = comma ? comma : p;
+            if ((size_t)(m_end - m) == mech_len && strncasecmp(m, irc->sasl_mechanism, mech_len) == 0) {
+                return true;
+            }
+            m = m_end + 1;
+        }
+        log_message("CAP on %s: server does not offer SASL %s (%.*s)", irc->network, irc->sasl_mechanism,
+                    (int)(p - start), start);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Ends an authentication attempt and with it the CAP negotiation.
+ */
+static void irc_sasl_finish(Irc *irc, bool success, irc_slice_t text, bool *needs_refresh) {
+    irc->sasl_in_progress = false;
+    log_message("SASL %s on %s %s after %lld ms: %.*s", irc->sasl_mechanism, irc->network,
+                success ? "succeeded" : "failed", event_loop_now_ms() - irc->registration_sent_ms,
+                IRC_SLICE_ARGS(text));
+    if (!success) {
+        // Registration goes on unauthenticated; +r channels will refuse us
+        char msg[MAX_MSG_LEN];
+        snprintf(msg, sizeof(msg), "-!- SASL authentication failed: %.*s", IRC_SLICE_ARGS(text));
+        irc_buffer_message(irc, irc_get_status_buffer(irc), msg, needs_refresh);
+    }
+    if (irc->state == IRC_STATE_CAP_NEGOTIATING) {
+        irc_cap_end(irc);
+    }
+}
+
+// AUTHENTICATE + asks for our (next) response
+static void irc_handle_authenticate(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (!irc->sasl_in_progress || !irc_slice_equals(irc_message_param(msg, 0), "+")) {
+        return;
+    }
+    if (strcmp(irc->sasl_mechanism, "EXTERNAL") == 0) {
+        // The identity comes from the client certificate
+        irc_send(irc, "AUTHENTICATE +\r\n");
+        return;
+    }
+
+    // PLAIN: authzid NUL authcid NUL password, with an empty authzid
+    const char *user = irc->sasl_username ? irc->sasl_username : irc->nickname;
+    const char *pass = irc->sasl_password ? irc->sasl_password : "";
+    size_t user_len = strlen(user);
+    size_t pass_len = strlen(pass);
+    unsigned char plain[2 + 2 * MAX_MSG_LEN];
+    if (user_len + pass_len + 2 > sizeof(plain)) {
+        irc_slice_t reason = { "credentials too long", 20 };
+        irc_send(irc, "AUTHENTICATE *\r\n");
+        irc_sasl_finish(irc, false, reason, needs_refresh);
+        return;
+    }
+    plain[0] = '\0';
+    memcpy(plain + 1, user, user_len);
+    plain[1 + user_len] = '\0';
+    memcpy(plain + 2 + user_len, pass, pass_len);
+    size_t plain_len = 2 + user_len + pass_len;
+
+    char encoded[4 * sizeof(plain) / 3 + 4];
+    int encoded_len = EVP_EncodeBlock((unsigned char *)encoded, plain, (int)plain_len);
+    OPENSSL_cleanse(plain, sizeof(plain));
+
+    // Sent in 400 byte lines; a final full line is followed by "+"
+    log_message("SEND: AUTHENTICATE <%d bytes of credentials>", encoded_len);
+    char line[IRC_SASL_CHUNK_SIZE + 32];
+    int offset = 0;
+    do {
+        int chunk = encoded_len - offset < IRC_SASL_CHUNK_SIZE ? encoded_len - offset : IRC_SASL_CHUNK_SIZE;
+        snprintf(line, sizeof(line), "AUTHENTICATE %.*s\r\n", chunk, encoded + offset);
+        irc_send_quiet(irc, line);
+        offset += chunk;
+        if (chunk < IRC_SASL_CHUNK_SIZE) {
+            break;
+        }
+        if (offset == encoded_len) {
+            irc_send_quiet(irc, "AUTHENTICATE +\r\n");
+            break;
+        }
+    } while (true);
+    OPENSSL_cleanse(line, sizeof(line));
+    OPENSSL_cleanse(encoded, sizeof(encoded));
+}
+
+// 900 RPL_LOGGEDIN: <client> <nick!user@host> <account> :You are now logged in as <user>
+static void irc_handle_logged_in(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    log_message("Logged in on %s as %.*s", irc->network, IRC_SLICE_ARGS(irc_message_param(msg, 2)));
+}
+
+// 903 RPL_SASLSUCCESS, 907 ERR_SASLALREADY
+static void irc_handle_sasl_success(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (irc->sasl_in_progress) {
+        irc_sasl_finish(irc, true, irc_message_param(msg, msg->param_count - 1), needs_refresh);
+    }
+}
+
+// 902 ERR_NICKLOCKED, 904 ERR_SASLFAIL, 905 ERR_SASLTOOLONG, 906 ERR_SASLABORTED
+static void irc_handle_sasl_failure(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (irc->sasl_in_progress) {
+        irc_sasl_finish(irc, false, irc_message_param(msg, msg->param_count - 1), needs_refresh);
+    }
+}
+
+// CAP <client> <subcommand> [*] :<capabilities>
+static void irc_handle_cap(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 3) {
+        return;
+    }
+    irc_slice_t subcommand = msg->params[1];
+    // "*" before the list means another line of the same reply follows
+    bool more = msg->param_count >= 4 && irc_slice_equals(msg->params[2], "*");
+    unsigned removed = 0;
+    unsigned caps = irc_cap_mask(msg->params[more ? 3 : 2], &removed);
+
+    if (irc_slice_equals(subcommand, "LS")) {
+        irc->caps_available |= caps;
+        if ((caps & IRC_CAP_SASL) && irc->sasl_mechanism && !irc_sasl_offered(irc, msg->params[more ? 3 : 2])) {
+            irc->caps_available &= ~IRC_CAP_SASL;
+        }
+        if (!more && irc->state == IRC_STATE_CAP_NEGOTIATING) {
+            irc_cap_request(irc, irc->caps_available);
+        }
+    } else if (irc_slice_equals(subcommand, "NEW")) {
+        irc->caps_available |= caps;
+        irc_cap_request(irc, caps & ~irc->caps_enabled);
+    } else if (irc_slice_equals(subcommand, "DEL")) {
+        irc->caps_available &= ~caps;
+        irc->caps_enabled &= ~caps;
+    } else if (irc_slice_equals(subcommand, "ACK")) {
+        irc->caps_enabled = (irc->caps_enabled | caps) & ~removed;
+        // With SASL acknowledged, the outcome of AUTHENTICATE ends negotiation
+        if (irc->state == IRC_STATE_CAP_NEGOTIATING && !(irc->sasl_in_progress && (caps & IRC_CAP_SASL))) {
+            irc->sasl_in_progress = false;
+            irc_cap_end(irc);
+        }
+    } else if (irc_slice_equals(subcommand, "NAK")) {
+        // The request is all-or-nothing, so nothing changed
+        log_message("CAP on %s: server refused %.*s", irc->network, IRC_SLICE_ARGS(msg->params[2]));
+        // Any reply to the pipelined AUTHENTICATE is ignored from here on
+        irc->sasl_in_progress = false;
+        if (irc->state == IRC_STATE_CAP_NEGOTIATING) {
+            irc_cap_end(irc);
+        }
+    }
+}
+
+/**
+ * @brief Returns the open batch a message belongs to, or NULL.
+ */
+static irc_batch_t* irc_batch_for(Irc *irc, const irc_message_t *msg) {
+    irc_slice_t ref;
+    if (irc->open_batches == 0 || !irc_message_tag(msg, "batch", &ref)) {
+        return NULL;
+    }
+    for (int i = 0; i < irc->open_batches; i++) {
+        if (irc_slice_equals(ref, irc->batches[i].ref)) {
+            return &irc->batches[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finishes a history request once its batch has been applied.
+ */
+static void irc_history_done(Irc *irc, const irc_batch_t *batch, bool *needs_refresh) {
+    buffer_node_t *buffer = get_buffer_by_name(irc, batch->params);
+    if (!buffer) {
+        return;
+    }
+    buffer->history_pending = false;
+    log_message("History for %s on %s: %d message(s)", buffer->name, irc->network, batch->lines);
+    if (batch->lines < irc_history_page_size(irc)) {
+        // A short page means the server has nothing older
+        buffer->history_complete = true;
+        buffer_insert_message(buffer, "-!- Beginning of history", buffer->line_count ? buffer->times[0] - 1 : 0);
+        if (buffer == active_buffer) {
+            *needs_refresh = true;
+        }
+    }
+}
+
+// FAIL <command> <code> [context...] :<description>
+static void irc_handle_fail(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 2) {
+        return;
+    }
+    irc_slice_t text = irc_message_param(msg, msg->param_count - 1);
+    log_message("FAIL on %s: %.*s %.*s: %.*s", irc->network, IRC_SLICE_ARGS(msg->params[0]),
+                IRC_SLICE_ARGS(msg->params[1]), IRC_SLICE_ARGS(text));
+    if (irc_slice_equals(msg->params[0], "CHATHISTORY")) {
+        // The context does not reliably name the target, so allow a retry anywhere
+        irc_history_cancel(irc);
+    }
+}
+
+// BATCH +<ref> <type> [params...] opens a batch, BATCH -<ref> closes it
+static void irc_handle_batch(Irc *irc, const irc_message_t *msg, bool *needs_refresh) {
+    if (msg->param_count < 1 || msg->params[0].len < 2) {
+        return;
+    }
+    irc_slice_t ref = { msg->params[0].ptr + 1, msg->params[0].len - 1 };
+
+    if (msg->params[0].ptr[0] == '+') {
+        if (irc->open_batches == IRC_MAX_OPEN_BATCHES) {
+            log_message("ERROR: Too many open batches on %s, applying %.*s unbatched", irc->network,
+                        IRC_SLICE_ARGS(ref));
+            return;
+        }
+        irc_batch_t *batch = &irc->batches[irc->open_batches++];
+        memset(batch, 0, sizeof(*batch));
+        irc_slice_copy(ref, batch->ref, sizeof(batch->ref));
+        irc_slice_copy(irc_message_param(msg, 1), batch->type, sizeof(batch->type));
+        int len = 0;
+        for (int i = 2; i < msg->param_count && len < (int)sizeof(batch->params); i++) {
+            len += snprintf(batch->params + len, sizeof(batch->params) - len, "%s%.*s", len ? " " : "",
+                            IRC_SLICE_ARGS(msg->params[i]));
+        }
+        return;
+    }
+
+    for (int i = 0; i < irc->open_batches; i++) {
+        irc_batch_t *batch = &irc->batches[i];
+        if (!irc_slice_equals(ref, batch->ref)) {
+            continue;
+        }
+        if (strcmp(batch->type, "chathistory") == 0) {
+            irc_history_done(irc, batch, needs_refresh);
+        }
+        bool split = strcmp(batch->type, "netsplit") == 0;
+        if (split || strcmp(batch->type, "netjoin") == 0) {
+            char summary[MAX_MSG_LEN];
+            snprintf(summary, sizeof(summary), "-!- %s %s: %d user(s) %s", split ? "Netsplit" : "Netjoin",
+                     batch->params, batch->lines, split ? "quit" : "returned");
+            irc_buffer_message(irc, irc_get_status_buffer(irc), summary, needs_refresh);
+        }
+        // Everything the batch changed is drawn at once
+        if (batch->needs_refresh) {
+            *needs_refresh = true;
+        }
+        *batch = irc->batches[--irc->open_batches];
+        return;
+    }
+}
+
+static const irc_verb_handler_t irc_verb_handlers[] = {
+    {"CAP", irc_handle_cap},
+    {"BATCH", irc_handle_batch},
+    {"FAIL", irc_handle_fail},
+    {"AUTHENTICATE", irc_handle_authenticate},
+    {"PING", irc_handle_ping},
+    {"PONG", irc_handle_pong},
+    {"PRIVMSG", irc_handle_privmsg},
+    {"NOTICE", irc_handle_notice},
+    {"JOIN", irc_handle_join},
+    {"PART", irc_handle_part},
+    {"QUIT", irc_handle_quit},
+    {"KICK", irc_handle_kick},
+    {"NICK", irc_handle_nick},
+    {"MODE", irc_handle_mode},
+    {"TOPIC", irc_handle_topic},
+};
+
+static const irc_numeric_handler_t irc_numeric_handlers[] = {
+    {1, irc_handle_welcome},    // RPL_WELCOME
+    {5, irc_handle_isupport},
+    {332, irc_handle_topic_reply},
+    {353, irc_handle_names_reply},
+    {366, irc_handle_names_end},
+    {376, irc_handle_motd_end},
+    {422, irc_handle_motd_end},
+    {433, irc_handle_nickname_in_use},
+    {900, irc_handle_logged_in},
+    {902, irc_handle_sasl_failure},
+    {903, irc_handle_sasl_success},
+    {904, irc_handle_sasl_failure},
+    {905, irc_handle_sasl_failure},
+    {906, irc_handle_sasl_failure},
+    {907, irc_handle_sasl_success},
+};
+
+static irc_dispatch_t irc_dispatch_table;
+static bool irc_dispatch_ready = false;
+
+/**
+ * @brief Builds the dispatch table on first use.
+ */
+static void irc_dispatch_setup(void) {
+    if (!irc_dispatch_ready) {
+        irc_dispatch_ready = irc_dispatch_build(&irc_dispatch_table, irc_verb_handlers,
+                                                sizeof(irc_verb_handlers) / sizeof(irc_verb_handlers[0]),
+                                                irc_numeric_handlers,
+                                                sizeof(irc_numeric_handlers) / sizeof(irc_numeric_handlers[0])) == 0;
+    }
+}
+
+/**
+ * @brief Parses and handles every complete line in the receive buffer.
+ * @return The number of lines processed.
+ */
+int irc_process_buffer(Irc *irc, bool *needs_refresh) {
+    char *line;
+    size_t line_len;
+    int lines_processed = 0;
+    *needs_refresh = false; // Initialize output parameter
+
+    while ((line = linebuf_next_line(&irc->recvq, &line_len)) != NULL) {
+        lines_processed++;
+
+        irc_message_t msg;
+        if (irc_message_parse(line, line_len, &msg) != 0) {
+            // No command; only the raw line is shown
+            irc_buffer_message(irc, irc_get_status_buffer(irc), line, needs_refresh);
+            continue;
+        }
+
+        // Messages inside a batch are applied now but only drawn once the
+        // batch closes, so e.g. a netsplit costs a single redraw.
+        bool *refresh = needs_refresh;
+        irc_batch_t *batch = irc_batch_for(irc, &msg);
+        if (batch) {
+            batch->lines++;
+            refresh = &batch->needs_refresh;
+        }
+
+        // Always append the raw incoming line to the status buffer
+        irc_buffer_message(irc, irc_get_status_buffer(irc), line, refresh);
+
+        irc_handler_fn handler = irc_dispatch_lookup(&irc_dispatch_table, &msg);
+        if (handler) {
+            // Only playback is placed by server-time. Live lines are appended
+            // as they arrive, so a server clock that is off from ours cannot
+            // move them among the lines we stamped ourselves.
+            irc->line_time_ms = batch ? irc_message_time_ms(&msg) : -1;
+            handler(irc, &msg, refresh);
+            irc->line_time_ms = -1;
+        }
+    }
+
+    return lines_processed;
+}
+
+/**
+ * @brief Reads whatever the socket has into the free part of the receive ring.
+ * @return Bytes read, 0 on EOF, -1 on error, IRC_IO_WOULD_BLOCK if nothing
+ *         is available yet.
+ */
+int irc_recv(Irc *irc) {
+    size_t read_size;
+    char *dest = linebuf_write_ptr(&irc->recvq, &read_size);
+    if (read_size == 0) {
+        // Full of complete lines; parse them before reading more
+        return IRC_IO_WOULD_BLOCK;
+    }
+
+    int bytes_received;
+    if (irc->ssl) {
+        bytes_received = SSL_read(irc->ssl, dest, (int)read_size);
+        if (bytes_received <= 0) {
+            switch (SSL_get_error(irc->ssl, bytes_received)) {
+                case SSL_ERROR_WANT_READ:
+                case SSL_ERROR_WANT_WRITE:
+                    return IRC_IO_WOULD_BLOCK;
+                case SSL_ERROR_ZERO_RETURN:
+                    return 0;
+                default:
+                    return -1;
+            }
+        }
+    } else {
+        bytes_received = recv(irc->sock, dest, read_size, 0);
+        if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return IRC_IO_WOULD_BLOCK;
+        }
+    }
+
+    if (bytes_received > 0) {
+        linebuf_commit(&irc->recvq, (size_t)bytes_received);
     }
 
     return bytes_received;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Reads and parses everything available, up to IRC_READ_BUDGET bytes.
+ *
+ * Reading continues while TLS still holds decrypted or read-ahead data,
+ * which epoll cannot see, or while reads keep filling the space offered.
+ * Lines are parsed as the ring fills and the UI is notified once at the
+ * end. If the budget runs out with TLS data still buffered, the rest is
+ * picked up on the next loop iteration so other connections get a turn.
+ */
+static void irc_drain(Irc *irc) {
+    bool needs_refresh = false;
+    size_t total = 0;
+    int reads = 0;
+    int lines = 0;
+
+    while (total < IRC_READ_BUDGET) {
+        size_t room;
+        linebuf_write_ptr(&irc->recvq, &room);
+        int received = irc_recv(irc);
+        if (received == IRC_IO_WOULD_BLOCK) {
+            break;
+        }
+        if (received <= 0) {
+            irc_connection_lost(irc, received == 0 ? "Connection closed" : "Read error");
+            return;
+        }
+        total += (size_t)received;
+        reads++;
+
+        bool batch_refresh = false;
+        lines += irc_process_buffer(irc, &batch_refresh);
+        needs_refresh = needs_refresh || batch_refresh;
+
+        bool tls_pending = irc->ssl && SSL_has_pending(irc->ssl);
+        if (!tls_pending && (size_t)received < room) {
+            break; // A short read means the socket is drained for now
+        }
+    }
+
+    if (total >= IRC_READ_BUDGET && irc->ssl && SSL_has_pending(irc->ssl)) {
+        log_message("Read budget of %d bytes used up on %s after %d reads, %d lines; continuing next iteration",
+                    IRC_READ_BUDGET, irc->network, reads, lines);
+        irc_schedule_drain(irc);
+    }
+
+    if (irc->notify) {
+        irc->notify(irc, needs_refresh);
+    }
+}
+
+static void irc_drain_timer_cb(event_loop_t *loop, void *data) {
+    Irc *irc = (Irc *)data;
+    irc->drain_timer = 0;
+    irc_drain(irc);
+}
+
+/**
+ * @brief Arranges for irc_drain() to run on the next loop iteration, for
+ * data TLS has buffered that will not make the socket readable again.
+ */
+static void irc_schedule_drain(Irc *irc) {
+    if (!irc->drain_timer) {
+        irc->drain_timer = event_loop_add_timer(irc->loop, 0, 0, irc_drain_timer_cb, irc);
+    }
+}
+
+static void irc_io_cb(event_loop_t *loop, int fd, int events, void *data) {
+    Irc *irc = (Irc *)data;
+
+    if (irc->state == IRC_STATE_TLS_HANDSHAKE) {
+        if (irc_tls_continue(irc) != 0) {
+            irc_connection_lost(irc, "TLS handshake failed");
+        } else if (irc->state != IRC_STATE_TLS_HANDSHAKE) {
+            // The server may have sent data in the same flight
+            irc_schedule_drain(irc);
+            if (irc->notify) {
+                irc->notify(irc, true);
+            }
+        }
+        return;
+    }
+
+    if (events & EVENT_WRITE) {
+        if (irc_flush(irc) != 0) {
+            irc_connection_lost(irc, "Write error");
+            return;
+        }
+        if (!(events & (EVENT_READ | EVENT_ERROR))) {
+            return;
+        }
+    }
+
+    irc_drain(irc);
+}
+
+/**
+ * @brief Stops watching the network's socket. The socket itself stays open.
+ */
+void irc_detach(Irc *irc) {
+    if (irc->watching) {
+        event_loop_remove_fd(irc->loop, irc->sock);
+        irc->watching = false;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include <strings.h>
+
+#include <irc_dispatch.h>
+#include <log.h>
+
+#define IRC_DISPATCH_MAX_SEEDS 100000
+
+/**
+ * FNV-1a over the upper-cased verb, mixed with the seed. Commands are
+ * case-insensitive, so "privmsg" hashes like "PRIVMSG".
+ */
+static uint32_t verb_hash(uint32_t seed, const char *verb, size_t len) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)verb[i];
+        if (c >= 'a' && c <= 'z') {
+            c -= 'a' - 'A';
+        }
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+static bool try_seed(irc_dispatch_t *table, uint32_t seed, const irc_verb_handler_t *verbs, int verb_count) {
+    memset(table->slots, 0, sizeof(table->slots));
+    for (int i = 0; i < verb_count; i++) {
+        size_t len = strlen(verbs[i].verb);
+        uint32_t slot = verb_hash(seed, verbs[i].verb, len) & (IRC_DISPATCH_VERB_SLOTS - 1);
+        if (table->slots[slot].verb) {
+            return false;
+        }
+        table->slots[slot].verb = verbs[i].verb;
+        table->slots[slot].len = len;
+        table->slots[slot].fn = verbs[i].fn;
+    }
+    table->seed = seed;
+    return true;
+}
+
+int irc_dispatch_build(irc_dispatch_t *table, const irc_verb_handler_t *verbs, int verb_count,
+                       const irc_numeric_handler_t *numerics, int numeric_count) {
+    memset(table, 0, sizeof(irc_dispatch_t));
+
+    uint32_t seed = 0;
+    while (!try_seed(table, seed, verbs, verb_count)) {
+        if (++seed == IRC_DISPATCH_MAX_SEEDS) {
+            log_message("ERROR: No collision-free seed for %d commands in %d slots", verb_count,
+                        IRC_DISPATCH_VERB_SLOTS);
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < numeric_count; i++) {
+        if (numerics[i].numeric >= 0 && numerics[i].numeric < IRC_DISPATCH_NUMERICS) {
+            table->numerics[numerics[i].numeric] = numerics[i].fn;
+        }
+    }
+
+    log_message("Dispatch table: %d commands in %d slots (seed %u), %d numerics", verb_count,
+                IRC_DISPATCH_VERB_SLOTS, seed, numeric_count);
+    return 0;
+}
+
+irc_handler_fn irc_dispatch_lookup(const irc_dispatch_t *table, const irc_message_t *msg) {
+    if (msg->numeric >= 0) {
+        return table->numerics[msg->numeric];
+    }
+    uint32_t slot = verb_hash(table->seed, msg->command.ptr, msg->command.len) & (IRC_DISPATCH_VERB_SLOTS - 1);
+    if (table->slots[slot].verb && table->slots[slot].len == msg->command.len &&
+        strncasecmp(table->slots[slot].verb, msg->command.ptr, msg->command.len) == 0) {
+        return table->slots[slot].fn;
+    }
+    return NULL;
+}
@@ -0,0 +1,199 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <irc_message.h>
+
+static irc_slice_t slice(const char *start, const char *end) {
+    irc_slice_t s = { start, (size_t)(end - start) };
+    return s;
+}
+
+/**
+ * Splits nick!user@host. Server prefixes have neither '!' nor '@' and end
+ * up entirely in nick.
+ */
+static void split_prefix(irc_message_t *msg) {
+    const char *p = msg->prefix.ptr;
+    const char *end = p + msg->prefix.len;
+    const char *bang = NULL;
+    const char *at = NULL;
+    for (const char *c = p; c < end; c++) {
+        if (*c == '!' && !bang && !at) {
+            bang = c;
+        } else if (*c == '@' && !at) {
+            at = c;
+        }
+    }
+
+    const char *nick_end = bang ? bang : (at ? at : end);
+    msg->nick = slice(p, nick_end);
+    if (bang) {
+        msg->user = slice(bang + 1, at ? at : end);
+    }
+    if (at) {
+        msg->host = slice(at + 1, end);
+    }
+}
+
+int irc_message_parse(const char *line, size_t len, irc_message_t *msg) {
+    memset(msg, 0, sizeof(irc_message_t));
+    msg->numeric = -1;
+
+    const char *p = line;
+    const char *end = line + len;
+
+    if (p < end && *p == '@') {
+        const char *start = ++p;
+        while (p < end && *p != ' ') p++;
+        msg->tags = slice(start, p);
+        while (p < end && *p == ' ') p++;
+    }
+
+    if (p < end && *p == ':') {
+        const char *start = ++p;
+        while (p < end && *p != ' ') p++;
+        msg->prefix = slice(start, p);
+        split_prefix(msg);
+        while (p < end && *p == ' ') p++;
+    }
+
+    const char *command = p;
+    while (p < end && *p != ' ') p++;
+    if (p == command) {
+        return -1;
+    }
+    msg->command = slice(command, p);
+    if (msg->command.len == 3 && command[0] >= '0' && command[0] <= '9' && command[1] >= '0' && command[1] <= '9' &&
+        command[2] >= '0' && command[2] <= '9') {
+        msg->numeric = (command[0] - '0') * 100 + (command[1] - '0') * 10 + (command[2] - '0');
+    }
+
+    while (p < end) {
+        while (p < end && *p == ' ') p++;
+        if (p == end) {
+            break;
+        }
+        // The last possible parameter takes the rest of the line, colon or not
+        if (*p == ':' || msg->param_count == IRC_MAX_PARAMS - 1) {
+            if (*p == ':') {
+                p++;
+                msg->has_trailing = true;
+            }
+            msg->params[msg->param_count++] = slice(p, end);
+            break;
+        }
+        const char *start = p;
+        while (p < end && *p != ' ') p++;
+        msg->params[msg->param_count++] = slice(start, p);
+    }
+    return 0;
+}
+
+bool irc_message_tag(const irc_message_t *msg, const char *key, irc_slice_t *value) {
+    size_t key_len = strlen(key);
+    const char *p = msg->tags.ptr;
+    const char *end = p + msg->tags.len;
+    while (p && p < end) {
+        const char *tag_end = memchr(p, ';', (size_t)(end - p));
+        if (!tag_end) {
+            tag_end = end;
+        }
+        const char *equals = memchr(p, '=', (size_t)(tag_end - p));
+        const char *name_end = equals ? equals : tag_end;
+        if ((size_t)(name_end - p) == key_len && memcmp(p, key, key_len) == 0) {
+            if (value) {
+                *value = equals ? slice(equals + 1, tag_end) : slice(tag_end, tag_end);
+            }
+            return true;
+        }
+        p = tag_end + 1;
+    }
+    return false;
+}
+
+long long irc_message_time_ms(const irc_message_t *msg) {
+    irc_slice_t value;
+    if (!irc_message_tag(msg, "time", &value)) {
+        return -1;
+    }
+    char text[40];
+    irc_slice_copy(value, text, sizeof(text));
+
+    // YYYY-MM-DDThh:mm:ss.sssZ, the fraction being optional
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    int consumed = 0;
+    if (sscanf(text, "%4d-%2d-%2dT%2d:%2d:%2d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min,
+               &tm.tm_sec, &consumed) != 6) {
+        return -1;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+
+    long long ms = 0;
+    const char *p = text + consumed;
+    if (*p == '.') {
+        int digits = 0;
+        for (p++; *p >= '0' && *p <= '9'; p++) {
+            if (digits++ < 3) {
+                ms = ms * 10 + (*p - '0');
+            }
+        }
+        for (; digits < 3; digits++) {
+            ms *= 10;
+        }
+    }
+    if (*p != 'Z') {
+        return -1;
+    }
+
+    time_t seconds = timegm(&tm);
+    if (seconds == (time_t)-1) {
+        return -1;
+    }
+    return (long long)seconds * 1000 + ms;
+}
+
+irc_slice_t irc_message_param(const irc_message_t *msg, int index) {
+    if (index < 0 || index >= msg->param_count) {
+        irc_slice_t empty = { NULL, 0 };
+        return empty;
+    }
+    return msg->params[index];
+}
+
+bool irc_slice_equals(irc_slice_t s, const char *str) {
+    size_t len = strlen(str);
+    return s.len == len && (len == 0 || memcmp(s.ptr, str, len) == 0);
+}
+
+char* irc_slice_copy(irc_slice_t s, char *buf, size_t buf_size) {
+    if (buf_size == 0) {
+        return buf;
+    }
+    size_t len = s.len < buf_size - 1 ? s.len : buf_size - 1;
+    if (len > 0) {
+        memcpy(buf, s.ptr, len);
+    }
+    buf[len] = '\0';
+    return buf;
+}
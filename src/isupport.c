@@ -0,0 +1,216 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <isupport.h>
+
+void isupport_init(isupport_t *isupport) {
+    memset(isupport, 0, sizeof(isupport_t));
+    strcpy(isupport->chantypes, "#&");
+    strcpy(isupport->prefix_modes, "ov");
+    strcpy(isupport->prefix_symbols, "@+");
+    strcpy(isupport->chanmodes[0], "beI");
+    strcpy(isupport->chanmodes[1], "k");
+    strcpy(isupport->chanmodes[2], "l");
+    strcpy(isupport->chanmodes[3], "imnpst");
+    isupport->casemapping = CASEMAP_RFC1459;
+    isupport->modes = 3;
+}
+
+static void copy_value(char *dst, size_t dst_size, const char *value, size_t len) {
+    if (len >= dst_size) {
+        len = dst_size - 1;
+    }
+    memcpy(dst, value, len);
+    dst[len] = '\0';
+}
+
+/**
+ * Parses "KEY:limit,KEY:limit" where an empty limit means none.
+ */
+static int parse_limits(isupport_limit_t *limits, const char *value, size_t len) {
+    int count = 0;
+    const char *p = value;
+    const char *end = value + len;
+    while (p < end && count < ISUPPORT_MAX_LIMITS) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        const char *item_end = comma ? comma : end;
+        const char *colon = memchr(p, ':', (size_t)(item_end - p));
+        if (colon) {
+            copy_value(limits[count].key, sizeof(limits[count].key), p, (size_t)(colon - p));
+            limits[count].limit = atoi(colon + 1);
+            count++;
+        }
+        p = item_end + 1;
+    }
+    return count;
+}
+
+/**
+ * Parses PREFIX=(modes)symbols.
+ */
+static void parse_prefix(isupport_t *isupport, const char *value, size_t len) {
+    const char *close = memchr(value, ')', len);
+    if (len == 0) {
+        isupport->prefix_modes[0] = '\0';
+        isupport->prefix_symbols[0] = '\0';
+        return;
+    }
+    if (value[0] != '(' || !close) {
+        return;
+    }
+    size_t modes = (size_t)(close - value - 1);
+    size_t symbols = len - modes - 2;
+    if (modes != symbols) {
+        return;
+    }
+    copy_value(isupport->prefix_modes, sizeof(isupport->prefix_modes), value + 1, modes);
+    copy_value(isupport->prefix_symbols, sizeof(isupport->prefix_symbols), close + 1, symbols);
+}
+
+static void parse_chanmodes(isupport_t *isupport, const char *value, size_t len) {
+    const char *p = value;
+    const char *end = value + len;
+    for (int type = 0; type < 4; type++) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        const char *item_end = comma ? comma : end;
+        copy_value(isupport->chanmodes[type], sizeof(isupport->chanmodes[type]), p, (size_t)(item_end - p));
+        if (!comma) {
+            for (type++; type < 4; type++) {
+                isupport->chanmodes[type][0] = '\0';
+            }
+            return;
+        }
+        p = comma + 1;
+    }
+}
+
+static void apply_token(isupport_t *isupport, const char *token, size_t len) {
+    bool negated = len > 0 && token[0] == '-';
+    if (negated) {
+        token++;
+        len--;
+    }
+    const char *equals = memchr(token, '=', len);
+    size_t key_len = equals ? (size_t)(equals - token) : len;
+    const char *value = equals ? equals + 1 : token + len;
+    size_t value_len = equals ? len - key_len - 1 : 0;
+    char key[32];
+    copy_value(key, sizeof(key), token, key_len);
+
+    // A negated token restores the default for that key
+    isupport_t defaults;
+    if (negated) {
+        isupport_init(&defaults);
+    }
+
+    if (strcmp(key, "CHANTYPES") == 0) {
+        if (negated) {
+            strcpy(isupport->chantypes, defaults.chantypes);
+        } else {
+            copy_value(isupport->chantypes, sizeof(isupport->chantypes), value, value_len);
+        }
+    } else if (strcmp(key, "PREFIX") == 0) {
+        if (negated) {
+            strcpy(isupport->prefix_modes, defaults.prefix_modes);
+            strcpy(isupport->prefix_symbols, defaults.prefix_symbols);
+        } else {
+            parse_prefix(isupport, value, value_len);
+        }
+    } else if (strcmp(key, "STATUSMSG") == 0) {
+        copy_value(isupport->statusmsg, sizeof(isupport->statusmsg), value, negated ? 0 : value_len);
+    } else if (strcmp(key, "CHANMODES") == 0) {
+        if (negated) {
+            memcpy(isupport->chanmodes, defaults.chanmodes, sizeof(defaults.chanmodes));
+        } else {
+            parse_chanmodes(isupport, value, value_len);
+        }
+    } else if (strcmp(key, "CASEMAPPING") == 0) {
+        isupport->casemapping = negated ? CASEMAP_RFC1459 : casemap_from_name(value, value_len);
+    } else if (strcmp(key, "MODES") == 0) {
+        isupport->modes = negated ? defaults.modes : atoi(value);
+    } else if (strcmp(key, "MAXTARGETS") == 0) {
+        isupport->maxtargets = negated ? 0 : atoi(value);
+    } else if (strcmp(key, "CHATHISTORY") == 0) {
+        isupport->chathistory = negated ? 0 : atoi(value);
+    } else if (strcmp(key, "TARGMAX") == 0) {
+        isupport->targmax_count = negated ? 0 : parse_limits(isupport->targmax, value, value_len);
+    } else if (strcmp(key, "MAXLIST") == 0) {
+        isupport->maxlist_count = negated ? 0 : parse_limits(isupport->maxlist, value, value_len);
+    }
+}
+
+int isupport_apply(isupport_t *isupport, const irc_message_t *msg) {
+    // The first parameter is our nick and the last the human-readable text
+    int applied = 0;
+    for (int i = 1; i < msg->param_count - 1; i++) {
+        apply_token(isupport, msg->params[i].ptr, msg->params[i].len);
+        applied++;
+    }
+    return applied;
+}
+
+bool isupport_is_channel(const isupport_t *isupport, const char *name, size_t len) {
+    return len > 0 && name[0] != '\0' && strchr(isupport->chantypes, name[0]) != NULL;
+}
+
+int isupport_prefix_rank(const isupport_t *isupport, char symbol) {
+    const char *found = symbol ? strchr(isupport->prefix_symbols, symbol) : NULL;
+    return found ? (int)(found - isupport->prefix_symbols) : -1;
+}
+
+bool isupport_mode_has_param(const isupport_t *isupport, char mode, bool adding) {
+    // strchr() would match the terminator for '\0'
+    if (mode == '\0') {
+        return false;
+    }
+    if (strchr(isupport->prefix_modes, mode) || strchr(isupport->chanmodes[0], mode) ||
+        strchr(isupport->chanmodes[1], mode)) {
+        return true;
+    }
+    return adding && strchr(isupport->chanmodes[2], mode) != NULL;
+}
+
+int isupport_targmax(const isupport_t *isupport, const char *command) {
+    for (int i = 0; i < isupport->targmax_count; i++) {
+        if (strcasecmp(isupport->targmax[i].key, command) == 0) {
+            return isupport->targmax[i].limit;
+        }
+    }
+    if (strcasecmp(command, "JOIN") == 0 || strcasecmp(command, "PART") == 0) {
+        return 0;
+    }
+    // MAXTARGETS only speaks for PRIVMSG and NOTICE; WHO and the rest get
+    // one target per line unless TARGMAX lists them
+    if ((strcasecmp(command, "PRIVMSG") == 0 || strcasecmp(command, "NOTICE") == 0) && isupport->maxtargets > 0) {
+        return isupport->maxtargets;
+    }
+    return 1;
+}
+
+int isupport_maxlist(const isupport_t *isupport, char mode) {
+    for (int i = 0; i < isupport->maxlist_count; i++) {
+        if (strchr(isupport->maxlist[i].key, mode)) {
+            return isupport->maxlist[i].limit;
+        }
+    }
+    return 0;
+}
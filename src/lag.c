@@ -0,0 +1,76 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+
+#include <lag.h>
+
+void lag_init(lag_t *lag) {
+    memset(lag, 0, sizeof(lag_t));
+    lag->last_ms = -1;
+}
+
+static int lag_bucket(long long ms) {
+    if (ms < LAG_LINEAR_MS) {
+        return ms < 0 ? 0 : (int)ms;
+    }
+    int octave = 63 - __builtin_clzll((unsigned long long)ms);
+    if (octave >= LAG_MAX_OCTAVE) {
+        return LAG_BUCKETS - 1;
+    }
+    // The three bits after the leading one pick the sub-bucket
+    int sub = (int)((ms >> (octave - 3)) & (LAG_SUB_BUCKETS - 1));
+    return LAG_LINEAR_MS + (octave - 4) * LAG_SUB_BUCKETS + sub;
+}
+
+static long long lag_bucket_upper(int bucket) {
+    if (bucket < LAG_LINEAR_MS) {
+        return bucket;
+    }
+    int octave = 4 + (bucket - LAG_LINEAR_MS) / LAG_SUB_BUCKETS;
+    int sub = (bucket - LAG_LINEAR_MS) % LAG_SUB_BUCKETS;
+    return ((long long)(LAG_SUB_BUCKETS + sub + 1) << (octave - 3)) - 1;
+}
+
+void lag_record(lag_t *lag, long long rtt_ms) {
+    lag->buckets[lag_bucket(rtt_ms)]++;
+    lag->samples++;
+    lag->last_ms = rtt_ms;
+    if (rtt_ms > lag->max_ms) {
+        lag->max_ms = rtt_ms;
+    }
+}
+
+long long lag_percentile(const lag_t *lag, double percentile) {
+    if (lag->samples == 0) {
+        return -1;
+    }
+    // Smallest value with at least this many samples at or below it
+    unsigned long rank = (unsigned long)(percentile / 100.0 * (double)lag->samples + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    unsigned long seen = 0;
+    for (int i = 0; i < LAG_BUCKETS - 1; i++) {
+        seen += lag->buckets[i];
+        if (seen >= rank) {
+            long long upper = lag_bucket_upper(i);
+            return upper < lag->max_ms ? upper : lag->max_ms;
+        }
+    }
+    return lag->max_ms;
+}
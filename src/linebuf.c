@@ -0,0 +1,147 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <linebuf.h>
+#include <linescan.h>
+#include <log.h>
+
+int linebuf_init(linebuf_t *lb, size_t capacity, size_t max_line) {
+    memset(lb, 0, sizeof(linebuf_t));
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || max_line >= capacity) {
+        return -1;
+    }
+    lb->data = (char *)malloc(capacity);
+    lb->scratch = (char *)malloc(max_line);
+    if (!lb->data || !lb->scratch) {
+        linebuf_free(lb);
+        return -1;
+    }
+    lb->capacity = capacity;
+    lb->max_line = max_line;
+    return 0;
+}
+
+void linebuf_free(linebuf_t *lb) {
+    free(lb->data);
+    free(lb->scratch);
+    memset(lb, 0, sizeof(linebuf_t));
+}
+
+void linebuf_reset(linebuf_t *lb) {
+    lb->head = 0;
+    lb->tail = 0;
+    lb->scanned = 0;
+    lb->discarding = false;
+    lb->discarded_bytes = 0;
+}
+
+char* linebuf_write_ptr(linebuf_t *lb, size_t *avail) {
+    size_t used = lb->tail - lb->head;
+    size_t offset = lb->tail & (lb->capacity - 1);
+    size_t to_end = lb->capacity - offset;
+    size_t free_bytes = lb->capacity - used;
+    *avail = free_bytes < to_end ? free_bytes : to_end;
+    return lb->data + offset;
+}
+
+void linebuf_commit(linebuf_t *lb, size_t count) {
+    lb->tail += count;
+}
+
+/**
+ * Finds the first '\n' at or after byte from of the buffered data, looking
+ * at the ring as at most two contiguous runs.
+ * @return Its offset from head, or -1 if there is none.
+ */
+static long linebuf_find_newline(linebuf_t *lb, size_t from) {
+    size_t used = lb->tail - lb->head;
+    while (from < used) {
+        size_t offset = (lb->head + from) & (lb->capacity - 1);
+        size_t run = lb->capacity - offset;
+        if (run > used - from) {
+            run = used - from;
+        }
+        const char *hit = linescan_find_newline(lb->data + offset, run);
+        if (hit) {
+            return (long)(from + (size_t)(hit - (lb->data + offset)));
+        }
+        from += run;
+    }
+    return -1;
+}
+
+static void linebuf_drop(linebuf_t *lb, size_t count) {
+    lb->head += count;
+    lb->scanned = 0;
+}
+
+char* linebuf_next_line(linebuf_t *lb, size_t *len) {
+    for (;;) {
+        size_t used = lb->tail - lb->head;
+        long newline = linebuf_find_newline(lb, lb->scanned);
+
+        if (newline < 0) {
+            lb->scanned = used;
+            if (lb->discarding) {
+                lb->discarded_bytes += used;
+                linebuf_drop(lb, used);
+            } else if (used >= lb->max_line) {
+                // No terminator within the cap: drop what we have and
+                // everything up to the next '\n'.
+                lb->discarding = true;
+                lb->discarded_bytes = used;
+                linebuf_drop(lb, used);
+            }
+            return NULL;
+        }
+
+        size_t line_end = (size_t)newline; // Offset of '\n' from head
+        if (lb->discarding || line_end + 1 > lb->max_line) {
+            lb->dropped_lines++;
+            log_message("ERROR: Dropped a %zu byte line longer than %zu bytes (%lu dropped so far)",
+                        lb->discarded_bytes + line_end + 1, lb->max_line, lb->dropped_lines);
+            lb->discarding = false;
+            lb->discarded_bytes = 0;
+            linebuf_drop(lb, line_end + 1);
+            continue;
+        }
+
+        size_t line_len = line_end;
+        size_t start = lb->head & (lb->capacity - 1);
+        char *line;
+        if (start + line_end < lb->capacity) {
+            // Contiguous: terminate in place over the CR or LF
+            line = lb->data + start;
+        } else {
+            size_t first = lb->capacity - start;
+            memcpy(lb->scratch, lb->data + start, first);
+            memcpy(lb->scratch + first, lb->data, line_end - first);
+            line = lb->scratch;
+        }
+        if (line_len > 0 && line[line_len - 1] == '\r') {
+            line_len--;
+        }
+        line[line_len] = '\0';
+
+        linebuf_drop(lb, line_end + 1);
+        *len = line_len;
+        return line;
+    }
+}
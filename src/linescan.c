@@ -0,0 +1,150 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINESCAN_X86 1
+#endif
+
+#include <linescan.h>
+
+typedef const char* (*linescan_fn)(const char *buf, size_t len);
+
+static const char* scan_scalar(const char *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] == '\n') {
+            return buf + i;
+        }
+    }
+    return NULL;
+}
+
+static const char* scan_memchr(const char *buf, size_t len) {
+    return (const char *)memchr(buf, '\n', len);
+}
+
+#ifdef LINESCAN_X86
+__attribute__((target("sse2")))
+static const char* scan_sse2(const char *buf, size_t len) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(buf + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        if (mask) {
+            return buf + i + __builtin_ctz((unsigned int)mask);
+        }
+    }
+    return scan_scalar(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static const char* scan_avx2(const char *buf, size_t len) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(buf + i));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+        if (mask) {
+            return buf + i + __builtin_ctz(mask);
+        }
+    }
+    return scan_sse2(buf + i, len - i);
+}
+#endif
+
+typedef struct {
+    const char *name;
+    linescan_fn fn;
+    bool (*supported)(void);
+} linescan_impl_t;
+
+static bool always_supported(void) {
+    return true;
+}
+
+#ifdef LINESCAN_X86
+static bool cpu_has_sse2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+static bool cpu_has_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+// In order of preference. glibc's memchr() already picks an AVX2/EVEX
+// variant at load time and measured faster than our loops on short IRC
+// lines (see bench/bench_linescan.c), so it comes first there.
+static const linescan_impl_t linescan_impls[] = {
+#ifdef __GLIBC__
+    {"memchr", scan_memchr, always_supported},
+#endif
+#ifdef LINESCAN_X86
+    {"avx2", scan_avx2, cpu_has_avx2},
+    {"sse2", scan_sse2, cpu_has_sse2},
+#endif
+#ifndef __GLIBC__
+    {"memchr", scan_memchr, always_supported},
+#endif
+    {"scalar", scan_scalar, always_supported},
+};
+
+#define LINESCAN_IMPL_COUNT (sizeof(linescan_impls) / sizeof(linescan_impls[0]))
+
+static const linescan_impl_t *current_impl = NULL;
+
+int linescan_select(const char *name) {
+    for (size_t i = 0; i < LINESCAN_IMPL_COUNT; i++) {
+        if (strcmp(linescan_impls[i].name, name) == 0) {
+            if (!linescan_impls[i].supported()) {
+                return -1;
+            }
+            current_impl = &linescan_impls[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static const linescan_impl_t* linescan_impl(void) {
+    if (!current_impl) {
+        const char *forced = getenv("CHATTER_LINESCAN");
+        if (!forced || linescan_select(forced) != 0) {
+            for (size_t i = 0; i < LINESCAN_IMPL_COUNT && !current_impl; i++) {
+                if (linescan_impls[i].supported()) {
+                    current_impl = &linescan_impls[i];
+                }
+            }
+        }
+    }
+    return current_impl;
+}
+
+const char* linescan_name(void) {
+    return linescan_impl()->name;
+}
+
+const char* linescan_find_newline(const char *buf, size_t len) {
+    return linescan_impl()->fn(buf, len);
+}
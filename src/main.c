@@ -17,8 +17,16 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <getopt.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <log.h>
 #include <irc.h>
 #include <tui.h>
@@ -26,15 +34,276 @@
 #include <signal.h>
 #include <globals.h>
 #include <version.h>
+#include <event_loop.h>
+#include <resolver.h>
+#include <tls.h>
+#include <linescan.h>
+#include <sockopt.h>
 
 volatile int running = 1;
 
+#define MAX_NETWORKS 32
+
+// Long-only options
+#define OPT_INSECURE 256
+#define OPT_CA_FILE 257
+
+typedef struct {
+    char *name;
+    char *host;
+    int port;
+    int ssl;
+    int verify;
+    int flood_burst;
+    long long flood_interval_ms;
+    long long ping_interval_ms;
+    long long ping_timeout_ms;
+    sockopt_t sockopts;
+    const char *sasl_mechanism;
+    char *sasl_username;
+    char *sasl_password;
+    char *cert_file;
+    char *key_file;
+    char *nick;
+    char *channel;
+} network_spec_t;
+
 void handle_sigint(int sig) {
     running = 0;
 }
 
+/**
+ * @brief Derives a short network name from a server host name.
+ *
+ * "irc.libera.chat" becomes "libera"; numeric addresses and single-label
+ * names are used as-is.
+ */
+static void default_network_name(const char *host, char *out, size_t out_size) {
+    const char *last_dot = strrchr(host, '.');
+    if (!last_dot || isdigit((unsigned char)last_dot[1])) {
+        snprintf(out, out_size, "%s", host);
+        return;
+    }
+    const char *start = last_dot;
+    while (start > host && start[-1] != '.') {
+        start--;
+    }
+    if (start == last_dot) {
+        snprintf(out, out_size, "%s", host);
+        return;
+    }
+    snprintf(out, out_size, "%.*s", (int)(last_dot - start), start);
+}
+
+/**
+ * @brief Fills in the defaults for everything a network spec can override.
+ */
+static void network_spec_defaults(network_spec_t *net) {
+    memset(net, 0, sizeof(network_spec_t));
+    net->port = 6697;
+    net->ssl = 1;
+    net->verify = -1; // Inherit --insecure
+    net->flood_burst = FLOOD_DEFAULT_BURST;
+    net->flood_interval_ms = FLOOD_DEFAULT_INTERVAL_MS;
+    net->ping_interval_ms = IRC_PING_INTERVAL_MS;
+    net->ping_timeout_ms = IRC_PING_TIMEOUT_MS;
+    sockopt_defaults(&net->sockopts);
+}
+
+/**
+ * @brief Parses one of the numeric socket option keys of a network spec.
+ * @return 0 if the key was recognized and its value is valid, -1 otherwise.
+ */
+static int parse_sockopt_key(const char *key, const char *value, sockopt_t *opts) {
+    static const struct {
+        const char *key;
+        size_t offset;
+    } keys[] = {
+        {"keepalive_idle", offsetof(sockopt_t, keepalive_idle_s)},
+        {"keepalive_interval", offsetof(sockopt_t, keepalive_interval_s)},
+        {"keepalive_count", offsetof(sockopt_t, keepalive_count)},
+        {"rcvbuf", offsetof(sockopt_t, rcvbuf)},
+        {"sndbuf", offsetof(sockopt_t, sndbuf)},
+        {"user_timeout", offsetof(sockopt_t, user_timeout_ms)},
+    };
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strcmp(key, keys[i].key) == 0) {
+            int n = atoi(value);
+            if (n < 0) {
+                return -1;
+            }
+            *(int *)((char *)opts + keys[i].offset) = n;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Reads a password from the first line of a file.
+ *
+ * Like the TLS session cache, the file must be private to its owner: one
+ * that the group or others can read is refused rather than trusted.
+ *
+ * @return A newly allocated string, or NULL on failure.
+ */
+static char *read_secret_file(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "%s is not a regular file\n", path);
+        close(fd);
+        return NULL;
+    }
+    if (st.st_mode & (S_IRWXG | S_IRWXO)) {
+        fprintf(stderr, "%s is accessible by others, run chmod 600 on it\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    FILE *file = fdopen(fd, "r");
+    if (!file) {
+        close(fd);
+        return NULL;
+    }
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t line_len = getline(&line, &line_capacity, file);
+    fclose(file);
+    if (line_len <= 0) {
+        fprintf(stderr, "%s is empty\n", path);
+        free(line);
+        return NULL;
+    }
+    line[strcspn(line, "\r\n")] = '\0';
+    return line;
+}
+
+/**
+ * @brief Parses a --network argument of the form name=host[:port][,key=value...].
+ *
+ * The spec string is modified in place and the resulting fields point into it.
+ * Supported keys are ssl, verify, nick, channel, flood_burst,
+ * flood_interval (milliseconds per message, 0 disables flood control),
+ * ping_interval (milliseconds between lag checks, 0 disables them) and
+ * ping_timeout (milliseconds a PONG may take before reconnecting), and the
+ * socket options nodelay, keepalive_idle, keepalive_interval (seconds),
+ * keepalive_count, rcvbuf, sndbuf (bytes) and user_timeout (milliseconds),
+ * where 0 keeps the kernel default and keepalive_idle=0 disables keepalive.
+ * SASL is configured with sasl (plain or external), sasl_user and
+ * sasl_pass_file, a file holding the password so that it stays out of the
+ * command line, and a client certificate for TLS with cert and key.
+ *
+ * @return 0 on success, -1 if the spec is malformed.
+ */
+static int parse_network_spec(char *spec, network_spec_t *out) {
+    char *equals = strchr(spec, '=');
+    if (!equals || equals == spec) {
+        return -1;
+    }
+    *equals = '\0';
+    out->name = spec;
+
+    char *rest = equals + 1;
+    char *options = strchr(rest, ',');
+    if (options) {
+        *options++ = '\0';
+    }
+
+    out->host = rest;
+    char *colon = strrchr(rest, ':');
+    if (colon) {
+        *colon = '\0';
+        out->port = atoi(colon + 1);
+        if (out->port <= 0 || out->port > 65535) {
+            return -1;
+        }
+    }
+    if (*out->host == '\0') {
+        return -1;
+    }
+
+    char *saveptr;
+    for (char *opt = options ? strtok_r(options, ",", &saveptr) : NULL; opt; opt = strtok_r(NULL, ",", &saveptr)) {
+        char *value = strchr(opt, '=');
+        if (!value) {
+            return -1;
+        }
+        *value++ = '\0';
+        if (strcmp(opt, "ssl") == 0) {
+            out->ssl = atoi(value) != 0;
+        } else if (strcmp(opt, "verify") == 0) {
+            out->verify = atoi(value) != 0;
+        } else if (strcmp(opt, "flood_burst") == 0) {
+            out->flood_burst = atoi(value);
+            if (out->flood_burst <= 0) {
+                return -1;
+            }
+        } else if (strcmp(opt, "flood_interval") == 0) {
+            out->flood_interval_ms = atoll(value);
+            if (out->flood_interval_ms < 0) {
+                return -1;
+            }
+        } else if (strcmp(opt, "ping_interval") == 0) {
+            out->ping_interval_ms = atoll(value);
+            if (out->ping_interval_ms < 0) {
+                return -1;
+            }
+        } else if (strcmp(opt, "ping_timeout") == 0) {
+            out->ping_timeout_ms = atoll(value);
+            if (out->ping_timeout_ms <= 0) {
+                return -1;
+            }
+        } else if (strcmp(opt, "nodelay") == 0) {
+            out->sockopts.nodelay = atoi(value) != 0;
+        } else if (parse_sockopt_key(opt, value, &out->sockopts) == 0) {
+            continue;
+        } else if (strcmp(opt, "sasl") == 0) {
+            if (strcasecmp(value, "plain") == 0) {
+                out->sasl_mechanism = "PLAIN";
+            } else if (strcasecmp(value, "external") == 0) {
+                out->sasl_mechanism = "EXTERNAL";
+            } else {
+                return -1;
+            }
+        } else if (strcmp(opt, "sasl_user") == 0) {
+            out->sasl_username = value;
+        } else if (strcmp(opt, "sasl_pass_file") == 0) {
+            free(out->sasl_password);
+            out->sasl_password = read_secret_file(value);
+            if (!out->sasl_password) {
+                return -1;
+            }
+        } else if (strcmp(opt, "cert") == 0) {
+            out->cert_file = value;
+        } else if (strcmp(opt, "key") == 0) {
+            out->key_file = value;
+        } else if (strcmp(opt, "nick") == 0) {
+            out->nick = value;
+        } else if (strcmp(opt, "channel") == 0) {
+            out->channel = value;
+        } else {
+            return -1;
+        }
+    }
+
+    // PLAIN needs a password, EXTERNAL a certificate over TLS
+    if (out->sasl_mechanism && strcmp(out->sasl_mechanism, "PLAIN") == 0 && !out->sasl_password) {
+        return -1;
+    }
+    if (out->sasl_mechanism && strcmp(out->sasl_mechanism, "EXTERNAL") == 0 && (!out->cert_file || !out->ssl)) {
+        return -1;
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     signal(SIGINT, handle_sigint);
+    srand((unsigned int)(time(NULL) ^ getpid())); // Reconnect jitter
     open_log("chatter.log");
 
     char *server = "irc.libera.chat";
@@ -44,6 +313,10 @@ int main(int argc, char *argv[]) {
     char *user = "chatter_user";
     char *realname = "chatter_user";
     char *channel = "#chatter";
+    int verify = 1;
+    char *ca_file = NULL;
+    network_spec_t networks[MAX_NETWORKS];
+    int network_count = 0;
 
     static struct option long_options[] = {
         {"server", required_argument, 0, 's'},
@@ -53,6 +326,9 @@ int main(int argc, char *argv[]) {
         {"user", required_argument, 0, 'u'},
         {"realname", required_argument, 0, 'r'},
         {"channel", required_argument, 0, 'c'},
+        {"network", required_argument, 0, 'N'},
+        {"insecure", no_argument, 0, OPT_INSECURE},
+        {"ca-file", required_argument, 0, OPT_CA_FILE},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 'v'},
         {0, 0, 0, 0}
@@ -60,7 +336,7 @@ int main(int argc, char *argv[]) {
 
     int opt;
     int option_index = 0;
-    while ((opt = getopt_long(argc, argv, "s:p:ln:u:r:c:hv", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "s:p:ln:u:r:c:N:hv", long_options, &option_index)) != -1) {
         switch (opt) {
             case 's':
                 server = optarg;
@@ -83,6 +359,25 @@ int main(int argc, char *argv[]) {
             case 'c':
                 channel = optarg;
                 break;
+            case OPT_INSECURE:
+                verify = 0;
+                break;
+            case OPT_CA_FILE:
+                ca_file = optarg;
+                break;
+            case 'N':
+                if (network_count >= MAX_NETWORKS) {
+                    fprintf(stderr, "Too many networks (max %d)\n", MAX_NETWORKS);
+                    exit(EXIT_FAILURE);
+                }
+                network_spec_defaults(&networks[network_count]);
+                if (parse_network_spec(optarg, &networks[network_count]) != 0) {
+                    fprintf(stderr, "Invalid network spec '%s'\n", optarg);
+                    fprintf(stderr, "Try '%s --help' for more information.\n", argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                network_count++;
+                break;
             case 'h':
                 printf("Usage: %s [OPTIONS]\n", argv[0]);
                 printf("  --server <server>  IRC server to connect to (default: irc.libera.chat)\n");
@@ -92,6 +387,18 @@ int main(int argc, char *argv[]) {
                 printf("  --user <user>      Username to use (default: chatter_user)\n");
                 printf("  --realname <name>  Real name to use (default: chatter_user)\n");
                 printf("  --channel <channel> Channel to join (default: #chatter)\n");
+                printf("  --network <spec>   Add a network, may be repeated. The spec is\n");
+                printf("                     name=host[:port][,ssl=0|1][,verify=0|1][,nick=N][,channel=C]\n");
+                printf("                     [,flood_burst=N][,flood_interval=MS][,ping_interval=MS]\n");
+                printf("                     [,ping_timeout=MS][,nodelay=0|1][,keepalive_idle=S]\n");
+                printf("                     [,keepalive_interval=S][,keepalive_count=N][,rcvbuf=BYTES]\n");
+                printf("                     [,sndbuf=BYTES][,user_timeout=MS][,sasl=plain|external]\n");
+                printf("                     [,sasl_user=U][,sasl_pass_file=FILE][,cert=FILE]\n");
+                printf("                     [,key=FILE], where sasl_pass_file holds the password\n");
+                printf("                     on its first line and must be chmod 600,\n");
+                printf("                     and overrides --server/--port when given\n");
+                printf("  --insecure         Do not verify server certificates\n");
+                printf("  --ca-file <file>   Also trust the CA certificates in this PEM file\n");
                 printf("  --help             Display this help message and exit\n");
                 printf("  --version          Display version information and exit\n");
                 printf("\n");
@@ -115,32 +422,98 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    log_message("Server: %s", server);
-    log_message("Port: %d", port);
-    log_message("SSL: %s", ssl ? "true" : "false");
-    log_message("Nick: %s", nick);
+    // Without --network, the classic options describe a single network
+    static char default_name[64];
+    if (network_count == 0) {
+        default_network_name(server, default_name, sizeof(default_name));
+        network_spec_defaults(&networks[0]);
+        networks[0].name = default_name;
+        networks[0].host = server;
+        networks[0].port = port;
+        networks[0].ssl = ssl;
+        network_count = 1;
+    }
+
     log_message("User: %s", user);
     log_message("Realname: %s", realname);
-    log_message("Channel: %s", channel);
+    for (int i = 0; i < network_count; i++) {
+        network_spec_t *net = &networks[i];
+        if (!net->nick) net->nick = nick;
+        if (!net->channel) net->channel = channel;
+        if (net->verify < 0) net->verify = verify;
+        log_message("Network %s: %s:%d SSL: %s Verify: %s Nick: %s Channel: %s Flood: %d burst, %lld ms/message "
+                    "Ping: every %lld ms, timeout %lld ms SASL: %s",
+                    net->name, net->host, net->port, net->ssl ? "true" : "false", net->verify ? "true" : "false",
+                    net->nick, net->channel, net->flood_burst, net->flood_interval_ms, net->ping_interval_ms,
+                    net->ping_timeout_ms, net->sasl_mechanism ? net->sasl_mechanism : "none");
+    }
+
+    if (tls_init(ca_file) != 0) {
+        fprintf(stderr, "Failed to initialize TLS, see chatter.log\n");
+        close_log();
+        return 1;
+    }
+    tls_session_cache_load(TLS_SESSION_CACHE_FILE);
+    log_message("Line framing: %s", linescan_name());
 
     tui_init();
 
-    Irc irc;
-    irc.server = server;
-    irc.nickname = nick;
-    irc.username = user;
-    irc.realname = realname;
-    if (irc_connect(&irc, server, port, nick, user, realname, channel, ssl) != 0) {
-        log_message("ERROR: Failed to connect to IRC server");
+    event_loop_t *loop = event_loop_create();
+    if (!loop || resolver_init(loop) != 0) {
+        log_message("ERROR: Failed to create event loop");
+        tui_destroy();
+        event_loop_destroy(loop);
+        tls_shutdown();
+        close_log();
+        return 1;
+    }
+
+    int started = 0;
+    for (int i = 0; i < network_count; i++) {
+        network_spec_t *net = &networks[i];
+        Irc *irc = irc_new(net->name);
+        if (!irc) {
+            log_message("ERROR: Failed to allocate network %s", net->name);
+            continue;
+        }
+        irc->tls_verify = net->verify;
+        flood_init(&irc->flood, net->flood_burst, net->flood_interval_ms);
+        irc->ping_interval_ms = net->ping_interval_ms;
+        irc->ping_timeout_ms = net->ping_timeout_ms;
+        irc->sockopts = net->sockopts;
+        irc->sasl_mechanism = net->sasl_mechanism;
+        irc->sasl_username = net->sasl_username;
+        irc->sasl_password = net->sasl_password;
+        irc->tls_cert_file = net->cert_file;
+        irc->tls_key_file = net->key_file;
+        irc_list_add(irc);
+        if (irc_connect(irc, loop, net->host, net->port, net->nick, user, realname, net->channel, net->ssl) != 0) {
+            log_message("ERROR: Failed to connect to IRC server %s", net->host);
+            irc_disconnect(irc);
+            buffer_append_message(irc_get_status_buffer(irc), "-!- Failed to connect");
+            continue;
+        }
+        started++;
+    }
+
+    if (started == 0) {
+        log_message("ERROR: Failed to connect to any IRC server");
         tui_destroy(); // Clean up TUI resources before exiting
+        irc_free_all();
+        tls_shutdown();
+        resolver_shutdown();
+        event_loop_destroy(loop);
         close_log();
         return 1;
     }
 
-    tui_run(&irc, channel);
+    tui_run(loop);
     tui_destroy();
 
-    irc_disconnect(&irc);
+    irc_free_all();
+    tls_shutdown();
+    resolver_shutdown();
+    event_loop_destroy(loop);
     close_log();
     
     return 0;
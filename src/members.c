@@ -0,0 +1,625 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <members.h>
+
+// Names looked up together by members_stage_names()
+#define MEMBERS_STAGE_BATCH 64
+// How far ahead members_commit() fetches user records
+#define MEMBERS_PREFETCH_DISTANCE 8
+
+// Marks a staged member whose channel list could not grow
+#define MEMBERS_UNLINKED (~0u)
+
+/*
+ * Users are found through the name pool: a nick's ID indexes the users
+ * array directly. Channel member sets are open-addressing tables with
+ * linear probing; deletion shifts the following run back instead of
+ * leaving tombstones, so a channel with heavy join/part traffic never
+ * degrades.
+ */
+
+static unsigned int set_hash(const member_user_t *user) {
+    // Fibonacci hashing of the address. Allocations are evenly spaced, so
+    // take the well-mixed high half of the product rather than the low bits.
+    return (unsigned int)(((uint64_t)(uintptr_t)user * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static int set_index_of(const member_set_t *set, const member_user_t *user) {
+    if (!set->slots) {
+        return -1;
+    }
+    int mask = set->capacity - 1;
+    for (int i = (int)(set_hash(user) & (unsigned int)mask); set->slots[i].user; i = (i + 1) & mask) {
+        if (set->slots[i].user == user) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void set_place(member_slot_t *slots, int capacity, member_slot_t slot) {
+    int mask = capacity - 1;
+    int i = (int)(set_hash(slot.user) & (unsigned int)mask);
+    while (slots[i].user) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+}
+
+/**
+ * @brief Makes room for count members in total without growing again.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int set_reserve(member_set_t *set, int count) {
+    if (set->slots && count * 4 <= set->capacity * 3) {
+        return 0;
+    }
+    int capacity = set->capacity ? set->capacity : MEMBERS_MIN_CAPACITY;
+    while (count * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    member_slot_t *grown = (member_slot_t *)calloc(capacity, sizeof(member_slot_t));
+    if (!grown) {
+        return -1;
+    }
+    for (int i = 0; i < set->capacity; i++) {
+        if (set->slots[i].user) {
+            set_place(grown, capacity, set->slots[i]);
+        }
+    }
+    free(set->slots);
+    set->slots = grown;
+    set->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Adds a member, or replaces the status bits of an existing one.
+ * @return 1 if the user was added, 0 if already present, -1 on failure.
+ */
+static int set_insert(member_set_t *set, member_user_t *user, unsigned int prefixes) {
+    if (set_reserve(set, set->count + 1) != 0) {
+        return -1;
+    }
+    // One probe either finds the user or ends at the free slot to use
+    int mask = set->capacity - 1;
+    int i = (int)(set_hash(user) & (unsigned int)mask);
+    while (set->slots[i].user) {
+        if (set->slots[i].user == user) {
+            set->slots[i].prefixes = prefixes;
+            return 0;
+        }
+        i = (i + 1) & mask;
+    }
+    set->slots[i] = (member_slot_t){user, prefixes};
+    set->count++;
+    return 1;
+}
+
+static bool set_remove(member_set_t *set, const member_user_t *user) {
+    int hole = set_index_of(set, user);
+    if (hole < 0) {
+        return false;
+    }
+    int mask = set->capacity - 1;
+    for (int i = (hole + 1) & mask; set->slots[i].user; i = (i + 1) & mask) {
+        int home = (int)(set_hash(set->slots[i].user) & (unsigned int)mask);
+        // Move the entry back if the hole lies between its home and its slot
+        if (hole <= i ? (home <= hole || home > i) : (home <= hole && home > i)) {
+            set->slots[hole] = set->slots[i];
+            hole = i;
+        }
+    }
+    set->slots[hole].user = NULL;
+    set->count--;
+    return true;
+}
+
+static void set_free(member_set_t *set) {
+    free(set->slots);
+    memset(set, 0, sizeof(member_set_t));
+}
+
+void members_init(members_t *members, intern_pool_t *pool) {
+    memset(members, 0, sizeof(members_t));
+    members->pool = pool;
+}
+
+static void members_free_user(members_t *members, member_user_t *user) {
+    members->users[user->nick] = NULL;
+    members->user_count--;
+    intern_release(members->pool, user->nick);
+    intern_release(members->pool, user->userhost);
+    if (user->channels != user->channels_inline) {
+        free(user->channels);
+    }
+    free(user);
+}
+
+static void members_free_channel(members_t *members, member_channel_t *channel) {
+    intern_release(members->pool, channel->name);
+    set_free(&channel->members);
+    set_free(&channel->staged);
+    free(channel);
+}
+
+void members_clear(members_t *members) {
+    for (intern_id_t id = 0; id < members->user_capacity; id++) {
+        if (members->users[id]) {
+            members_free_user(members, members->users[id]);
+        }
+    }
+    for (int i = 0; i < members->channel_count; i++) {
+        members_free_channel(members, members->channels[i]);
+    }
+    free(members->users);
+    free(members->channels);
+    members_init(members, members->pool);
+}
+
+const char* members_nick(const members_t *members, const member_user_t *user) {
+    return intern_str(members->pool, user->nick);
+}
+
+const char* members_channel_name(const members_t *members, const member_channel_t *channel) {
+    return intern_str(members->pool, channel->name);
+}
+
+member_channel_t* members_find_channel(members_t *members, const char *name, size_t len) {
+    intern_id_t id = intern_find(members->pool, name, len);
+    for (int i = 0; id && i < members->channel_count; i++) {
+        if (members->channels[i]->name == id) {
+            return members->channels[i];
+        }
+    }
+    return NULL;
+}
+
+member_channel_t* members_add_channel(members_t *members, const char *name, size_t len) {
+    member_channel_t *channel = members_find_channel(members, name, len);
+    if (channel) {
+        return channel;
+    }
+    if (members->channel_count == members->channel_capacity) {
+        int capacity = members->channel_capacity ? members->channel_capacity * 2 : MEMBERS_MIN_CAPACITY;
+        member_channel_t **grown = (member_channel_t **)realloc(members->channels, capacity * sizeof(member_channel_t *));
+        if (!grown) {
+            return NULL;
+        }
+        members->channels = grown;
+        members->channel_capacity = capacity;
+    }
+    channel = (member_channel_t *)calloc(1, sizeof(member_channel_t));
+    if (!channel || !(channel->name = intern_acquire(members->pool, name, len))) {
+        free(channel);
+        return NULL;
+    }
+    members->channels[members->channel_count++] = channel;
+    return channel;
+}
+
+static member_user_t* members_user_by_id(const members_t *members, intern_id_t id) {
+    return id && id < members->user_capacity ? members->users[id] : NULL;
+}
+
+member_user_t* members_find_user(members_t *members, const char *nick, size_t len) {
+    return members_user_by_id(members, intern_find(members->pool, nick, len));
+}
+
+/**
+ * @brief Makes the users array long enough to be indexed by any ID the pool has handed out.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int members_reserve_ids(members_t *members) {
+    intern_id_t needed = members->pool->entry_capacity;
+    if (needed <= members->user_capacity) {
+        return 0;
+    }
+    member_user_t **grown = (member_user_t **)realloc(members->users, needed * sizeof(member_user_t *));
+    if (!grown) {
+        return -1;
+    }
+    memset(grown + members->user_capacity, 0, (needed - members->user_capacity) * sizeof(member_user_t *));
+    members->users = grown;
+    members->user_capacity = needed;
+    return 0;
+}
+
+/**
+ * @brief Returns the user with this nick, adding an unlinked record if needed.
+ */
+static member_user_t* members_intern_hashed(members_t *members, const char *nick, size_t len, unsigned int hash) {
+    member_user_t *user = members_user_by_id(members, intern_find_hashed(members->pool, nick, len, hash));
+    if (user) {
+        return user;
+    }
+    user = (member_user_t *)calloc(1, sizeof(member_user_t));
+    if (!user) {
+        return NULL;
+    }
+    user->nick = intern_acquire_hashed(members->pool, nick, len, hash);
+    if (!user->nick || members_reserve_ids(members) != 0) {
+        intern_release(members->pool, user->nick);
+        free(user);
+        return NULL;
+    }
+    user->channels = user->channels_inline;
+    user->channel_capacity = MEMBERS_INLINE_CHANNELS;
+    members->users[user->nick] = user;
+    members->user_count++;
+    return user;
+}
+
+static member_user_t* members_intern_user(members_t *members, const char *nick, size_t len) {
+    return members_intern_hashed(members, nick, len, intern_hash(members->pool, nick, len));
+}
+
+/**
+ * @brief Frees a user that is neither in a channel nor in a pending NAMES list.
+ */
+static void members_release_user(members_t *members, member_user_t *user) {
+    if (user->channel_count == 0 && user->staged == 0) {
+        members_free_user(members, user);
+    }
+}
+
+void members_set_userhost(members_t *members, member_user_t *user, const char *userhost, size_t len) {
+    intern_id_t id = intern_acquire(members->pool, userhost, len);
+    if (id) {
+        intern_release(members->pool, user->userhost);
+        user->userhost = id;
+    }
+}
+
+bool members_contains(const member_channel_t *channel, const member_user_t *user) {
+    return set_index_of(&channel->members, user) >= 0;
+}
+
+unsigned int members_prefixes(const member_channel_t *channel, const member_user_t *user) {
+    int i = set_index_of(&channel->members, user);
+    return i >= 0 ? channel->members.slots[i].prefixes : 0;
+}
+
+void members_set_prefixes(member_channel_t *channel, member_user_t *user, unsigned int bits, bool add) {
+    int i = set_index_of(&channel->members, user);
+    if (i >= 0) {
+        if (add) {
+            channel->members.slots[i].prefixes |= bits;
+        } else {
+            channel->members.slots[i].prefixes &= ~bits;
+        }
+    }
+}
+
+/**
+ * @brief Adds the channel to a user's list of channels.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int members_link(member_user_t *user, member_channel_t *channel) {
+    if (user->channel_count == user->channel_capacity) {
+        int capacity = user->channel_capacity * 2;
+        member_channel_t **grown = (member_channel_t **)malloc(capacity * sizeof(member_channel_t *));
+        if (!grown) {
+            return -1;
+        }
+        memcpy(grown, user->channels, user->channel_count * sizeof(member_channel_t *));
+        if (user->channels != user->channels_inline) {
+            free(user->channels);
+        }
+        user->channels = grown;
+        user->channel_capacity = capacity;
+    }
+    user->channels[user->channel_count++] = channel;
+    return 0;
+}
+
+static void members_unlink_channel(member_user_t *user, const member_channel_t *channel) {
+    for (int j = 0; j < user->channel_count; j++) {
+        if (user->channels[j] == channel) {
+            user->channels[j] = user->channels[--user->channel_count];
+            break;
+        }
+    }
+}
+
+member_user_t* members_join(members_t *members, member_channel_t *channel, const char *nick, size_t len) {
+    member_user_t *user = members_intern_user(members, nick, len);
+    if (!user) {
+        return NULL;
+    }
+    if (!members_contains(channel, user)) {
+        if (set_reserve(&channel->members, channel->members.count + 1) != 0 || members_link(user, channel) != 0) {
+            members_release_user(members, user);
+            return NULL;
+        }
+        set_insert(&channel->members, user, 0);
+    }
+    // Someone joining while NAMES is being listed belongs in the new list too
+    if (channel->staging && set_index_of(&channel->staged, user) < 0 && set_insert(&channel->staged, user, 0) > 0) {
+        user->staged++;
+    }
+    return user;
+}
+
+static int members_begin_staging(member_channel_t *channel) {
+    if (!channel->staging) {
+        // Size for the list we already have; a first NAMES grows as it goes
+        set_free(&channel->staged);
+        if (set_reserve(&channel->staged, channel->members.count + 1) != 0) {
+            return -1;
+        }
+        channel->staging = true;
+    }
+    return 0;
+}
+
+static int members_stage_user(members_t *members, member_channel_t *channel, member_user_t *user,
+                              unsigned int prefixes) {
+    int added = set_insert(&channel->staged, user, prefixes);
+    if (added < 0) {
+        members_release_user(members, user);
+        return -1;
+    }
+    user->staged += added;
+    return 0;
+}
+
+int members_stage(members_t *members, member_channel_t *channel, const char *nick, size_t len,
+                  unsigned int prefixes) {
+    if (members_begin_staging(channel) != 0) {
+        return -1;
+    }
+    member_user_t *user = members_intern_user(members, nick, len);
+    if (!user) {
+        return -1;
+    }
+    return members_stage_user(members, channel, user, prefixes);
+}
+
+typedef struct {
+    const char *nick;
+    size_t len;
+    const char *userhost;           // NULL without userhost-in-names
+    size_t userhost_len;
+    unsigned int prefixes;
+    unsigned int hash;
+    member_user_t *user;
+} members_pending_t;
+
+/**
+ * @brief Frees the users a failed batch added but did not get to stage.
+ *
+ * They are looked up again rather than taken from the batch, since a nick
+ * listed twice shares one record and a failed stage has already freed its
+ * user.
+ */
+static void members_unwind(members_t *members, const members_pending_t *batch, int count) {
+    for (int i = 0; i < count; i++) {
+        member_user_t *user = members_user_by_id(members, intern_find_hashed(members->pool, batch[i].nick,
+                                                                             batch[i].len, batch[i].hash));
+        if (user) {
+            members_release_user(members, user);
+        }
+    }
+}
+
+int members_stage_names(members_t *members, member_channel_t *channel, const char *names, size_t len,
+                        const char *prefix_symbols) {
+    if (members_begin_staging(channel) != 0) {
+        return -1;
+    }
+    members_pending_t batch[MEMBERS_STAGE_BATCH];
+    const char *p = names;
+    const char *end = names + len;
+    int staged = 0;
+    while (p < end) {
+        int count = 0;
+        while (p < end && count < MEMBERS_STAGE_BATCH) {
+            const char *space = memchr(p, ' ', end - p);
+            const char *name_end = space ? space : end;
+            unsigned int prefixes = 0;
+            const char *symbol;
+            while (p < name_end && (symbol = strchr(prefix_symbols, *p)) != NULL) {
+                prefixes |= 1u << (symbol - prefix_symbols);
+                p++;
+            }
+            const char *bang = memchr(p, '!', name_end - p);
+            if (p < name_end && bang != p) {
+                members_pending_t *pending = &batch[count++];
+                pending->nick = p;
+                pending->len = (size_t)((bang ? bang : name_end) - p);
+                pending->userhost = bang ? bang + 1 : NULL;
+                pending->userhost_len = bang ? (size_t)(name_end - bang - 1) : 0;
+                pending->prefixes = prefixes;
+                pending->hash = intern_hash(members->pool, p, pending->len);
+                intern_prefetch(members->pool, pending->hash);
+            }
+            p = name_end + 1;
+        }
+
+        // Every lookup is a couple of cache misses in a large channel. The
+        // pool slots were fetched while splitting; look the IDs up and fetch
+        // the user records, so the misses overlap instead of being paid one
+        // at a time.
+        for (int i = 0; i < count; i++) {
+            batch[i].user = members_user_by_id(members, intern_find_hashed(members->pool, batch[i].nick, batch[i].len,
+                                                                           batch[i].hash));
+            if (batch[i].user) {
+                __builtin_prefetch(batch[i].user);
+            }
+        }
+        int set_mask = channel->staged.capacity - 1;
+        for (int i = 0; i < count; i++) {
+            if (!batch[i].user) {
+                batch[i].user = members_intern_hashed(members, batch[i].nick, batch[i].len, batch[i].hash);
+                if (!batch[i].user) {
+                    members_unwind(members, batch, count);
+                    return -1;
+                }
+            }
+            __builtin_prefetch(&channel->staged.slots[set_hash(batch[i].user) & (unsigned int)set_mask]);
+        }
+        for (int i = 0; i < count; i++) {
+            member_user_t *user = batch[i].user;
+            if (batch[i].userhost && batch[i].userhost_len > 0) {
+                members_set_userhost(members, user, batch[i].userhost, batch[i].userhost_len);
+            }
+            if (members_stage_user(members, channel, user, batch[i].prefixes) != 0) {
+                members_unwind(members, batch, count);
+                return -1;
+            }
+        }
+        staged += count;
+    }
+    return staged;
+}
+
+void members_commit(members_t *members, member_channel_t *channel) {
+    if (!channel->staging) {
+        return;
+    }
+    member_set_t *staged = &channel->staged;
+    int unlinked = 0;
+    int kept = 0;
+    for (int i = 0; i < staged->capacity; i++) {
+        // Fetch the record a few slots ahead; it is written to below
+        if (i + MEMBERS_PREFETCH_DISTANCE < staged->capacity && staged->slots[i + MEMBERS_PREFETCH_DISTANCE].user) {
+            __builtin_prefetch(staged->slots[i + MEMBERS_PREFETCH_DISTANCE].user, 1);
+        }
+        member_user_t *user = staged->slots[i].user;
+        if (!user) {
+            continue;
+        }
+        user->staged--;
+        if (members_contains(channel, user)) {
+            kept++;
+        } else if (members_link(user, channel) != 0) {
+            staged->slots[i].prefixes = MEMBERS_UNLINKED;
+            unlinked++;
+        }
+    }
+    // Out of memory: leave out whoever could not be linked. Removing shifts
+    // entries, so look for the next one from the start each time.
+    for (int i = 0; unlinked > 0 && i < staged->capacity; i++) {
+        member_user_t *user = staged->slots[i].user;
+        if (user && staged->slots[i].prefixes == MEMBERS_UNLINKED) {
+            set_remove(staged, user);
+            members_release_user(members, user);
+            unlinked--;
+            i = -1;
+        }
+    }
+
+    // Anyone listed before but not now has left without us seeing it. If
+    // every old member was listed again there is nobody to look for.
+    member_set_t *old = &channel->members;
+    for (int i = 0; kept < old->count && i < old->capacity; i++) {
+        member_user_t *user = old->slots[i].user;
+        if (user && set_index_of(staged, user) < 0) {
+            members_unlink_channel(user, channel);
+            members_release_user(members, user);
+        }
+    }
+    set_free(old);
+    *old = *staged;
+    memset(staged, 0, sizeof(member_set_t));
+    channel->staging = false;
+    channel->synced = true;
+}
+
+/**
+ * @brief Drops a user from a channel's pending NAMES list.
+ */
+static void members_unstage(member_channel_t *channel, member_user_t *user) {
+    if (channel->staging && set_remove(&channel->staged, user)) {
+        user->staged--;
+    }
+}
+
+void members_part(members_t *members, member_channel_t *channel, member_user_t *user) {
+    if (set_remove(&channel->members, user)) {
+        members_unlink_channel(user, channel);
+    }
+    members_unstage(channel, user);
+    members_release_user(members, user);
+}
+
+void members_remove_user(members_t *members, member_user_t *user) {
+    while (user->channel_count > 0) {
+        member_channel_t *channel = user->channels[--user->channel_count];
+        set_remove(&channel->members, user);
+    }
+    for (int i = 0; user->staged > 0 && i < members->channel_count; i++) {
+        members_unstage(members->channels[i], user);
+    }
+    members_release_user(members, user);
+}
+
+void members_remove_channel(members_t *members, member_channel_t *channel) {
+    for (int pass = 0; pass < 2; pass++) {
+        member_set_t *set = pass == 0 ? &channel->members : &channel->staged;
+        for (int i = 0; i < set->capacity; i++) {
+            member_user_t *user = set->slots[i].user;
+            if (!user) {
+                continue;
+            }
+            if (pass == 0) {
+                members_unlink_channel(user, channel);
+            } else {
+                user->staged--;
+            }
+            members_release_user(members, user);
+        }
+    }
+    for (int i = 0; i < members->channel_count; i++) {
+        if (members->channels[i] == channel) {
+            members->channels[i] = members->channels[--members->channel_count];
+            break;
+        }
+    }
+    members_free_channel(members, channel);
+}
+
+int members_rename(members_t *members, member_user_t *user, const char *nick, size_t len) {
+    intern_id_t id = intern_acquire(members->pool, nick, len);
+    if (!id || members_reserve_ids(members) != 0) {
+        intern_release(members->pool, id);
+        return -1;
+    }
+    // The name may already be interned under another case; show it as given
+    intern_respell(members->pool, id, nick, len);
+    if (id == user->nick) {
+        intern_release(members->pool, id);
+        return 0;
+    }
+    // Someone already known under the new nick is stale; the server has
+    // just told us the name belongs to this user.
+    member_user_t *existing = members_user_by_id(members, id);
+    if (existing) {
+        members_remove_user(members, existing);
+    }
+    members->users[user->nick] = NULL;
+    intern_release(members->pool, user->nick);
+    user->nick = id;
+    members->users[id] = user;
+    return 0;
+}
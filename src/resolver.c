@@ -0,0 +1,410 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include <resolver.h>
+#include <log.h>
+
+struct resolver_request {
+    char host[256];
+    char port[8];
+    resolver_cb cb;
+    void *data;
+    bool cancelled;
+    bool primary;          // Owns the getaddrinfo() call for its name
+    struct addrinfo *result;
+    bool result_is_copy;   // Allocated by copy_addrinfo() rather than getaddrinfo()
+    int error;
+    bool from_cache;
+    long long started_ms;
+    struct resolver_request *next;
+};
+
+typedef struct {
+    char host[256];
+    char port[8];
+    struct addrinfo *result; // NULL for a negative entry
+    int error;
+    long long expires_ms;
+} resolver_cache_entry_t;
+
+// Everything below is shared with the workers and guarded by resolver_mutex,
+// except the cache, which is only touched on the event loop thread.
+static pthread_mutex_t resolver_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t resolver_cond = PTHREAD_COND_INITIALIZER;
+static bool resolver_running = false;
+static int resolver_event_fd = -1;
+static event_loop_t *resolver_loop = NULL;
+
+static resolver_request_t *work_head = NULL; // Primaries waiting for a worker
+static resolver_request_t *work_tail = NULL;
+static resolver_request_t *pending = NULL;   // Primaries being resolved
+static resolver_request_t *waiting = NULL;   // Followers of an in-flight primary
+static resolver_request_t *done = NULL;      // Completed, awaiting dispatch
+
+static resolver_cache_entry_t cache[RESOLVER_CACHE_MAX_ENTRIES];
+
+static bool same_name(const char *host_a, const char *port_a, const char *host_b, const char *port_b) {
+    return strcmp(host_a, host_b) == 0 && strcmp(port_a, port_b) == 0;
+}
+
+static void free_addrinfo_copy(struct addrinfo *ai) {
+    while (ai) {
+        struct addrinfo *next = ai->ai_next;
+        free(ai->ai_addr);
+        free(ai->ai_canonname);
+        free(ai);
+        ai = next;
+    }
+}
+
+static struct addrinfo *copy_addrinfo(const struct addrinfo *src) {
+    struct addrinfo *head = NULL;
+    struct addrinfo **tail = &head;
+    for (; src; src = src->ai_next) {
+        struct addrinfo *ai = (struct addrinfo *)calloc(1, sizeof(struct addrinfo));
+        if (!ai) {
+            free_addrinfo_copy(head);
+            return NULL;
+        }
+        *ai = *src;
+        ai->ai_next = NULL;
+        ai->ai_canonname = NULL;
+        ai->ai_addr = (struct sockaddr *)malloc(src->ai_addrlen);
+        if (!ai->ai_addr) {
+            free(ai);
+            free_addrinfo_copy(head);
+            return NULL;
+        }
+        memcpy(ai->ai_addr, src->ai_addr, src->ai_addrlen);
+        *tail = ai;
+        tail = &ai->ai_next;
+    }
+    return head;
+}
+
+static void free_request(resolver_request_t *req) {
+    if (req->result) {
+        if (req->result_is_copy) {
+            free_addrinfo_copy(req->result);
+        } else {
+            freeaddrinfo(req->result);
+        }
+    }
+    free(req);
+}
+
+static void unlink_request(resolver_request_t **list, resolver_request_t *req) {
+    for (resolver_request_t **p = list; *p; p = &(*p)->next) {
+        if (*p == req) {
+            *p = req->next;
+            req->next = NULL;
+            return;
+        }
+    }
+}
+
+// Must be called with resolver_mutex held
+static void complete_locked(resolver_request_t *req) {
+    req->next = done;
+    done = req;
+    uint64_t one = 1;
+    if (resolver_event_fd >= 0 && write(resolver_event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        log_message("ERROR: Failed to signal resolver completion: %s", strerror(errno));
+    }
+}
+
+static void *resolver_worker(void *arg) {
+    pthread_mutex_lock(&resolver_mutex);
+    for (;;) {
+        while (resolver_running && !work_head) {
+            pthread_cond_wait(&resolver_cond, &resolver_mutex);
+        }
+        if (!resolver_running) {
+            break;
+        }
+
+        resolver_request_t *req = work_head;
+        work_head = req->next;
+        if (!work_head) {
+            work_tail = NULL;
+        }
+        req->next = pending;
+        pending = req;
+        pthread_mutex_unlock(&resolver_mutex);
+
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo *res = NULL;
+        int error = getaddrinfo(req->host, req->port, &hints, &res);
+
+        pthread_mutex_lock(&resolver_mutex);
+        unlink_request(&pending, req);
+        req->error = error;
+        req->result = error == 0 ? res : NULL;
+        if (resolver_running) {
+            complete_locked(req);
+        } else {
+            free_request(req);
+        }
+    }
+    pthread_mutex_unlock(&resolver_mutex);
+    return NULL;
+}
+
+static resolver_cache_entry_t *cache_find(const char *host, const char *port) {
+    long long now = event_loop_now_ms();
+    for (int i = 0; i < RESOLVER_CACHE_MAX_ENTRIES; i++) {
+        resolver_cache_entry_t *entry = &cache[i];
+        if (entry->expires_ms > now && same_name(entry->host, entry->port, host, port)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void cache_store(const resolver_request_t *req) {
+    // Reuse the slot for this name, else an expired slot, else the one closest to expiry
+    resolver_cache_entry_t *slot = NULL;
+    long long now = event_loop_now_ms();
+    for (int i = 0; i < RESOLVER_CACHE_MAX_ENTRIES; i++) {
+        resolver_cache_entry_t *entry = &cache[i];
+        if (same_name(entry->host, entry->port, req->host, req->port) || entry->expires_ms <= now) {
+            slot = entry;
+            break;
+        }
+        if (!slot || entry->expires_ms < slot->expires_ms) {
+            slot = entry;
+        }
+    }
+
+    free_addrinfo_copy(slot->result);
+    slot->result = NULL;
+    if (req->error == 0) {
+        slot->result = copy_addrinfo(req->result);
+        if (!slot->result) {
+            slot->expires_ms = 0;
+            return;
+        }
+    }
+    snprintf(slot->host, sizeof(slot->host), "%s", req->host);
+    snprintf(slot->port, sizeof(slot->port), "%s", req->port);
+    slot->error = req->error;
+    slot->expires_ms = now + (req->error == 0 ? RESOLVER_CACHE_TTL_MS : RESOLVER_NEGATIVE_TTL_MS);
+}
+
+static void dispatch(resolver_request_t *req, const struct addrinfo *res, int error, bool from_cache) {
+    if (req->cancelled) {
+        return;
+    }
+    log_message("Resolved %s:%s in %lld ms%s%s%s", req->host, req->port, event_loop_now_ms() - req->started_ms,
+                from_cache ? " (cache hit)" : "", error ? ": " : "", error ? gai_strerror(error) : "");
+    req->cb(res, error, from_cache, req->data);
+}
+
+static void resolver_event_cb(event_loop_t *loop, int fd, int events, void *data) {
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        log_message("ERROR: Failed to read resolver eventfd: %s", strerror(errno));
+    }
+
+    pthread_mutex_lock(&resolver_mutex);
+    resolver_request_t *completed = done;
+    done = NULL;
+    pthread_mutex_unlock(&resolver_mutex);
+
+    while (completed) {
+        resolver_request_t *req = completed;
+        completed = req->next;
+
+        if (req->primary) {
+            cache_store(req);
+
+            // Detach followers first; callbacks may start new lookups
+            resolver_request_t *followers = NULL;
+            pthread_mutex_lock(&resolver_mutex);
+            for (resolver_request_t **p = &waiting; *p;) {
+                resolver_request_t *w = *p;
+                if (same_name(w->host, w->port, req->host, req->port)) {
+                    *p = w->next;
+                    w->next = followers;
+                    followers = w;
+                } else {
+                    p = &w->next;
+                }
+            }
+            pthread_mutex_unlock(&resolver_mutex);
+
+            dispatch(req, req->result, req->error, req->from_cache);
+            while (followers) {
+                resolver_request_t *w = followers;
+                followers = w->next;
+                dispatch(w, req->result, req->error, false);
+                free_request(w);
+            }
+        } else {
+            dispatch(req, req->result, req->error, req->from_cache);
+        }
+        free_request(req);
+    }
+}
+
+int resolver_init(event_loop_t *loop) {
+    resolver_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (resolver_event_fd < 0) {
+        log_message("ERROR: Failed to create resolver eventfd: %s", strerror(errno));
+        return -1;
+    }
+    if (event_loop_add_fd(loop, resolver_event_fd, EVENT_READ, resolver_event_cb, NULL) != 0) {
+        close(resolver_event_fd);
+        resolver_event_fd = -1;
+        return -1;
+    }
+    resolver_loop = loop;
+    resolver_running = true;
+
+    int started = 0;
+    for (int i = 0; i < RESOLVER_WORKERS; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, resolver_worker, NULL) == 0) {
+            // Workers may be stuck in getaddrinfo() at exit; never wait for them
+            pthread_detach(thread);
+            started++;
+        }
+    }
+    if (started == 0) {
+        log_message("ERROR: Failed to start resolver threads");
+        resolver_shutdown();
+        return -1;
+    }
+    return 0;
+}
+
+void resolver_shutdown(void) {
+    pthread_mutex_lock(&resolver_mutex);
+    resolver_running = false;
+    pthread_cond_broadcast(&resolver_cond);
+
+    // Requests still inside getaddrinfo() are freed by their worker
+    resolver_request_t *lists[] = { work_head, waiting, done };
+    for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+        while (lists[i]) {
+            resolver_request_t *next = lists[i]->next;
+            free_request(lists[i]);
+            lists[i] = next;
+        }
+    }
+    work_head = work_tail = NULL;
+    waiting = NULL;
+    done = NULL;
+
+    if (resolver_event_fd >= 0) {
+        if (resolver_loop) {
+            event_loop_remove_fd(resolver_loop, resolver_event_fd);
+        }
+        close(resolver_event_fd);
+        resolver_event_fd = -1;
+    }
+    resolver_loop = NULL;
+    pthread_mutex_unlock(&resolver_mutex);
+
+    for (int i = 0; i < RESOLVER_CACHE_MAX_ENTRIES; i++) {
+        free_addrinfo_copy(cache[i].result);
+        memset(&cache[i], 0, sizeof(cache[i]));
+    }
+}
+
+resolver_request_t* resolver_lookup(const char *host, int port, resolver_cb cb, void *data) {
+    if (!host || !cb || !resolver_running) {
+        return NULL;
+    }
+
+    resolver_request_t *req = (resolver_request_t *)calloc(1, sizeof(resolver_request_t));
+    if (!req) {
+        return NULL;
+    }
+    snprintf(req->host, sizeof(req->host), "%s", host);
+    snprintf(req->port, sizeof(req->port), "%d", port);
+    req->cb = cb;
+    req->data = data;
+    req->started_ms = event_loop_now_ms();
+
+    resolver_cache_entry_t *entry = cache_find(req->host, req->port);
+    if (entry) {
+        req->error = entry->error;
+        if (entry->result) {
+            req->result = copy_addrinfo(entry->result);
+            req->result_is_copy = true;
+            if (!req->result) {
+                free(req);
+                return NULL;
+            }
+        }
+        req->from_cache = true;
+        pthread_mutex_lock(&resolver_mutex);
+        complete_locked(req);
+        pthread_mutex_unlock(&resolver_mutex);
+        return req;
+    }
+
+    pthread_mutex_lock(&resolver_mutex);
+    bool in_flight = false;
+    resolver_request_t *lists[] = { work_head, pending };
+    for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]) && !in_flight; i++) {
+        for (resolver_request_t *p = lists[i]; p; p = p->next) {
+            if (same_name(p->host, p->port, req->host, req->port)) {
+                in_flight = true;
+                break;
+            }
+        }
+    }
+
+    if (in_flight) {
+        req->next = waiting;
+        waiting = req;
+    } else {
+        req->primary = true;
+        if (work_tail) {
+            work_tail->next = req;
+        } else {
+            work_head = req;
+        }
+        work_tail = req;
+        pthread_cond_signal(&resolver_cond);
+    }
+    pthread_mutex_unlock(&resolver_mutex);
+    return req;
+}
+
+void resolver_cancel(resolver_request_t *req) {
+    if (req) {
+        req->cancelled = true;
+    }
+}
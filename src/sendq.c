@@ -0,0 +1,206 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <sendq.h>
+
+struct sendq_chunk {
+    struct sendq_chunk *next;
+    size_t len;
+    char data[];
+};
+
+void sendq_init(sendq_t *q) {
+    memset(q, 0, sizeof(sendq_t));
+}
+
+void sendq_clear(sendq_t *q) {
+    sendq_chunk_t *chunk = q->head;
+    while (chunk) {
+        sendq_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(q->staging);
+    sendq_init(q);
+}
+
+int sendq_push(sendq_t *q, const char *data, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    sendq_chunk_t *chunk = (sendq_chunk_t *)malloc(sizeof(sendq_chunk_t) + len);
+    if (!chunk) {
+        return -1;
+    }
+    chunk->next = NULL;
+    chunk->len = len;
+    memcpy(chunk->data, data, len);
+
+    if (q->tail) {
+        q->tail->next = chunk;
+    } else {
+        q->head = chunk;
+    }
+    q->tail = chunk;
+    q->bytes += len;
+    q->chunks++;
+    return 0;
+}
+
+bool sendq_empty(const sendq_t *q) {
+    return q->bytes == 0;
+}
+
+int sendq_depth(const sendq_t *q) {
+    return q->chunks + q->staged_lines;
+}
+
+static int count_lines(const char *data, size_t len) {
+    int lines = 0;
+    const char *end = data + len;
+    while ((data = memchr(data, '\n', (size_t)(end - data))) != NULL) {
+        lines++;
+        data++;
+    }
+    return lines;
+}
+
+/**
+ * Marks count bytes from the front of the chunk list as written.
+ */
+static void sendq_consume(sendq_t *q, size_t count) {
+    while (count > 0 && q->head) {
+        size_t left = q->head->len - q->head_offset;
+        if (count < left) {
+            q->head_offset += count;
+            return;
+        }
+        count -= left;
+        sendq_chunk_t *done = q->head;
+        q->head = done->next;
+        if (!q->head) {
+            q->tail = NULL;
+        }
+        q->head_offset = 0;
+        q->chunks--;
+        free(done);
+    }
+}
+
+static int sendq_flush_plain(sendq_t *q, int fd, int *writes) {
+    while (q->head) {
+        struct iovec iov[SENDQ_MAX_IOV];
+        int iov_count = 0;
+        size_t batch = 0;
+        for (sendq_chunk_t *chunk = q->head; chunk && iov_count < SENDQ_MAX_IOV; chunk = chunk->next) {
+            size_t skip = chunk == q->head ? q->head_offset : 0;
+            iov[iov_count].iov_base = chunk->data + skip;
+            iov[iov_count].iov_len = chunk->len - skip;
+            batch += iov[iov_count].iov_len;
+            iov_count++;
+        }
+
+        // sendmsg() is writev() with MSG_NOSIGNAL, so a dead peer is an error, not SIGPIPE
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_count;
+        ssize_t written = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (writes) {
+            (*writes)++;
+        }
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? SENDQ_PENDING : -1;
+        }
+
+        sendq_consume(q, (size_t)written);
+        q->bytes -= (size_t)written;
+        if ((size_t)written < batch) {
+            return SENDQ_PENDING;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Moves whole and partial chunks into the staging buffer until it holds
+ * one record's worth of data.
+ */
+static void sendq_fill_staging(sendq_t *q) {
+    while (q->head && q->staging_len < SENDQ_TLS_STAGING_SIZE) {
+        size_t left = q->head->len - q->head_offset;
+        size_t room = SENDQ_TLS_STAGING_SIZE - q->staging_len;
+        size_t take = left < room ? left : room;
+        memcpy(q->staging + q->staging_len, q->head->data + q->head_offset, take);
+        q->staged_lines += count_lines(q->staging + q->staging_len, take);
+        q->staging_len += take;
+        sendq_consume(q, take);
+    }
+}
+
+static int sendq_flush_tls(sendq_t *q, SSL *ssl, int *writes) {
+    if (!q->staging) {
+        q->staging = (char *)malloc(SENDQ_TLS_STAGING_SIZE);
+        if (!q->staging) {
+            return -1;
+        }
+    }
+
+    while (q->bytes > 0) {
+        // After a WANT_WRITE the staged bytes must be offered again as they
+        // were; appending behind them is allowed with a moving write buffer.
+        sendq_fill_staging(q);
+
+        int written = SSL_write(ssl, q->staging, (int)q->staging_len);
+        if (writes) {
+            (*writes)++;
+        }
+        if (written <= 0) {
+            switch (SSL_get_error(ssl, written)) {
+                case SSL_ERROR_WANT_READ:
+                case SSL_ERROR_WANT_WRITE:
+                    return SENDQ_PENDING;
+                default:
+                    return -1;
+            }
+        }
+
+        q->staged_lines -= count_lines(q->staging, (size_t)written);
+        q->staging_len -= (size_t)written;
+        if (q->staging_len > 0) {
+            memmove(q->staging, q->staging + written, q->staging_len);
+        }
+        q->bytes -= (size_t)written;
+    }
+    return 0;
+}
+
+int sendq_flush(sendq_t *q, int fd, SSL *ssl, int *writes) {
+    if (q->bytes == 0) {
+        return 0;
+    }
+    return ssl ? sendq_flush_tls(q, ssl, writes) : sendq_flush_plain(q, fd, writes);
+}
@@ -0,0 +1,94 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <sockopt.h>
+#include <log.h>
+
+void sockopt_defaults(sockopt_t *opts) {
+    memset(opts, 0, sizeof(sockopt_t));
+    opts->nodelay = true;
+    opts->keepalive_idle_s = SOCKOPT_DEFAULT_KEEPALIVE_IDLE_S;
+    opts->keepalive_interval_s = SOCKOPT_DEFAULT_KEEPALIVE_INTERVAL_S;
+    opts->keepalive_count = SOCKOPT_DEFAULT_KEEPALIVE_COUNT;
+    opts->user_timeout_ms = SOCKOPT_DEFAULT_USER_TIMEOUT_MS;
+}
+
+static int set_int(int fd, int level, int name, int value, const char *what, const char *label) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) != 0) {
+        log_message("ERROR: %s: failed to set %s to %d: %s", label, what, value, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int sockopt_apply(int fd, const sockopt_t *opts, const char *label) {
+    int ret = 0;
+    if (opts->nodelay) {
+        ret |= set_int(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY", label);
+    }
+    if (opts->keepalive_idle_s > 0) {
+        ret |= set_int(fd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE", label);
+        ret |= set_int(fd, IPPROTO_TCP, TCP_KEEPIDLE, opts->keepalive_idle_s, "TCP_KEEPIDLE", label);
+        if (opts->keepalive_interval_s > 0) {
+            ret |= set_int(fd, IPPROTO_TCP, TCP_KEEPINTVL, opts->keepalive_interval_s, "TCP_KEEPINTVL", label);
+        }
+        if (opts->keepalive_count > 0) {
+            ret |= set_int(fd, IPPROTO_TCP, TCP_KEEPCNT, opts->keepalive_count, "TCP_KEEPCNT", label);
+        }
+    }
+    if (opts->rcvbuf > 0) {
+        ret |= set_int(fd, SOL_SOCKET, SO_RCVBUF, opts->rcvbuf, "SO_RCVBUF", label);
+    }
+    if (opts->sndbuf > 0) {
+        ret |= set_int(fd, SOL_SOCKET, SO_SNDBUF, opts->sndbuf, "SO_SNDBUF", label);
+    }
+#ifdef TCP_USER_TIMEOUT
+    if (opts->user_timeout_ms > 0) {
+        ret |= set_int(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, opts->user_timeout_ms, "TCP_USER_TIMEOUT", label);
+    }
+#endif
+    return ret ? -1 : 0;
+}
+
+static int get_int(int fd, int level, int name) {
+    int value = -1;
+    socklen_t len = sizeof(value);
+    if (getsockopt(fd, level, name, &value, &len) != 0) {
+        return -1;
+    }
+    return value;
+}
+
+void sockopt_log_effective(int fd, const char *label) {
+    int user_timeout = -1;
+#ifdef TCP_USER_TIMEOUT
+    user_timeout = get_int(fd, IPPROTO_TCP, TCP_USER_TIMEOUT);
+#endif
+    // Linux reports buffer sizes doubled to include its bookkeeping overhead
+    log_message("Socket %s: nodelay %d, keepalive %d (idle %d s, interval %d s, count %d), "
+                "rcvbuf %d, sndbuf %d, user timeout %d ms",
+                label, get_int(fd, IPPROTO_TCP, TCP_NODELAY), get_int(fd, SOL_SOCKET, SO_KEEPALIVE),
+                get_int(fd, IPPROTO_TCP, TCP_KEEPIDLE), get_int(fd, IPPROTO_TCP, TCP_KEEPINTVL),
+                get_int(fd, IPPROTO_TCP, TCP_KEEPCNT), get_int(fd, SOL_SOCKET, SO_RCVBUF),
+                get_int(fd, SOL_SOCKET, SO_SNDBUF), user_timeout);
+}
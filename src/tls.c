@@ -0,0 +1,414 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+
+#include <tls.h>
+#include <log.h>
+
+typedef struct {
+    char *key;             // "host:port"
+    SSL_SESSION *session;
+} tls_session_entry_t;
+
+// ALPN protocol id for IRC as registered with IANA
+static const unsigned char alpn_protos[] = { 3, 'i', 'r', 'c' };
+
+static SSL_CTX *client_ctx = NULL;
+
+static tls_session_entry_t session_cache[TLS_SESSION_CACHE_MAX_ENTRIES];
+static char *session_cache_path = NULL;
+static int session_ex_index = -1;
+static unsigned long session_hits = 0;
+static unsigned long session_misses = 0;
+
+static void session_key_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx, long argl, void *argp) {
+    free(ptr);
+}
+
+static int session_key_index(void) {
+    if (session_ex_index < 0) {
+        session_ex_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, session_key_free);
+    }
+    return session_ex_index;
+}
+
+static bool session_usable(SSL_SESSION *session) {
+    if (!session || !SSL_SESSION_is_resumable(session)) {
+        return false;
+    }
+    return (time_t)(SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session)) > time(NULL);
+}
+
+static tls_session_entry_t *session_find(const char *key) {
+    for (int i = 0; i < TLS_SESSION_CACHE_MAX_ENTRIES; i++) {
+        if (session_cache[i].key && strcmp(session_cache[i].key, key) == 0) {
+            return &session_cache[i];
+        }
+    }
+    return NULL;
+}
+
+static void session_entry_clear(tls_session_entry_t *entry) {
+    free(entry->key);
+    SSL_SESSION_free(entry->session);
+    entry->key = NULL;
+    entry->session = NULL;
+}
+
+/**
+ * Takes ownership of the session reference. Replaces the entry for the same
+ * key, else an empty or expired slot, else the oldest session.
+ */
+static void session_put(const char *key, SSL_SESSION *session) {
+    tls_session_entry_t *slot = session_find(key);
+    if (!slot) {
+        for (int i = 0; i < TLS_SESSION_CACHE_MAX_ENTRIES; i++) {
+            tls_session_entry_t *entry = &session_cache[i];
+            if (!entry->key || !session_usable(entry->session)) {
+                slot = entry;
+                break;
+            }
+            if (!slot || SSL_SESSION_get_time(entry->session) < SSL_SESSION_get_time(slot->session)) {
+                slot = entry;
+            }
+        }
+    }
+
+    char *key_copy = strdup(key);
+    if (!key_copy) {
+        SSL_SESSION_free(session);
+        return;
+    }
+    session_entry_clear(slot);
+    slot->key = key_copy;
+    slot->session = session;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void session_cache_save(void) {
+    if (!session_cache_path) {
+        return;
+    }
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", session_cache_path);
+    // Session secrets allow resuming as us, so keep the file private
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        log_message("ERROR: Failed to write TLS session cache %s: %s", tmp_path, strerror(errno));
+        return;
+    }
+    FILE *file = fdopen(fd, "w");
+    if (!file) {
+        close(fd);
+        return;
+    }
+
+    int saved = 0;
+    for (int i = 0; i < TLS_SESSION_CACHE_MAX_ENTRIES; i++) {
+        tls_session_entry_t *entry = &session_cache[i];
+        if (!entry->key || !session_usable(entry->session)) {
+            continue;
+        }
+        unsigned char *der = NULL;
+        int der_len = i2d_SSL_SESSION(entry->session, &der);
+        if (der_len <= 0) {
+            continue;
+        }
+        fprintf(file, "%s ", entry->key);
+        for (int j = 0; j < der_len; j++) {
+            fprintf(file, "%02x", der[j]);
+        }
+        fputc('\n', file);
+        OPENSSL_free(der);
+        saved++;
+    }
+
+    if (fclose(file) != 0 || rename(tmp_path, session_cache_path) != 0) {
+        log_message("ERROR: Failed to save TLS session cache %s: %s", session_cache_path, strerror(errno));
+        unlink(tmp_path);
+        return;
+    }
+    log_message("Saved %d TLS session(s) to %s", saved, session_cache_path);
+}
+
+static int new_session_cb(SSL *ssl, SSL_SESSION *session) {
+    const char *key = (const char *)SSL_get_ex_data(ssl, session_key_index());
+    if (!key || !session_usable(session)) {
+        return 0; // We did not keep a reference
+    }
+    session_put(key, session);
+    session_cache_save();
+    return 1;
+}
+
+int tls_session_cache_load(const char *path) {
+    free(session_cache_path);
+    session_cache_path = strdup(path);
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    int loaded = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t line_len;
+    while ((line_len = getline(&line, &line_capacity, file)) > 0) {
+        char *space = strchr(line, ' ');
+        if (!space) {
+            continue;
+        }
+        *space = '\0';
+        char *hex = space + 1;
+        size_t hex_len = strcspn(hex, "\r\n");
+        if (hex_len == 0 || hex_len % 2 != 0) {
+            continue;
+        }
+
+        unsigned char *der = (unsigned char *)malloc(hex_len / 2);
+        if (!der) {
+            break;
+        }
+        bool valid = true;
+        for (size_t i = 0; i < hex_len / 2; i++) {
+            int hi = hex_value(hex[2 * i]);
+            int lo = hex_value(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0) {
+                valid = false;
+                break;
+            }
+            der[i] = (unsigned char)(hi << 4 | lo);
+        }
+
+        const unsigned char *p = der;
+        SSL_SESSION *session = valid ? d2i_SSL_SESSION(NULL, &p, (long)(hex_len / 2)) : NULL;
+        free(der);
+        if (session_usable(session)) {
+            session_put(line, session);
+            loaded++;
+        } else {
+            SSL_SESSION_free(session);
+        }
+    }
+    free(line);
+    fclose(file);
+
+    log_message("Loaded %d TLS session(s) from %s", loaded, path);
+    return loaded;
+}
+
+void tls_session_cache_free(void) {
+    for (int i = 0; i < TLS_SESSION_CACHE_MAX_ENTRIES; i++) {
+        session_entry_clear(&session_cache[i]);
+    }
+    free(session_cache_path);
+    session_cache_path = NULL;
+}
+
+static void log_ssl_errors(const char *what) {
+    unsigned long err;
+    char err_buf[256];
+    while ((err = ERR_get_error()) != 0) {
+        ERR_error_string_n(err, err_buf, sizeof(err_buf));
+        log_message("ERROR: %s: %s", what, err_buf);
+    }
+}
+
+int tls_init(const char *ca_file) {
+    if (client_ctx) {
+        return 0;
+    }
+
+    if (OPENSSL_init_ssl(OPENSSL_INIT_LOAD_SSL_STRINGS | OPENSSL_INIT_LOAD_CRYPTO_STRINGS, NULL) != 1) {
+        log_ssl_errors("Failed to initialize OpenSSL");
+        return -1;
+    }
+
+    client_ctx = SSL_CTX_new(TLS_client_method());
+    if (!client_ctx) {
+        log_ssl_errors("Failed to create SSL context");
+        return -1;
+    }
+    SSL_CTX_set_min_proto_version(client_ctx, TLS1_2_VERSION);
+    // The send queue may retry a write from a refilled buffer and accepts short writes
+    SSL_CTX_set_mode(client_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    // Pull as many records per read() as fit; the receive path drains
+    // them with SSL_has_pending() since epoll cannot see them.
+    SSL_CTX_set_read_ahead(client_ctx, 1);
+    SSL_CTX_set_verify(client_ctx, SSL_VERIFY_PEER, NULL);
+
+    // The CA store is loaded once here instead of on every connect
+    if (SSL_CTX_set_default_verify_paths(client_ctx) != 1) {
+        log_ssl_errors("Failed to load the default CA store");
+    }
+    if (ca_file && SSL_CTX_load_verify_locations(client_ctx, ca_file, NULL) != 1) {
+        log_ssl_errors("Failed to load CA file");
+        SSL_CTX_free(client_ctx);
+        client_ctx = NULL;
+        return -1;
+    }
+
+    if (SSL_CTX_set_alpn_protos(client_ctx, alpn_protos, sizeof(alpn_protos)) != 0) {
+        log_ssl_errors("Failed to configure ALPN");
+    }
+
+    // Sessions live in our cache, keyed by server, not in OpenSSL's own
+    SSL_CTX_set_session_cache_mode(client_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(client_ctx, new_session_cb);
+
+    log_message("TLS initialized: %s%s%s", OpenSSL_version(OPENSSL_VERSION), ca_file ? ", extra CA file " : "",
+                ca_file ? ca_file : "");
+    return 0;
+}
+
+void tls_shutdown(void) {
+    tls_session_cache_free();
+    SSL_CTX_free(client_ctx);
+    client_ctx = NULL;
+}
+
+static bool is_ip_literal(const char *host) {
+    unsigned char addr[sizeof(struct in6_addr)];
+    return inet_pton(AF_INET, host, addr) == 1 || inet_pton(AF_INET6, host, addr) == 1;
+}
+
+SSL* tls_new_client(const char *host, int port, bool verify, bool *session_offered) {
+    *session_offered = false;
+    if (!client_ctx && tls_init(NULL) != 0) {
+        return NULL;
+    }
+
+    SSL *ssl = SSL_new(client_ctx);
+    if (!ssl) {
+        log_ssl_errors("Failed to create SSL object");
+        return NULL;
+    }
+
+    bool ip_literal = is_ip_literal(host);
+    // RFC 6066 forbids IP literals in SNI
+    if (!ip_literal && SSL_set_tlsext_host_name(ssl, host) != 1) {
+        log_ssl_errors("Failed to set SNI");
+    }
+
+    if (verify) {
+        SSL_set_verify(ssl, SSL_VERIFY_PEER, NULL);
+        X509_VERIFY_PARAM *param = SSL_get0_param(ssl);
+        int ok = ip_literal ? X509_VERIFY_PARAM_set1_ip_asc(param, host) : X509_VERIFY_PARAM_set1_host(param, host, 0);
+        if (ok != 1) {
+            log_ssl_errors("Failed to set expected peer name");
+            SSL_free(ssl);
+            return NULL;
+        }
+    } else {
+        SSL_set_verify(ssl, SSL_VERIFY_NONE, NULL);
+    }
+
+    *session_offered = tls_session_resume(ssl, host, port);
+    return ssl;
+}
+
+int tls_use_client_cert(SSL *ssl, const char *cert_file, const char *key_file) {
+    if (SSL_use_certificate_chain_file(ssl, cert_file) != 1) {
+        log_ssl_errors("Failed to load client certificate");
+        return -1;
+    }
+    if (SSL_use_PrivateKey_file(ssl, key_file ? key_file : cert_file, SSL_FILETYPE_PEM) != 1 ||
+        SSL_check_private_key(ssl) != 1) {
+        log_ssl_errors("Failed to load client key");
+        return -1;
+    }
+    return 0;
+}
+
+const char* tls_verify_error(SSL *ssl) {
+    long result = SSL_get_verify_result(ssl);
+    if (result == X509_V_OK || SSL_get_verify_mode(ssl) == SSL_VERIFY_NONE) {
+        return NULL;
+    }
+    return X509_verify_cert_error_string(result);
+}
+
+const char* tls_alpn_protocol(SSL *ssl, char *buf, size_t buf_size) {
+    const unsigned char *proto = NULL;
+    unsigned int proto_len = 0;
+    SSL_get0_alpn_selected(ssl, &proto, &proto_len);
+    if (!proto || proto_len == 0) {
+        return "none";
+    }
+    snprintf(buf, buf_size, "%.*s", (int)proto_len, (const char *)proto);
+    return buf;
+}
+
+bool tls_session_resume(SSL *ssl, const char *host, int port) {
+    char key[300];
+    snprintf(key, sizeof(key), "%s:%d", host, port);
+    char *key_copy = strdup(key);
+    if (!key_copy || !SSL_set_ex_data(ssl, session_key_index(), key_copy)) {
+        free(key_copy);
+        return false;
+    }
+
+    tls_session_entry_t *entry = session_find(key);
+    if (!entry) {
+        return false;
+    }
+    if (!session_usable(entry->session)) {
+        session_entry_clear(entry);
+        return false;
+    }
+    if (SSL_set_session(ssl, entry->session) != 1) {
+        return false;
+    }
+    if (SSL_SESSION_get_protocol_version(entry->session) == TLS1_3_VERSION) {
+        // RFC 8446 C.4: do not reuse a ticket; the server will send a new one
+        session_entry_clear(entry);
+    }
+    return true;
+}
+
+void tls_session_report(SSL *ssl, bool offered) {
+    const char *key = (const char *)SSL_get_ex_data(ssl, session_key_index());
+    bool reused = SSL_session_reused(ssl);
+    if (reused) {
+        session_hits++;
+    } else {
+        session_misses++;
+    }
+    unsigned long total = session_hits + session_misses;
+    log_message("TLS session for %s: %s (hits %lu, misses %lu, hit rate %lu%%)", key ? key : "?",
+                reused ? "resumed" : (offered ? "full handshake, cached session rejected" : "full handshake, no cached session"),
+                session_hits, session_misses, total ? session_hits * 100 / total : 0);
+}
@@ -57,6 +57,7 @@ static void tui_draw_borders(void);
 static void tui_refresh_all(const char *input_buffer, int input_pos);
 static void tui_refresh_input_line(const char *input_buffer, int input_pos);
 static void update_status_bar(const char *status);
+static void tui_update_status(void);
 static void sigwinch_handler(int signum);
 static void draw_buffer_list(void);
 static void handle_scroll(int page_size);
@@ -105,27 +106,7 @@ void tui_init(void) {
  */
 void tui_destroy(void) {
     // Free all buffers
-    if (buffer_list_head) {
-        buffer_node_t *current = buffer_list_head;
-        buffer_node_t *last = buffer_list_head;
-
-        // Find the tail of the circular list
-        while (last->next != buffer_list_head) {
-            last = last->next;
-        }
-
-        // Break the circle to treat it as a simple list
-        last->next = NULL;
-
-        // Traverse and free the now-linear list
-        while (current != NULL) {
-            buffer_node_t *next = current->next;
-            buffer_free(current);
-            current = next;
-        }
-
-        buffer_list_head = NULL;
-    }
+    buffer_list_free();
 
     delwin(buffer_list_win);
     delwin(main_buffer_win);
@@ -176,32 +157,18 @@ void tui_refresh_main_buffer(void) {
 
     int text_width = pad_width - 2; // Account for borders/padding
     if (text_width < 1) return;
+    buffer_set_wrap_width(text_width);
 
     int current_y = 0;
     for (int i = 0; i < active_buffer->line_count; i++) {
-        const char *msg = active_buffer->lines[i];
-        int msg_len = strlen(msg);
-        
-        // Word-wrap long lines
-        const char *line_start = msg;
-        while (strlen(line_start) > text_width) {
-            int break_pos = text_width;
-            // Find the last space within the wrap width
-            while (break_pos > 0 && line_start[break_pos] != ' ') {
-                break_pos--;
-            }
-            // If no space is found, break the word
-            if (break_pos == 0) {
-                break_pos = text_width;
-            }
-            mvwprintw(main_buffer_pad, current_y++, 1, "%.*s", break_pos, line_start);
-            line_start += break_pos;
-            // Skip leading space on the next line
-            if (*line_start == ' ') {
-                line_start++;
-            }
-        }
-        mvwprintw(main_buffer_pad, current_y++, 1, "%s", line_start);
+        // Word-wrap long lines the same way buffer_line_rows() counts them
+        const char *row = active_buffer->lines[i];
+        int row_len;
+        do {
+            const char *next = buffer_wrap_row(row, text_width, &row_len);
+            mvwprintw(main_buffer_pad, current_y++, 1, "%.*s", row_len, row);
+            row = next;
+        } while (row);
     }
 
     int win_height, win_width;
@@ -210,8 +177,7 @@ void tui_refresh_main_buffer(void) {
     // Calculate max scroll
     int total_display_lines = 0;
     for (int i = 0; i < active_buffer->line_count; i++) {
-        int msg_len = strlen(active_buffer->lines[i]);
-        total_display_lines += (msg_len + text_width - 1) / text_width;
+        total_display_lines += buffer_line_rows(active_buffer->lines[i]);
     }
 
     int max_scroll = total_display_lines > win_height - 2 ? total_display_lines - (win_height - 2) : 0;
@@ -224,98 +190,140 @@ void tui_refresh_main_buffer(void) {
 
 }
 
-#include <sys/select.h>
+// State shared between the event loop callbacks in tui_run
+static char input_buffer[400];
+static int input_pos = 0;
+static bool pending_refresh = false;
+
+/**
+ * @brief Returns the network that input in the active buffer is sent to.
+ *
+ * Client-wide buffers are not bound to a network, so they fall back to the
+ * first configured one.
+ */
+static struct Irc *tui_active_irc(void) {
+    if (active_buffer && active_buffer->irc) {
+        return active_buffer->irc;
+    }
+    return irc_list_head;
+}
+
+static void tui_update_status(void) {
+    struct Irc *irc = tui_active_irc();
+    if (!irc) {
+        update_status_bar("[No networks]");
+        return;
+    }
+
+    int total = 0;
+    int connected = 0;
+    for (struct Irc *net = irc_list_head; net; net = net->next) {
+        total++;
+        if (net->state != IRC_STATE_DISCONNECTED) {
+            connected++;
+        }
+    }
+
+    char status[128];
+    if (irc->state == IRC_STATE_DISCONNECTED && irc->reconnect_timer) {
+        snprintf(status, sizeof(status), "[%s: Disconnected, reconnecting]", irc->network);
+    } else if (irc->state == IRC_STATE_DISCONNECTED) {
+        snprintf(status, sizeof(status), "[%s: Disconnected]", irc->network);
+    } else if (irc->state < IRC_STATE_CONNECTED) {
+        snprintf(status, sizeof(status), "[%s: Connecting to %s]", irc->network, irc->server);
+    } else {
+        snprintf(status, sizeof(status), "[%s: Connected to %s]", irc->network, irc->server);
+    }
+    long long lag = irc_lag_ms(irc);
+    if (lag >= 0) {
+        size_t len = strlen(status);
+        snprintf(status + len, sizeof(status) - len, " [lag %lld ms]", lag);
+    }
+    int queued = irc_queue_depth(irc);
+    if (queued > 0) {
+        size_t len = strlen(status);
+        snprintf(status + len, sizeof(status) - len, " [sendq %d]", queued);
+    }
+    if (total > 1) {
+        size_t len = strlen(status);
+        snprintf(status + len, sizeof(status) - len, " [%d/%d networks]", connected, total);
+    }
+    update_status_bar(status);
+}
+
+static void tui_stdin_cb(event_loop_t *loop, int fd, int events, void *data) {
+    int ch;
+
+    // ncurses may buffer several keys from one read, so drain them all
+    // before going back to epoll, which only sees the kernel side.
+    while (running && (ch = getch()) != ERR) {
+        bool needs_refresh = false;
+        tui_handle_input(ch, input_buffer, sizeof(input_buffer), &input_pos, tui_active_irc(), &needs_refresh);
+        if (needs_refresh) {
+            pending_refresh = true;
+        }
+    }
+}
+
+static void tui_irc_notify(struct Irc *irc, bool needs_refresh) {
+    // Disconnects no longer end the session; the network reconnects itself
+    if (irc->state == IRC_STATE_DISCONNECTED) {
+        needs_refresh = true;
+    }
+    if (needs_refresh) {
+        pending_refresh = true;
+    }
+}
 
 /**
  * @brief The main run loop for the TUI.
  *
  * This function handles user input, updates the screen, and manages
- * the overall flow of the user interface.
+ * the overall flow of the user interface. Terminal input and the sockets
+ * of every configured network share the given event loop.
  */
-void tui_run(struct Irc *irc, const char *channel) {
-    char input_buffer[400];
-    int input_pos = 0;
+void tui_run(event_loop_t *loop) {
     memset(input_buffer, 0, sizeof(input_buffer));
+    input_pos = 0;
 
     curs_set(1);
-    timeout(100);
+    timeout(0);
 
-    snprintf(current_status, sizeof(current_status), "[Connected to %s]", irc->server);
+    if (event_loop_add_fd(loop, 0, EVENT_READ, tui_stdin_cb, NULL) != 0) {
+        log_error("Failed to watch terminal input");
+        return;
+    }
 
+    for (struct Irc *irc = irc_list_head; irc; irc = irc->next) {
+        irc->notify = tui_irc_notify;
+    }
+
+    tui_update_status();
     tui_refresh_all(input_buffer, input_pos);
 
     while (running) {
         if (resize_pending) {
             resize_pending = 0;
             tui_redraw();
-            tui_refresh_all(input_buffer, input_pos);
-        }
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(0, &fds);
-        if (irc->state != IRC_STATE_DISCONNECTED) {
-            FD_SET(irc->sock, &fds);
-        }
-
-        int max_fd = irc->sock;
-        if (select(max_fd + 1, &fds, NULL, NULL, NULL) == -1) {
-            if (errno == EINTR) {
-                continue;
-            }
-            if (running) log_error("select() failed");
-            break;
+            pending_refresh = true;
         }
 
-        bool needs_refresh = false;
-
-        if (FD_ISSET(0, &fds)) {
-            int ch = getch();
-            if (ch != ERR) {
-                tui_handle_input(ch, input_buffer, sizeof(input_buffer), &input_pos, irc, &needs_refresh);
-            }
+        if (pending_refresh) {
+            pending_refresh = false;
+            tui_update_status();
+            tui_refresh_all(input_buffer, input_pos);
         }
 
-        if (irc->state != IRC_STATE_DISCONNECTED && FD_ISSET(irc->sock, &fds)) {
-            if (irc_recv(irc) <= 0) {
-                log_message("Connection closed.");
-                irc->state = IRC_STATE_DISCONNECTED;
-                running = 0;
-                continue;
-            }
-            
-            char command_buf[16];
-            memset(command_buf, 0, sizeof(command_buf));
-            irc_process_buffer(irc, &needs_refresh, command_buf, sizeof(command_buf));
-
-            switch (irc->state) {
-                case IRC_STATE_CONNECTED: {
-                    char buf[512];
-                    snprintf(buf, sizeof(buf), "NICK %s\r\n", irc->nickname);
-                    if (irc_send(irc, buf) < 0) {
-                        log_message("ERROR: Failed to send NICK");
-                    }
-                    snprintf(buf, sizeof(buf), "USER %s 0 * :%s\r\n", irc->username, irc->realname);
-                    if (irc_send(irc, buf) < 0) {
-                        log_message("ERROR: Failed to send USER");
-                    }
-                    irc->state = IRC_STATE_REGISTERING;
-                    break;
-                }
-                case IRC_STATE_REGISTERING:
-                    // This state is now handled in irc_process_buffer
-                    break;
-                case IRC_STATE_REGISTERED:
-                    // Normal operation
-                    break;
-                default:
-                    // Do nothing
-                    break;
-            }
+        if (event_loop_run_once(loop) < 0) {
+            if (running) log_error("event loop failed");
+            break;
         }
+    }
 
-        if (needs_refresh) {
-            tui_refresh_all(input_buffer, input_pos);
-        }
+    event_loop_remove_fd(loop, 0);
+    for (struct Irc *irc = irc_list_head; irc; irc = irc->next) {
+        irc_detach(irc);
+        irc->notify = NULL;
     }
 
     update_status_bar("[Disconnected]");
@@ -336,20 +344,25 @@ void tui_handle_input(int ch, char *input_buffer, size_t buffer_size, int *input
     if (ch == '\n') {
         if (strcmp(input_buffer, "/quit") == 0) {
             running = 0;
+        } else if (!irc) {
+            buffer_append_message(get_buffer_by_name(NULL, "status"), "Not connected to any network");
         } else if (input_buffer[0] == '/') {
             parse_command(irc, input_buffer, active_buffer);
         } else if (strlen(input_buffer) > 0) {
             char send_buf[MAX_MSG_LEN];
             char display_buf[MAX_MSG_LEN];
 
-            if (active_buffer && strcmp(active_buffer->name, "status") == 0) {
+            if (active_buffer && (!active_buffer->irc || strcmp(active_buffer->name, "status") == 0)) {
                 snprintf(send_buf, sizeof(send_buf), "%s\r\n", input_buffer);
                 irc_send(irc, send_buf);
             } else if (active_buffer) {
                 snprintf(send_buf, sizeof(send_buf), "PRIVMSG %s :%s\r\n", active_buffer->name, input_buffer);
                 irc_send(irc, send_buf);
-                snprintf(display_buf, sizeof(display_buf), "<%s> %s", irc->nickname, input_buffer);
-                buffer_append_message(active_buffer, display_buf);
+                // With echo-message the server's copy is shown instead
+                if (!irc_cap_enabled(irc, IRC_CAP_ECHO_MESSAGE)) {
+                    snprintf(display_buf, sizeof(display_buf), "<%s> %s", irc->nickname, input_buffer);
+                    buffer_append_message(active_buffer, display_buf);
+                }
             }
         }
         memset(input_buffer, 0, buffer_size);
@@ -398,8 +411,7 @@ static void handle_scroll(int page_size) {
     int total_display_lines = 0;
     if (active_buffer) {
         for (int i = 0; i < active_buffer->line_count; i++) {
-            int msg_len = strlen(active_buffer->lines[i]);
-            total_display_lines += (msg_len + text_width - 1) / text_width;
+            total_display_lines += buffer_line_rows(active_buffer->lines[i]);
         }
     }
 
@@ -414,6 +426,12 @@ static void handle_scroll(int page_size) {
         active_buffer->scroll_offset = 0;
     }
     active_buffer->at_bottom = (active_buffer->scroll_offset == max_scroll);
+
+    // Reaching the top asks the server for the page before it; the reply is
+    // spliced in above without moving the view.
+    if (page_size < 0 && active_buffer->scroll_offset == 0 && active_buffer->irc) {
+        irc_request_history(active_buffer->irc, active_buffer);
+    }
     tui_refresh_main_buffer();
 }
 
@@ -447,12 +465,22 @@ static void draw_buffer_list(void) {
     buffer_node_t *current = buffer_list_head;
     do {
         if (y < LINES - 1) { // Ensure we don't write past the screen height
+            // Network buffers are shown namespaced, e.g. "libera/#chan", and a
+            // network's status buffer is shown under the network name alone.
+            char label[128];
+            if (!current->irc) {
+                snprintf(label, sizeof(label), "%s", current->name);
+            } else if (strcmp(current->name, "status") == 0) {
+                snprintf(label, sizeof(label), "%s", current->irc->network);
+            } else {
+                snprintf(label, sizeof(label), "%s/%s", current->irc->network, current->name);
+            }
             if (current->active) {
                 wattron(buffer_list_win, COLOR_PAIR(2) | A_BOLD);
-                mvwprintw(buffer_list_win, y, 1, "> %s", current->name);
+                mvwprintw(buffer_list_win, y, 1, "> %s", label);
                 wattroff(buffer_list_win, COLOR_PAIR(2) | A_BOLD);
             } else {
-                mvwprintw(buffer_list_win, y, 1, "  %s", current->name);
+                mvwprintw(buffer_list_win, y, 1, "  %s", label);
             }
             y++;
         }
@@ -0,0 +1,229 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <buffer.h>
+#include <casemap.h>
+#include <irc.h>
+
+#define WIDTH 10
+
+/**
+ * @brief Lays a line out row by row, as the TUI draws it.
+ * @return The number of rows; each row is copied into rows.
+ */
+static int wrap_all(const char *line, int width, char rows[][WIDTH + 1], int max_rows) {
+    int count = 0;
+    int row_len;
+    do {
+        const char *next = buffer_wrap_row(line, width, &row_len);
+        if (count < max_rows) {
+            snprintf(rows[count], WIDTH + 1, "%.*s", row_len, line);
+        }
+        count++;
+        line = next;
+    } while (line);
+    return count;
+}
+
+static void test_wrap_row_breaks_at_spaces(void **state) {
+    (void) state;
+    char rows[4][WIDTH + 1];
+    // Short words: the old length-based count said 2 rows, wrapping needs 3
+    assert_int_equal(wrap_all("aaaaaa bbbbbb cccccc", WIDTH, rows, 4), 3);
+    assert_string_equal(rows[0], "aaaaaa");
+    assert_string_equal(rows[1], "bbbbbb");
+    assert_string_equal(rows[2], "cccccc");
+
+    buffer_set_wrap_width(WIDTH);
+    assert_int_equal(buffer_line_rows("aaaaaa bbbbbb cccccc"), 3);
+}
+
+static void test_wrap_row_splits_long_words(void **state) {
+    (void) state;
+    char rows[4][WIDTH + 1];
+    assert_int_equal(wrap_all("abcdefghijklmnopqrstuvwxy", WIDTH, rows, 4), 3);
+    assert_string_equal(rows[0], "abcdefghij");
+    assert_string_equal(rows[1], "klmnopqrst");
+    assert_string_equal(rows[2], "uvwxy");
+
+    buffer_set_wrap_width(WIDTH);
+    assert_int_equal(buffer_line_rows("abcdefghijklmnopqrstuvwxy"), 3);
+}
+
+static void test_line_rows_is_at_least_one(void **state) {
+    (void) state;
+    buffer_set_wrap_width(WIDTH);
+    assert_int_equal(buffer_line_rows(""), 1);
+    assert_int_equal(buffer_line_rows("0123456789"), 1);
+
+    buffer_set_wrap_width(0);
+    assert_int_equal(buffer_line_rows("a line longer than any width"), 1);
+}
+
+/**
+ * @brief A reader scrolled up stays on the same text when an older line
+ * that wraps is inserted above the view.
+ */
+static void test_insert_above_view_keeps_position(void **state) {
+    (void) state;
+    buffer_set_wrap_width(WIDTH);
+    buffer_node_t *buffer = create_buffer(NULL, "test");
+    assert_non_null(buffer);
+    buffer_insert_message(buffer, "first", 1000);
+    buffer_insert_message(buffer, "second", 3000);
+    buffer->at_bottom = false;
+    buffer->scroll_offset = 1; // Top of the view is "second"
+
+    buffer_insert_message(buffer, "aaaaaa bbbbbb cccccc", 2000);
+    assert_string_equal(buffer->lines[1], "aaaaaa bbbbbb cccccc");
+    assert_int_equal(buffer->scroll_offset, 4);
+
+    buffer_free(buffer);
+}
+
+#define INDEX_NAMES 200
+
+static int teardown_buffers(void **state) {
+    (void) state;
+    buffer_list_free();
+    return 0;
+}
+
+/**
+ * @brief Flips the case of every letter, so lookups go through the casemap.
+ */
+static void swap_case(const char *name, char *out, size_t out_size) {
+    size_t i = 0;
+    for (; name[i] && i + 1 < out_size; i++) {
+        char c = name[i];
+        out[i] = (c >= 'a' && c <= 'z') ? (char)(c - 32) : (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+    }
+    out[i] = '\0';
+}
+
+/**
+ * @brief Adds and removes buffers in a scrambled order, checking after each
+ * removal that the backward-shift delete left every other buffer findable.
+ * With this many names, probe runs wrap around the end of the table.
+ */
+static void test_index_survives_removals(void **state) {
+    (void) state;
+    Irc *irc = (Irc *)calloc(1, sizeof(Irc));
+    assert_non_null(irc);
+    irc->isupport.casemapping = CASEMAP_ASCII;
+
+    char names[INDEX_NAMES][16];
+    buffer_node_t *buffers[INDEX_NAMES];
+    add_buffer(create_buffer(NULL, "status"));
+    for (int i = 0; i < INDEX_NAMES; i++) {
+        snprintf(names[i], sizeof(names[i]), "#chan%d", i);
+        buffers[i] = create_buffer(irc, names[i]);
+        add_buffer(buffers[i]);
+    }
+
+    // Remove in a fixed scrambled order: 37 is coprime with INDEX_NAMES
+    bool removed[INDEX_NAMES] = {false};
+    for (int step = 0; step < INDEX_NAMES; step++) {
+        int victim = (step * 37 + 11) % INDEX_NAMES;
+        remove_buffer(buffers[victim]);
+        removed[victim] = true;
+
+        if (step % 7 != 0 && step < INDEX_NAMES - 5) {
+            continue;
+        }
+        for (int i = 0; i < INDEX_NAMES; i++) {
+            char other_case[16];
+            swap_case(names[i], other_case, sizeof(other_case));
+            buffer_node_t *found = get_buffer_by_name(irc, other_case);
+            if (removed[i]) {
+                assert_null(found);
+            } else {
+                assert_ptr_equal(found, buffers[i]);
+            }
+        }
+    }
+    assert_non_null(get_buffer_by_name(NULL, "STATUS"));
+    assert_null(get_buffer_by_name(irc, "status"));
+    free(irc);
+}
+
+/**
+ * @brief The same channel name on two networks maps to two buffers.
+ */
+static void test_index_separates_networks(void **state) {
+    (void) state;
+    Irc *first = (Irc *)calloc(1, sizeof(Irc));
+    Irc *second = (Irc *)calloc(1, sizeof(Irc));
+    assert_non_null(first);
+    assert_non_null(second);
+
+    buffer_node_t *a = create_buffer(first, "#chatter");
+    buffer_node_t *b = create_buffer(second, "#chatter");
+    add_buffer(a);
+    add_buffer(b);
+    assert_ptr_equal(get_buffer_by_name(first, "#CHATTER"), a);
+    assert_ptr_equal(get_buffer_by_name(second, "#CHATTER"), b);
+
+    remove_buffer(a);
+    assert_null(get_buffer_by_name(first, "#chatter"));
+    assert_ptr_equal(get_buffer_by_name(second, "#chatter"), b);
+    free(first);
+    free(second);
+}
+
+/**
+ * @brief After CASEMAPPING changes, buffer_reindex() makes lookups follow
+ * the new rules.
+ */
+static void test_reindex_after_casemap_change(void **state) {
+    (void) state;
+    Irc *irc = (Irc *)calloc(1, sizeof(Irc));
+    assert_non_null(irc);
+    irc->isupport.casemapping = CASEMAP_RFC1459;
+
+    buffer_node_t *buffer = create_buffer(irc, "#a[b]");
+    add_buffer(buffer);
+    assert_ptr_equal(get_buffer_by_name(irc, "#A{B}"), buffer);
+
+    irc->isupport.casemapping = CASEMAP_ASCII;
+    buffer_reindex();
+    assert_null(get_buffer_by_name(irc, "#A{B}"));
+    assert_ptr_equal(get_buffer_by_name(irc, "#A[B]"), buffer);
+    free(irc);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_wrap_row_breaks_at_spaces),
+        cmocka_unit_test(test_wrap_row_splits_long_words),
+        cmocka_unit_test(test_line_rows_is_at_least_one),
+        cmocka_unit_test(test_insert_above_view_keeps_position),
+        cmocka_unit_test_setup_teardown(test_index_survives_removals, NULL, teardown_buffers),
+        cmocka_unit_test_setup_teardown(test_index_separates_networks, NULL, teardown_buffers),
+        cmocka_unit_test_setup_teardown(test_reindex_after_casemap_change, NULL, teardown_buffers),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,112 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <casemap.h>
+
+/**
+ * Returns a heap copy of s, so reading past its terminator is caught by
+ * sanitizers instead of landing in neighbouring string literals.
+ */
+static char* heap_copy(const char *s) {
+    char *copy = strdup(s);
+    assert_non_null(copy);
+    return copy;
+}
+
+static void test_equals_different_lengths(void **state) {
+    (void) state;
+    char *nick = heap_copy("bob");
+    assert_false(casemap_equals(CASEMAP_RFC1459, "bobby_the_long_nick", 19, nick));
+    assert_false(casemap_equals(CASEMAP_RFC1459, "BOBBY_THE_LONG_NICK", 19, nick));
+    assert_false(casemap_equals(CASEMAP_RFC1459, "bo", 2, nick));
+    assert_false(casemap_equals(CASEMAP_RFC1459, "", 0, nick));
+    assert_true(casemap_equals(CASEMAP_RFC1459, "bob", 3, nick));
+    free(nick);
+
+    char *empty = heap_copy("");
+    assert_true(casemap_equals(CASEMAP_ASCII, "", 0, empty));
+    assert_false(casemap_equals(CASEMAP_ASCII, "x", 1, empty));
+    free(empty);
+}
+
+static void test_equals_slice_is_not_terminated(void **state) {
+    (void) state;
+    // Names arrive as slices of a longer line
+    const char *line = "NICK alice!u@h";
+    char *nick = heap_copy("Alice");
+    assert_true(casemap_equals(CASEMAP_RFC1459, line + 5, 5, nick));
+    assert_false(casemap_equals(CASEMAP_RFC1459, line + 5, 6, nick));
+    free(nick);
+}
+
+static void test_equals_mappings(void **state) {
+    (void) state;
+    // rfc1459 folds []\~ to {}|^
+    assert_true(casemap_equals(CASEMAP_RFC1459, "Nick[a]\\~", 9, "nick{a}|^"));
+    // strict-rfc1459 leaves ~ and ^ apart
+    assert_true(casemap_equals(CASEMAP_STRICT_RFC1459, "Nick[a]\\", 8, "nick{a}|"));
+    assert_false(casemap_equals(CASEMAP_STRICT_RFC1459, "~", 1, "^"));
+    // ascii only folds letters
+    assert_true(casemap_equals(CASEMAP_ASCII, "#CHAN", 5, "#chan"));
+    assert_false(casemap_equals(CASEMAP_ASCII, "[", 1, "{"));
+    assert_false(casemap_equals(CASEMAP_RFC1459, "#chan", 5, "#chap"));
+}
+
+static void test_hash_follows_equals(void **state) {
+    (void) state;
+    const char *pairs[][2] = {
+        {"#Chan", "#chan"},
+        {"Nick[away]", "nick{away}"},
+        {"A_Much_Longer_Nickname_Than_Eight", "a_much_longer_nickname_than_eight"},
+    };
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        size_t len = strlen(pairs[i][0]);
+        assert_int_equal(casemap_hash(CASEMAP_RFC1459, pairs[i][0], len),
+                         casemap_hash(CASEMAP_RFC1459, pairs[i][1], len));
+    }
+    // Under ascii, [ and { are different names and should hash apart
+    assert_int_not_equal(casemap_hash(CASEMAP_ASCII, "nick[", 5), casemap_hash(CASEMAP_ASCII, "nick{", 5));
+    // The length is part of the hash, so a prefix of a name differs from it
+    assert_int_not_equal(casemap_hash(CASEMAP_RFC1459, "nickname", 8), casemap_hash(CASEMAP_RFC1459, "nickname", 7));
+}
+
+static void test_from_name(void **state) {
+    (void) state;
+    assert_int_equal(casemap_from_name("ascii", 5), CASEMAP_ASCII);
+    assert_int_equal(casemap_from_name("strict-rfc1459", 14), CASEMAP_STRICT_RFC1459);
+    assert_int_equal(casemap_from_name("rfc1459", 7), CASEMAP_RFC1459);
+    assert_int_equal(casemap_from_name("rfc7613", 7), CASEMAP_RFC1459);
+    assert_string_equal(casemap_name(CASEMAP_STRICT_RFC1459), "strict-rfc1459");
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_equals_different_lengths),
+        cmocka_unit_test(test_equals_slice_is_not_terminated),
+        cmocka_unit_test(test_equals_mappings),
+        cmocka_unit_test(test_hash_follows_equals),
+        cmocka_unit_test(test_from_name),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,148 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <cmocka.h>
+
+#include <event_loop.h>
+
+/**
+ * @brief Stands in for a connection: a socketpair whose far end is written
+ * to, and a drain timer that it re-arms while it has budget left to yield.
+ */
+typedef struct {
+    int fds[2];
+    int reads;
+    int drains;
+    int pending_drains;
+} fake_conn_t;
+
+static void drain_cb(event_loop_t *loop, void *data) {
+    fake_conn_t *conn = (fake_conn_t *)data;
+    conn->drains++;
+    if (conn->pending_drains > 0) {
+        conn->pending_drains--;
+        event_loop_add_timer(loop, 0, 0, drain_cb, conn);
+    }
+}
+
+static void read_cb(event_loop_t *loop, int fd, int events, void *data) {
+    (void) loop;
+    fake_conn_t *conn = (fake_conn_t *)data;
+    char buf[64];
+    if (events & EVENT_READ) {
+        if (read(fd, buf, sizeof(buf)) > 0) {
+            conn->reads++;
+        }
+    }
+}
+
+static void open_conn(event_loop_t *loop, fake_conn_t *conn) {
+    memset(conn, 0, sizeof(*conn));
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, conn->fds), 0);
+    assert_int_equal(event_loop_add_fd(loop, conn->fds[0], EVENT_READ, read_cb, conn), 0);
+}
+
+static void close_conn(event_loop_t *loop, fake_conn_t *conn) {
+    event_loop_remove_fd(loop, conn->fds[0]);
+    close(conn->fds[0]);
+    close(conn->fds[1]);
+}
+
+/**
+ * @brief A connection that keeps yielding its read budget must not stop a
+ * second connection's socket from being served.
+ */
+static void test_yielding_drain_lets_other_fd_run(void **state) {
+    (void) state;
+    event_loop_t *loop = event_loop_create();
+    assert_non_null(loop);
+
+    fake_conn_t busy, quiet;
+    open_conn(loop, &busy);
+    open_conn(loop, &quiet);
+
+    busy.pending_drains = 1000;
+    assert_true(event_loop_add_timer(loop, 0, 0, drain_cb, &busy) > 0);
+
+    // The first pass fires the drain on its own; it re-arms itself but must
+    // not run again until the loop has polled the fds.
+    assert_int_equal(event_loop_run_once(loop), 1);
+    assert_int_equal(busy.drains, 1);
+
+    assert_int_equal(write(quiet.fds[1], "PING\r\n", 6), 6);
+    assert_int_equal(event_loop_run_once(loop), 2);
+    assert_int_equal(quiet.reads, 1);
+    assert_int_equal(busy.drains, 2);
+
+    close_conn(loop, &busy);
+    close_conn(loop, &quiet);
+    event_loop_destroy(loop);
+}
+
+static int order[4];
+static int order_count;
+
+static void record_cb(event_loop_t *loop, void *data) {
+    (void) loop;
+    order[order_count++] = (int)(intptr_t)data;
+}
+
+static void record_and_add_cb(event_loop_t *loop, void *data) {
+    record_cb(loop, data);
+    event_loop_add_timer(loop, 0, 0, record_cb, (void *)(intptr_t)9);
+}
+
+/**
+ * @brief Timers due together fire in the order they were added, and a timer
+ * added behind them does not hold them back.
+ */
+static void test_due_timers_fire_in_order(void **state) {
+    (void) state;
+    event_loop_t *loop = event_loop_create();
+    assert_non_null(loop);
+    order_count = 0;
+
+    event_loop_add_timer(loop, 0, 0, record_and_add_cb, (void *)(intptr_t)1);
+    event_loop_add_timer(loop, 0, 0, record_cb, (void *)(intptr_t)2);
+    event_loop_add_timer(loop, 0, 0, record_cb, (void *)(intptr_t)3);
+
+    assert_int_equal(event_loop_run_once(loop), 3);
+    assert_int_equal(order_count, 3);
+    assert_int_equal(order[0], 1);
+    assert_int_equal(order[1], 2);
+    assert_int_equal(order[2], 3);
+
+    assert_int_equal(event_loop_run_once(loop), 1);
+    assert_int_equal(order[3], 9);
+    event_loop_destroy(loop);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_yielding_drain_lets_other_fd_run),
+        cmocka_unit_test(test_due_timers_fire_in_order),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,208 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <cmocka.h>
+
+#include <flood.h>
+
+#define T0 100000 // Any nonzero start; 0 means "never refilled"
+
+static void push_line(flood_t *flood, const char *line) {
+    size_t len = strlen(line);
+    assert_int_equal(flood_push(flood, flood_classify(line, len), line, len), 0);
+}
+
+/**
+ * @brief Writes the send queue out through a socketpair and checks its lines
+ * in order.
+ */
+static void assert_queued(sendq_t *q, const char *const *expected, int count) {
+    char buf[4096];
+    size_t len = 0;
+    int fds[2];
+    assert_int_equal(sendq_depth(q), count);
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    assert_int_equal(sendq_flush(q, fds[1], NULL, NULL), 0);
+    close(fds[1]);
+    ssize_t n;
+    while ((n = read(fds[0], buf + len, sizeof(buf) - 1 - len)) > 0) {
+        len += (size_t)n;
+    }
+    close(fds[0]);
+    buf[len] = '\0';
+
+    char *rest = buf;
+    for (int i = 0; i < count; i++) {
+        char *end = strstr(rest, "\r\n");
+        assert_non_null(end);
+        *end = '\0';
+        assert_string_equal(rest, expected[i]);
+        rest = end + 2;
+    }
+    assert_string_equal(rest, "");
+}
+
+static void test_classify(void **state) {
+    (void) state;
+    assert_int_equal(flood_classify("PONG :srv\r\n", 11), FLOOD_PRIORITY_URGENT);
+    assert_int_equal(flood_classify("quit :bye", 9), FLOOD_PRIORITY_URGENT);
+    assert_int_equal(flood_classify("AUTHENTICATE PLAIN", 18), FLOOD_PRIORITY_URGENT);
+    assert_int_equal(flood_classify("PRIVMSG #c :who", 15), FLOOD_PRIORITY_NORMAL);
+    assert_int_equal(flood_classify("WHO #c\r\n", 8), FLOOD_PRIORITY_BULK);
+    assert_int_equal(flood_classify("who", 3), FLOOD_PRIORITY_BULK);
+    assert_int_equal(flood_classify("WHOX #c", 7), FLOOD_PRIORITY_NORMAL);
+    assert_int_equal(flood_classify("MODE #c +o nick", 15), FLOOD_PRIORITY_BULK);
+    // Only len bytes are looked at
+    assert_int_equal(flood_classify("PONGS", 4), FLOOD_PRIORITY_URGENT);
+}
+
+/**
+ * @brief A full bucket lets burst messages out, then one per interval.
+ */
+static void test_burst_then_rate(void **state) {
+    (void) state;
+    flood_t flood;
+    sendq_t q;
+    flood_init(&flood, 3, 1000);
+    sendq_init(&q);
+    for (int i = 0; i < 5; i++) {
+        push_line(&flood, "PRIVMSG #c :hi\r\n");
+    }
+
+    assert_int_equal(flood_release(&flood, &q, T0), 3);
+    assert_int_equal(flood.depth, 2);
+    assert_int_equal(flood_next_release_ms(&flood, T0), 1001);
+
+    assert_int_equal(flood_release(&flood, &q, T0 + 500), 0);
+    assert_int_equal(flood_next_release_ms(&flood, T0 + 500), 501);
+    assert_int_equal(flood_release(&flood, &q, T0 + 1000), 1);
+    assert_int_equal(flood_release(&flood, &q, T0 + 2000), 1);
+    assert_int_equal(flood_next_release_ms(&flood, T0 + 2000), -1);
+
+    // A long idle refills to burst, never beyond
+    for (int i = 0; i < 5; i++) {
+        push_line(&flood, "PRIVMSG #c :hi\r\n");
+    }
+    assert_int_equal(flood_release(&flood, &q, T0 + 60000), 3);
+
+    flood_clear(&flood);
+    sendq_clear(&q);
+}
+
+/**
+ * @brief Urgent lines skip the bucket but still spend tokens, and bulk
+ * queries wait behind chat.
+ */
+static void test_priorities(void **state) {
+    (void) state;
+    flood_t flood;
+    sendq_t q;
+    flood_init(&flood, 2, 1000);
+    sendq_init(&q);
+
+    push_line(&flood, "WHO #a\r\n");
+    push_line(&flood, "PRIVMSG #a :one\r\n");
+    push_line(&flood, "PRIVMSG #a :two\r\n");
+    push_line(&flood, "PONG :srv\r\n");
+    // PONG spends one token, chat the other; the rest waits
+    assert_int_equal(flood_release(&flood, &q, T0), 2);
+    assert_int_equal(flood.depth, 2);
+
+    // Urgent lines go out even with the bucket empty, putting it in debt
+    push_line(&flood, "PONG :again\r\n");
+    assert_int_equal(flood_release(&flood, &q, T0), 1);
+    assert_int_equal(flood_next_release_ms(&flood, T0), 2001);
+    assert_int_equal(flood_release(&flood, &q, T0 + 1000), 0);
+
+    // Chat comes before the WHO queued ahead of it
+    assert_int_equal(flood_release(&flood, &q, T0 + 2000), 1);
+    assert_int_equal(flood_release(&flood, &q, T0 + 3000), 1);
+    assert_int_equal(flood.depth, 0);
+    const char *expected[] = {"PONG :srv", "PRIVMSG #a :one", "PONG :again", "PRIVMSG #a :two", "WHO #a"};
+    assert_queued(&q, expected, 5);
+
+    flood_clear(&flood);
+    sendq_clear(&q);
+}
+
+static void test_release_order(void **state) {
+    (void) state;
+    flood_t flood;
+    sendq_t q;
+    flood_init(&flood, 10, 1000);
+    sendq_init(&q);
+
+    push_line(&flood, "MODE #a +o x\r\n");
+    push_line(&flood, "PRIVMSG #a :one\r\n");
+    push_line(&flood, "WHO #a\r\n");
+    push_line(&flood, "PONG :srv\r\n");
+    push_line(&flood, "PRIVMSG #a :two\r\n");
+    assert_int_equal(flood_release(&flood, &q, T0), 5);
+    const char *expected[] = {"PONG :srv", "PRIVMSG #a :one", "PRIVMSG #a :two", "MODE #a +o x", "WHO #a"};
+    assert_queued(&q, expected, 5);
+
+    flood_clear(&flood);
+    sendq_clear(&q);
+}
+
+static void test_unlimited(void **state) {
+    (void) state;
+    flood_t flood;
+    sendq_t q;
+    flood_init(&flood, 1, 0);
+    sendq_init(&q);
+    for (int i = 0; i < 50; i++) {
+        push_line(&flood, "WHO #c\r\n");
+    }
+    assert_int_equal(flood_release(&flood, &q, T0), 50);
+    assert_int_equal(sendq_depth(&q), 50);
+    assert_int_equal(flood_next_release_ms(&flood, T0), -1);
+
+    // A new connection starts with a full bucket and nothing held
+    flood_init(&flood, 2, 1000);
+    push_line(&flood, "PRIVMSG #c :a");
+    push_line(&flood, "PRIVMSG #c :b");
+    push_line(&flood, "PRIVMSG #c :c");
+    assert_int_equal(flood_release(&flood, &q, T0), 2);
+    flood_clear(&flood);
+    assert_int_equal(flood.depth, 0);
+    assert_int_equal(flood_next_release_ms(&flood, T0), -1);
+    push_line(&flood, "PRIVMSG #c :d");
+    push_line(&flood, "PRIVMSG #c :e");
+    assert_int_equal(flood_release(&flood, &q, T0 + 1), 2);
+
+    flood_clear(&flood);
+    sendq_clear(&q);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_classify),
+        cmocka_unit_test(test_burst_then_rate),
+        cmocka_unit_test(test_priorities),
+        cmocka_unit_test(test_release_order),
+        cmocka_unit_test(test_unlimited),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
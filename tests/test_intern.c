@@ -0,0 +1,130 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <intern.h>
+
+static int setup(void **state) {
+    static intern_pool_t pool;
+    intern_init(&pool, CASEMAP_RFC1459);
+    *state = &pool;
+    return 0;
+}
+
+static int teardown(void **state) {
+    intern_clear((intern_pool_t *)*state);
+    return 0;
+}
+
+static intern_id_t acquire(intern_pool_t *pool, const char *s) {
+    return intern_acquire(pool, s, strlen(s));
+}
+
+static intern_id_t find(intern_pool_t *pool, const char *s) {
+    return intern_find(pool, s, strlen(s));
+}
+
+static void test_equal_names_share_an_id(void **state) {
+    intern_pool_t *pool = (intern_pool_t *)*state;
+    intern_id_t chan = acquire(pool, "#Chan[1]");
+    assert_int_not_equal(chan, 0);
+    assert_int_equal(acquire(pool, "#chan{1}"), chan);
+    assert_int_equal(pool->live, 1);
+    // The first spelling is kept
+    assert_string_equal(intern_str(pool, chan), "#Chan[1]");
+    assert_int_not_equal(acquire(pool, "#chan"), chan);
+}
+
+static void test_release_frees_at_zero(void **state) {
+    intern_pool_t *pool = (intern_pool_t *)*state;
+    intern_id_t id = acquire(pool, "alice");
+    intern_retain(pool, id);
+    intern_release(pool, id);
+    assert_int_equal(find(pool, "ALICE"), id);
+    intern_release(pool, id);
+    assert_int_equal(find(pool, "alice"), 0);
+    assert_int_equal(pool->live, 0);
+    // Released IDs are handed out again
+    assert_int_equal(acquire(pool, "bob"), id);
+}
+
+static void test_id_zero_is_none(void **state) {
+    intern_pool_t *pool = (intern_pool_t *)*state;
+    assert_int_equal(find(pool, "nobody"), 0);
+    assert_string_equal(intern_str(pool, 0), "");
+    intern_release(pool, 0);
+    intern_retain(pool, 0);
+    assert_int_equal(pool->live, 0);
+}
+
+static void test_many_names_and_removal(void **state) {
+    intern_pool_t *pool = (intern_pool_t *)*state;
+    char name[32];
+    intern_id_t ids[2000];
+    for (int i = 0; i < 2000; i++) {
+        snprintf(name, sizeof(name), "nick%d", i);
+        ids[i] = acquire(pool, name);
+        assert_int_not_equal(ids[i], 0);
+    }
+    // Release every other name; the rest must stay findable across the shifted runs
+    for (int i = 0; i < 2000; i += 2) {
+        intern_release(pool, ids[i]);
+    }
+    for (int i = 0; i < 2000; i++) {
+        snprintf(name, sizeof(name), "NICK%d", i);
+        assert_int_equal(find(pool, name), i % 2 ? ids[i] : 0);
+    }
+    assert_int_equal(pool->live, 1000);
+}
+
+static void test_respell_keeps_the_id(void **state) {
+    intern_pool_t *pool = (intern_pool_t *)*state;
+    intern_id_t id = acquire(pool, "bob");
+    intern_respell(pool, id, "BoB", 3);
+    assert_string_equal(intern_str(pool, id), "BoB");
+    assert_int_equal(find(pool, "bob"), id);
+    // A different length is not a respelling
+    intern_respell(pool, id, "bobby", 5);
+    assert_string_equal(intern_str(pool, id), "BoB");
+}
+
+static void test_casemap_change_rehashes(void **state) {
+    intern_pool_t *pool = (intern_pool_t *)*state;
+    intern_id_t id = acquire(pool, "nick[a]");
+    assert_int_equal(find(pool, "NICK{A}"), id);
+    intern_set_casemap(pool, CASEMAP_ASCII);
+    assert_int_equal(find(pool, "NICK[A]"), id);
+    assert_int_equal(find(pool, "nick{a}"), 0);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_equal_names_share_an_id, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_release_frees_at_zero, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_id_zero_is_none, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_many_names_and_removal, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_respell_keeps_the_id, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_casemap_change_rehashes, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,157 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <irc_dispatch.h>
+
+// Each handler records which one ran, so lookups can be told apart
+static int last_handler;
+
+#define HANDLER(n) \
+    static void handler_##n(struct Irc *irc, const irc_message_t *msg, bool *needs_refresh) { \
+        (void) irc; (void) msg; (void) needs_refresh; \
+        last_handler = n; \
+    }
+HANDLER(1)
+HANDLER(2)
+HANDLER(3)
+HANDLER(4)
+HANDLER(5)
+
+static const irc_verb_handler_t verbs[] = {
+    {"PRIVMSG", handler_1}, {"NOTICE", handler_2}, {"JOIN", handler_3}, {"PART", handler_4},
+    {"PING", handler_5}, {"PONG", handler_1}, {"QUIT", handler_2}, {"KICK", handler_3},
+    {"NICK", handler_4}, {"MODE", handler_5}, {"TOPIC", handler_1}, {"CAP", handler_2},
+    {"AUTHENTICATE", handler_3}, {"BATCH", handler_4}, {"ERROR", handler_5},
+};
+
+static const irc_numeric_handler_t numerics[] = {
+    {1, handler_1}, {5, handler_2}, {353, handler_3}, {999, handler_4}, {1000, handler_5}, {-1, handler_5},
+};
+
+#define VERB_COUNT (int)(sizeof(verbs) / sizeof(verbs[0]))
+#define NUMERIC_COUNT (int)(sizeof(numerics) / sizeof(numerics[0]))
+
+/**
+ * @brief Looks a line up and returns which handler it maps to, or 0.
+ */
+static int dispatch(const irc_dispatch_t *table, const char *line) {
+    irc_message_t msg;
+    assert_int_equal(irc_message_parse(line, strlen(line), &msg), 0);
+    irc_handler_fn fn = irc_dispatch_lookup(table, &msg);
+    if (!fn) {
+        return 0;
+    }
+    last_handler = 0;
+    fn(NULL, &msg, NULL);
+    return last_handler;
+}
+
+static void test_every_verb_resolves(void **state) {
+    (void) state;
+    static irc_dispatch_t table;
+    assert_int_equal(irc_dispatch_build(&table, verbs, VERB_COUNT, numerics, NUMERIC_COUNT), 0);
+    for (int i = 0; i < VERB_COUNT; i++) {
+        irc_message_t msg;
+        char line[64];
+        snprintf(line, sizeof(line), ":nick!u@h %s #chan :text", verbs[i].verb);
+        assert_int_equal(irc_message_parse(line, strlen(line), &msg), 0);
+        assert_ptr_equal(irc_dispatch_lookup(&table, &msg), verbs[i].fn);
+    }
+}
+
+static void test_verbs_are_case_insensitive(void **state) {
+    (void) state;
+    static irc_dispatch_t table;
+    assert_int_equal(irc_dispatch_build(&table, verbs, VERB_COUNT, numerics, NUMERIC_COUNT), 0);
+    assert_int_equal(dispatch(&table, ":n!u@h privmsg #c :hi"), 1);
+    assert_int_equal(dispatch(&table, "Ping :srv"), 5);
+    assert_int_equal(dispatch(&table, "authenticate +"), 3);
+}
+
+/**
+ * @brief Unknown verbs, prefixes and extensions of known verbs miss even
+ * when they hash to an occupied slot.
+ */
+static void test_unknown_verbs_miss(void **state) {
+    (void) state;
+    static irc_dispatch_t table;
+    assert_int_equal(irc_dispatch_build(&table, verbs, VERB_COUNT, numerics, NUMERIC_COUNT), 0);
+    const char *unknown[] = {"WALLOPS", "PRIVMSGX", "PRIV", "PIN", "PINGS", "INVITE", "AWAY", "X", "ACCOUNT"};
+    for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); i++) {
+        char line[64];
+        snprintf(line, sizeof(line), ":srv %s a", unknown[i]);
+        assert_int_equal(dispatch(&table, line), 0);
+    }
+}
+
+static void test_numerics(void **state) {
+    (void) state;
+    static irc_dispatch_t table;
+    assert_int_equal(irc_dispatch_build(&table, verbs, VERB_COUNT, numerics, NUMERIC_COUNT), 0);
+    assert_int_equal(dispatch(&table, ":srv 001 me :Welcome"), 1);
+    assert_int_equal(dispatch(&table, ":srv 005 me CHANTYPES=# :are supported"), 2);
+    assert_int_equal(dispatch(&table, ":srv 353 me = #c :a b"), 3);
+    assert_int_equal(dispatch(&table, ":srv 999 me :last"), 4);
+    assert_int_equal(dispatch(&table, ":srv 002 me :Your host"), 0);
+    assert_int_equal(dispatch(&table, ":srv 000 me :zero"), 0);
+    // Four digits are a verb, not a numeric, and nothing handles it
+    assert_int_equal(dispatch(&table, ":srv 1000 me :x"), 0);
+}
+
+/**
+ * @brief A table with room to grow past today's commands still gets a
+ * collision-free seed.
+ */
+#define MANY_VERBS 24
+
+static void test_many_verbs(void **state) {
+    (void) state;
+    static char names[MANY_VERBS][16];
+    static irc_verb_handler_t many[MANY_VERBS];
+    for (int i = 0; i < MANY_VERBS; i++) {
+        snprintf(names[i], sizeof(names[i]), "VERB%d", i);
+        many[i].verb = names[i];
+        many[i].fn = i % 2 ? handler_1 : handler_2;
+    }
+    static irc_dispatch_t table;
+    assert_int_equal(irc_dispatch_build(&table, many, MANY_VERBS, NULL, 0), 0);
+    for (int i = 0; i < MANY_VERBS; i++) {
+        char line[32];
+        snprintf(line, sizeof(line), "verb%d", i);
+        assert_int_equal(dispatch(&table, line), i % 2 ? 1 : 2);
+    }
+    assert_int_equal(dispatch(&table, "VERB24"), 0);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_every_verb_resolves),
+        cmocka_unit_test(test_verbs_are_case_insensitive),
+        cmocka_unit_test(test_unknown_verbs_miss),
+        cmocka_unit_test(test_numerics),
+        cmocka_unit_test(test_many_verbs),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
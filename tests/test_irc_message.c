@@ -0,0 +1,211 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <irc_message.h>
+
+static void parse(const char *line, irc_message_t *msg) {
+    assert_int_equal(irc_message_parse(line, strlen(line), msg), 0);
+}
+
+static void assert_slice(irc_slice_t slice, const char *expected) {
+    char text[512];
+    assert_string_equal(irc_slice_copy(slice, text, sizeof(text)), expected);
+}
+
+static void test_full_message(void **state) {
+    (void) state;
+    irc_message_t msg;
+    parse("@time=2025-01-31T12:34:56.789Z;+draft/reply=abc :nick!user@host PRIVMSG #chan :hello there :)", &msg);
+    assert_slice(msg.tags, "time=2025-01-31T12:34:56.789Z;+draft/reply=abc");
+    assert_slice(msg.prefix, "nick!user@host");
+    assert_slice(msg.nick, "nick");
+    assert_slice(msg.user, "user");
+    assert_slice(msg.host, "host");
+    assert_slice(msg.command, "PRIVMSG");
+    assert_int_equal(msg.numeric, -1);
+    assert_int_equal(msg.param_count, 2);
+    assert_slice(msg.params[0], "#chan");
+    assert_slice(msg.params[1], "hello there :)");
+    assert_true(msg.has_trailing);
+}
+
+static void test_tags(void **state) {
+    (void) state;
+    irc_message_t msg;
+    irc_slice_t value;
+    parse("@a=1;flag;time=x;empty= PING", &msg);
+    assert_true(irc_message_tag(&msg, "a", &value));
+    assert_slice(value, "1");
+    assert_true(irc_message_tag(&msg, "flag", &value));
+    assert_int_equal(value.len, 0);
+    assert_true(irc_message_tag(&msg, "empty", &value));
+    assert_int_equal(value.len, 0);
+    // Keys match whole, not by prefix
+    assert_false(irc_message_tag(&msg, "tim", NULL));
+    assert_false(irc_message_tag(&msg, "fla", NULL));
+    assert_false(irc_message_tag(&msg, "missing", NULL));
+
+    parse("PING :x", &msg);
+    assert_int_equal(msg.tags.len, 0);
+    assert_false(irc_message_tag(&msg, "time", NULL));
+}
+
+static void test_empty_trailing(void **state) {
+    (void) state;
+    irc_message_t msg;
+    parse("PRIVMSG #chan :", &msg);
+    assert_int_equal(msg.param_count, 2);
+    assert_int_equal(msg.params[1].len, 0);
+    assert_true(msg.has_trailing);
+
+    // Trailing spaces are not an empty parameter
+    parse("MODE #chan +o nick   ", &msg);
+    assert_int_equal(msg.param_count, 3);
+    assert_false(msg.has_trailing);
+    assert_slice(msg.params[2], "nick");
+}
+
+static void test_spacing_and_colons(void **state) {
+    (void) state;
+    irc_message_t msg;
+    parse(":srv   353  me = #chan :@alice  +bob ", &msg);
+    assert_int_equal(msg.numeric, 353);
+    assert_int_equal(msg.param_count, 4);
+    assert_slice(msg.params[2], "#chan");
+    // The trailing parameter keeps its inner and outer spaces
+    assert_slice(msg.params[3], "@alice  +bob ");
+
+    // A colon inside a middle parameter does not start the trailing one
+    parse("CAP * LS a:b", &msg);
+    assert_int_equal(msg.param_count, 3);
+    assert_slice(msg.params[2], "a:b");
+    assert_false(msg.has_trailing);
+}
+
+static void test_prefixes(void **state) {
+    (void) state;
+    irc_message_t msg;
+    parse(":irc.example.net 001 me :Welcome", &msg);
+    assert_slice(msg.nick, "irc.example.net");
+    assert_null(msg.user.ptr);
+    assert_null(msg.host.ptr);
+    assert_int_equal(msg.numeric, 1);
+
+    parse(":nick@host NOTICE me :hi", &msg);
+    assert_slice(msg.nick, "nick");
+    assert_null(msg.user.ptr);
+    assert_slice(msg.host, "host");
+
+    parse("PING :token", &msg);
+    assert_int_equal(msg.prefix.len, 0);
+    assert_int_equal(msg.nick.len, 0);
+}
+
+static void test_numerics(void **state) {
+    (void) state;
+    irc_message_t msg;
+    parse("005 me A B :are supported", &msg);
+    assert_int_equal(msg.numeric, 5);
+    parse("1234 x", &msg);
+    assert_int_equal(msg.numeric, -1);
+    parse("12a x", &msg);
+    assert_int_equal(msg.numeric, -1);
+}
+
+static void test_no_command(void **state) {
+    (void) state;
+    irc_message_t msg;
+    assert_int_equal(irc_message_parse("", 0, &msg), -1);
+    assert_int_equal(irc_message_parse(":prefix.only", 12, &msg), -1);
+    assert_int_equal(irc_message_parse("@a=b :prefix ", 13, &msg), -1);
+    assert_int_equal(irc_message_parse("   ", 3, &msg), -1);
+}
+
+static void test_parameter_limit(void **state) {
+    (void) state;
+    irc_message_t msg;
+    parse("CMD 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16", &msg);
+    assert_int_equal(msg.param_count, IRC_MAX_PARAMS);
+    // The last parameter takes the rest of the line
+    assert_slice(msg.params[IRC_MAX_PARAMS - 1], "15 16");
+    assert_false(msg.has_trailing);
+}
+
+static void test_line_is_not_terminated(void **state) {
+    (void) state;
+    // Only len bytes are read, as when the line sits in a receive buffer
+    const char *data = "PRIVMSG #chan :hi\r\nNEXT";
+    irc_message_t msg;
+    assert_int_equal(irc_message_parse(data, 17, &msg), 0);
+    assert_int_equal(msg.param_count, 2);
+    assert_slice(msg.params[1], "hi");
+}
+
+static void test_server_time(void **state) {
+    (void) state;
+    irc_message_t msg;
+    parse("@time=2025-01-31T12:34:56.789Z PING x", &msg);
+    assert_int_equal(irc_message_time_ms(&msg), 1738326896789LL);
+    parse("@time=2025-01-31T12:34:56Z PING x", &msg);
+    assert_int_equal(irc_message_time_ms(&msg), 1738326896000LL);
+    parse("@time=2025-01-31T12:34:56.5Z PING x", &msg);
+    assert_int_equal(irc_message_time_ms(&msg), 1738326896500LL);
+    parse("@time=2025-01-31T12:34:56.123456Z PING x", &msg);
+    assert_int_equal(irc_message_time_ms(&msg), 1738326896123LL);
+    parse("@time=2025-01-31 PING x", &msg);
+    assert_int_equal(irc_message_time_ms(&msg), -1);
+    parse("@time=2025-01-31T12:34:56+01:00 PING x", &msg);
+    assert_int_equal(irc_message_time_ms(&msg), -1);
+    parse("PING x", &msg);
+    assert_int_equal(irc_message_time_ms(&msg), -1);
+}
+
+static void test_slice_helpers(void **state) {
+    (void) state;
+    irc_message_t msg;
+    parse("JOIN #chan", &msg);
+    assert_true(irc_slice_equals(msg.command, "JOIN"));
+    assert_false(irc_slice_equals(msg.command, "JOINS"));
+    assert_int_equal(irc_message_param(&msg, 1).len, 0);
+    assert_null(irc_message_param(&msg, -1).ptr);
+
+    char small[4];
+    assert_string_equal(irc_slice_copy(msg.params[0], small, sizeof(small)), "#ch");
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_full_message),
+        cmocka_unit_test(test_tags),
+        cmocka_unit_test(test_empty_trailing),
+        cmocka_unit_test(test_spacing_and_colons),
+        cmocka_unit_test(test_prefixes),
+        cmocka_unit_test(test_numerics),
+        cmocka_unit_test(test_no_command),
+        cmocka_unit_test(test_parameter_limit),
+        cmocka_unit_test(test_line_is_not_terminated),
+        cmocka_unit_test(test_server_time),
+        cmocka_unit_test(test_slice_helpers),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
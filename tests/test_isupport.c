@@ -0,0 +1,179 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <isupport.h>
+
+/**
+ * @brief Applies one 005 line as a server would send it.
+ */
+static void apply(isupport_t *isupport, const char *line) {
+    irc_message_t msg;
+    assert_int_equal(irc_message_parse(line, strlen(line), &msg), 0);
+    assert_true(isupport_apply(isupport, &msg) > 0);
+}
+
+static void test_defaults(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+    assert_true(isupport_is_channel(&is, "#chan", 5));
+    assert_false(isupport_is_channel(&is, "nick", 4));
+    assert_int_equal(isupport_prefix_rank(&is, '@'), 0);
+    assert_int_equal(isupport_prefix_rank(&is, '+'), 1);
+    assert_int_equal(isupport_prefix_rank(&is, '%'), -1);
+    assert_int_equal(is.casemapping, CASEMAP_RFC1459);
+    assert_int_equal(is.modes, 3);
+}
+
+static void test_typical_reply(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+    apply(&is, ":srv 005 me CHANTYPES=#! PREFIX=(qaohv)~&@%+ STATUSMSG=~&@%+ CHANMODES=beI,k,l,imnst "
+               "CASEMAPPING=ascii MODES=4 :are supported by this server");
+    assert_true(isupport_is_channel(&is, "!chan", 5));
+    assert_false(isupport_is_channel(&is, "&chan", 5));
+    assert_string_equal(is.prefix_modes, "qaohv");
+    assert_string_equal(is.prefix_symbols, "~&@%+");
+    assert_int_equal(isupport_prefix_rank(&is, '%'), 3);
+    assert_string_equal(is.statusmsg, "~&@%+");
+    assert_string_equal(is.chanmodes[3], "imnst");
+    assert_int_equal(is.casemapping, CASEMAP_ASCII);
+    assert_int_equal(is.modes, 4);
+}
+
+static void test_negated_tokens_restore_defaults(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+    apply(&is, ":srv 005 me CHANTYPES=! PREFIX=(qo)~@ MODES=6 MAXTARGETS=4 TARGMAX=JOIN:2 :are supported");
+    apply(&is, ":srv 005 me -CHANTYPES -PREFIX -MODES -MAXTARGETS -TARGMAX :are supported");
+    assert_string_equal(is.chantypes, "#&");
+    assert_string_equal(is.prefix_modes, "ov");
+    assert_string_equal(is.prefix_symbols, "@+");
+    assert_int_equal(is.modes, 3);
+    assert_int_equal(is.maxtargets, 0);
+    assert_int_equal(is.targmax_count, 0);
+    assert_int_equal(isupport_targmax(&is, "JOIN"), 0);
+}
+
+static void test_empty_prefix_clears_ranks(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+    apply(&is, ":srv 005 me PREFIX= :are supported");
+    assert_string_equal(is.prefix_modes, "");
+    assert_string_equal(is.prefix_symbols, "");
+    assert_int_equal(isupport_prefix_rank(&is, '@'), -1);
+    assert_int_equal(isupport_prefix_rank(&is, '\0'), -1);
+}
+
+static void test_malformed_prefix_is_ignored(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+    apply(&is, ":srv 005 me PREFIX=(ohv)@+ :are supported");
+    assert_string_equal(is.prefix_modes, "ov");
+    apply(&is, ":srv 005 me PREFIX=ohv@%+ :are supported");
+    assert_string_equal(is.prefix_symbols, "@+");
+}
+
+static void test_targmax(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+
+    // Before TARGMAX: lists for JOIN, one target for the rest
+    assert_int_equal(isupport_targmax(&is, "JOIN"), 0);
+    assert_int_equal(isupport_targmax(&is, "PRIVMSG"), 1);
+    assert_int_equal(isupport_targmax(&is, "WHO"), 1);
+
+    apply(&is, ":srv 005 me MAXTARGETS=5 :are supported");
+    assert_int_equal(isupport_targmax(&is, "PRIVMSG"), 5);
+    assert_int_equal(isupport_targmax(&is, "NOTICE"), 5);
+    assert_int_equal(isupport_targmax(&is, "WHO"), 1);
+
+    // An empty limit means no limit, also for the last item
+    apply(&is, ":srv 005 me TARGMAX=PRIVMSG:,JOIN:3,WHOIS:1,NOTICE: :are supported");
+    assert_int_equal(is.targmax_count, 4);
+    assert_int_equal(isupport_targmax(&is, "PRIVMSG"), 0);
+    assert_int_equal(isupport_targmax(&is, "privmsg"), 0);
+    assert_int_equal(isupport_targmax(&is, "JOIN"), 3);
+    assert_int_equal(isupport_targmax(&is, "WHOIS"), 1);
+    assert_int_equal(isupport_targmax(&is, "NOTICE"), 0);
+}
+
+static void test_maxlist(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+    assert_int_equal(isupport_maxlist(&is, 'b'), 0);
+
+    apply(&is, ":srv 005 me MAXLIST=bq:100,e:50,I: :are supported");
+    assert_int_equal(isupport_maxlist(&is, 'b'), 100);
+    assert_int_equal(isupport_maxlist(&is, 'q'), 100);
+    assert_int_equal(isupport_maxlist(&is, 'e'), 50);
+    assert_int_equal(isupport_maxlist(&is, 'I'), 0);
+    assert_int_equal(isupport_maxlist(&is, 'x'), 0);
+}
+
+static void test_mode_has_param(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+    apply(&is, ":srv 005 me PREFIX=(ohv)@%+ CHANMODES=beI,k,fl,imnst :are supported");
+    assert_true(isupport_mode_has_param(&is, 'h', true));
+    assert_true(isupport_mode_has_param(&is, 'b', false));
+    assert_true(isupport_mode_has_param(&is, 'k', false));
+    assert_true(isupport_mode_has_param(&is, 'f', true));
+    assert_false(isupport_mode_has_param(&is, 'f', false));
+    assert_false(isupport_mode_has_param(&is, 'm', true));
+    assert_false(isupport_mode_has_param(&is, '\0', true));
+}
+
+static void test_short_chanmodes(void **state) {
+    (void) state;
+    isupport_t is;
+    isupport_init(&is);
+    apply(&is, ":srv 005 me CHANMODES=b,k :are supported");
+    assert_string_equal(is.chanmodes[0], "b");
+    assert_string_equal(is.chanmodes[1], "k");
+    assert_string_equal(is.chanmodes[2], "");
+    assert_string_equal(is.chanmodes[3], "");
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_defaults),
+        cmocka_unit_test(test_typical_reply),
+        cmocka_unit_test(test_negated_tokens_restore_defaults),
+        cmocka_unit_test(test_empty_prefix_clears_ranks),
+        cmocka_unit_test(test_malformed_prefix_is_ignored),
+        cmocka_unit_test(test_targmax),
+        cmocka_unit_test(test_maxlist),
+        cmocka_unit_test(test_mode_has_param),
+        cmocka_unit_test(test_short_chanmodes),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,126 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <lag.h>
+
+static void test_no_samples(void **state) {
+    (void) state;
+    lag_t lag;
+    lag_init(&lag);
+    assert_int_equal(lag_percentile(&lag, 50), -1);
+    assert_int_equal(lag.last_ms, -1);
+}
+
+/**
+ * @brief Below LAG_LINEAR_MS every millisecond has its own bucket.
+ */
+static void test_linear_range_is_exact(void **state) {
+    (void) state;
+    for (long long ms = 0; ms < LAG_LINEAR_MS; ms++) {
+        lag_t lag;
+        lag_init(&lag);
+        lag_record(&lag, ms);
+        lag_record(&lag, 1000);
+        assert_int_equal(lag_percentile(&lag, 50), ms);
+    }
+}
+
+/**
+ * @brief Above the linear range a percentile is the upper bound of its
+ * bucket: never below the sample and at most 12.5% above it.
+ */
+static void test_bucket_bounds(void **state) {
+    (void) state;
+    const long long big = 1LL << 20;
+    for (long long ms = LAG_LINEAR_MS; ms < (1LL << LAG_MAX_OCTAVE); ms += ms / 64 + 1) {
+        lag_t lag;
+        lag_init(&lag);
+        lag_record(&lag, ms);
+        lag_record(&lag, big);
+        long long p50 = lag_percentile(&lag, 50);
+        assert_true(p50 >= ms);
+        assert_true(p50 * 8 <= ms * 9 + 8);
+    }
+
+    // The first buckets past the linear range
+    lag_t lag;
+    lag_init(&lag);
+    lag_record(&lag, 16);
+    lag_record(&lag, big);
+    assert_int_equal(lag_percentile(&lag, 50), 17);
+    lag_init(&lag);
+    lag_record(&lag, 18);
+    lag_record(&lag, big);
+    assert_int_equal(lag_percentile(&lag, 50), 19);
+}
+
+/**
+ * @brief Results never exceed the largest sample, including for samples in
+ * the shared last bucket.
+ */
+static void test_capped_at_max(void **state) {
+    (void) state;
+    lag_t lag;
+    lag_init(&lag);
+    lag_record(&lag, 16);
+    assert_int_equal(lag_percentile(&lag, 100), 16);
+
+    lag_init(&lag);
+    lag_record(&lag, 200000);
+    lag_record(&lag, 300000);
+    assert_int_equal(lag_percentile(&lag, 50), 300000);
+    assert_int_equal(lag.max_ms, 300000);
+    assert_int_equal(lag.last_ms, 300000);
+
+    // Negative round trips (a clock step) land in the first bucket
+    lag_init(&lag);
+    lag_record(&lag, -5);
+    lag_record(&lag, 40);
+    assert_int_equal(lag_percentile(&lag, 50), 0);
+}
+
+static void test_percentile_ranks(void **state) {
+    (void) state;
+    lag_t lag;
+    lag_init(&lag);
+    for (long long ms = 1; ms <= 100; ms++) {
+        lag_record(&lag, ms);
+    }
+    assert_int_equal(lag.samples, 100);
+    assert_int_equal(lag_percentile(&lag, 0), 1);
+    assert_int_equal(lag_percentile(&lag, 10), 10);
+    assert_int_equal(lag_percentile(&lag, 50), 51);
+    assert_int_equal(lag_percentile(&lag, 99), 100);
+    assert_int_equal(lag_percentile(&lag, 100), 100);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_no_samples),
+        cmocka_unit_test(test_linear_range_is_exact),
+        cmocka_unit_test(test_bucket_bounds),
+        cmocka_unit_test(test_capped_at_max),
+        cmocka_unit_test(test_percentile_ranks),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,177 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <linebuf.h>
+
+#define RING_SIZE 64
+#define MAX_LINE 32
+
+static int setup(void **state) {
+    static linebuf_t lb;
+    *state = &lb;
+    return linebuf_init(&lb, RING_SIZE, MAX_LINE);
+}
+
+static int teardown(void **state) {
+    linebuf_free((linebuf_t *)*state);
+    return 0;
+}
+
+/**
+ * Copies data into the ring the way a read loop would, one contiguous
+ * region at a time.
+ */
+static void feed(linebuf_t *lb, const char *data) {
+    size_t len = strlen(data);
+    while (len > 0) {
+        size_t avail;
+        char *dst = linebuf_write_ptr(lb, &avail);
+        assert_true(avail > 0);
+        size_t n = len < avail ? len : avail;
+        memcpy(dst, data, n);
+        linebuf_commit(lb, n);
+        data += n;
+        len -= n;
+    }
+}
+
+static void expect_line(linebuf_t *lb, const char *expected) {
+    size_t len;
+    char *line = linebuf_next_line(lb, &len);
+    assert_non_null(line);
+    assert_int_equal(len, strlen(expected));
+    assert_string_equal(line, expected);
+}
+
+static void expect_none(linebuf_t *lb) {
+    size_t len;
+    assert_null(linebuf_next_line(lb, &len));
+}
+
+static void test_init_checks_sizes(void **state) {
+    (void) state;
+    linebuf_t lb;
+    assert_int_equal(linebuf_init(&lb, 48, 16), -1);
+    assert_int_equal(linebuf_init(&lb, 64, 64), -1);
+    assert_int_equal(linebuf_init(&lb, 0, 0), -1);
+}
+
+static void test_crlf_and_bare_lf(void **state) {
+    linebuf_t *lb = (linebuf_t *)*state;
+    feed(lb, "PING :a\r\nPING :b\n\r\n\n");
+    expect_line(lb, "PING :a");
+    expect_line(lb, "PING :b");
+    // Empty lines are delivered as such; the caller skips them
+    expect_line(lb, "");
+    expect_line(lb, "");
+    expect_none(lb);
+}
+
+static void test_partial_line_waits(void **state) {
+    linebuf_t *lb = (linebuf_t *)*state;
+    feed(lb, "PRIVMSG #c :hel");
+    expect_none(lb);
+    feed(lb, "lo\r");
+    // A CR alone does not end a line
+    expect_none(lb);
+    feed(lb, "\n");
+    expect_line(lb, "PRIVMSG #c :hello");
+}
+
+static void test_line_wraps_around_ring(void **state) {
+    linebuf_t *lb = (linebuf_t *)*state;
+    // Move the read position near the end of the ring
+    feed(lb, "0123456789012345678901234567890\n");   // 32 bytes
+    expect_line(lb, "0123456789012345678901234567890");
+    feed(lb, "abcdefghijklmnopqrstu\n");              // Ends at byte 54
+    expect_line(lb, "abcdefghijklmnopqrstu");
+    // This one starts at byte 54 and continues at the start of the ring
+    feed(lb, "wrapped line here\r\n");
+    expect_line(lb, "wrapped line here");
+    feed(lb, "after\n");
+    expect_line(lb, "after");
+    expect_none(lb);
+}
+
+static void test_terminator_at_ring_end(void **state) {
+    linebuf_t *lb = (linebuf_t *)*state;
+    feed(lb, "0123456789012345678901234567890\n");   // Bytes 0-31
+    expect_line(lb, "0123456789012345678901234567890");
+    feed(lb, "abcdefghi\n");                         // Bytes 32-41
+    expect_line(lb, "abcdefghi");
+    // The text ends at byte 62, so the CR is the last byte of the ring and
+    // the LF the first
+    feed(lb, "abcdefghijklmnopqrstu\r");
+    expect_none(lb);
+    feed(lb, "\n");
+    expect_line(lb, "abcdefghijklmnopqrstu");
+}
+
+static void test_overlong_line_is_dropped(void **state) {
+    linebuf_t *lb = (linebuf_t *)*state;
+    feed(lb, "this line is far longer than the cap\nok\n");
+    expect_line(lb, "ok");
+    assert_int_equal(lb->dropped_lines, 1);
+    // A line of exactly the cap, terminator included, is still accepted
+    feed(lb, "0123456789012345678901234567890\n");
+    expect_line(lb, "0123456789012345678901234567890");
+}
+
+static void test_overlong_line_without_terminator(void **state) {
+    linebuf_t *lb = (linebuf_t *)*state;
+    // More than the cap arrives in several reads before the '\n'
+    feed(lb, "0123456789012345678901234567890123456789");
+    expect_none(lb);
+    feed(lb, "0123456789012345678901234567890123456789");
+    expect_none(lb);
+    feed(lb, "tail\r\nnext\r\n");
+    expect_line(lb, "next");
+    assert_int_equal(lb->dropped_lines, 1);
+}
+
+static void test_full_ring_and_reset(void **state) {
+    linebuf_t *lb = (linebuf_t *)*state;
+    feed(lb, "short\nnot finished");
+    expect_line(lb, "short");
+    linebuf_reset(lb);
+    expect_none(lb);
+    size_t avail;
+    linebuf_write_ptr(lb, &avail);
+    assert_int_equal(avail, RING_SIZE);
+    feed(lb, "fresh\n");
+    expect_line(lb, "fresh");
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_init_checks_sizes),
+        cmocka_unit_test_setup_teardown(test_crlf_and_bare_lf, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_partial_line_waits, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_line_wraps_around_ring, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_terminator_at_ring_end, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_overlong_line_is_dropped, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_overlong_line_without_terminator, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_full_ring_and_reset, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,137 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <linebuf.h>
+#include <linescan.h>
+
+#define SCAN_BUF_SIZE 160
+
+static const char *scanners[] = {"scalar", "memchr", "sse2", "avx2"};
+
+#define SCANNER_COUNT (sizeof(scanners) / sizeof(scanners[0]))
+
+/**
+ * @brief Checks one input against the obvious answer.
+ */
+static void check_find(const char *buf, size_t len) {
+    const char *expected = NULL;
+    for (size_t i = 0; i < len && !expected; i++) {
+        if (buf[i] == '\n') {
+            expected = buf + i;
+        }
+    }
+    assert_ptr_equal(linescan_find_newline(buf, len), expected);
+}
+
+/**
+ * @brief Puts a single '\n' (or none) at every position, at every start
+ * alignment and length, so each vector width sees it in every lane, in the
+ * scalar tail and just past the end of the range.
+ */
+static void test_find_newline_agrees(void **state) {
+    (void) state;
+    char buf[SCAN_BUF_SIZE];
+    int tested = 0;
+    for (size_t s = 0; s < SCANNER_COUNT; s++) {
+        if (linescan_select(scanners[s]) != 0) {
+            print_message("%s unsupported on this CPU, skipped\n", scanners[s]);
+            continue;
+        }
+        tested++;
+        for (size_t offset = 0; offset < 32; offset++) {
+            for (size_t len = 0; offset + len <= 96; len++) {
+                memset(buf, 'x', sizeof(buf));
+                check_find(buf + offset, len);
+                for (size_t pos = 0; pos <= len && offset + pos < sizeof(buf); pos++) {
+                    buf[offset + pos] = '\n';
+                    check_find(buf + offset, len);
+                    buf[offset + pos] = '\r';
+                }
+            }
+        }
+    }
+    assert_true(tested >= 2);
+}
+
+/**
+ * @brief Frames CRLF and bare LF lines through the receive ring with every
+ * scanner, writing the input in pieces split at every byte.
+ */
+static void test_framing_agrees(void **state) {
+    (void) state;
+    static const char input[] =
+        ":a!u@h PRIVMSG #c :one\r\n"
+        "PING :bare-lf\n"
+        "\r\n"
+        ":server 001 me :a line long enough to cross a 32 byte chunk boundary\r\n"
+        "\n"
+        "partial";
+    static const char *expected[] = {
+        ":a!u@h PRIVMSG #c :one", "PING :bare-lf", "", ":server 001 me :a line long enough to cross a 32 byte chunk boundary",
+        "",
+    };
+    size_t input_len = sizeof(input) - 1;
+    int expected_count = (int)(sizeof(expected) / sizeof(expected[0]));
+
+    for (size_t s = 0; s < SCANNER_COUNT; s++) {
+        if (linescan_select(scanners[s]) != 0) {
+            continue;
+        }
+        for (size_t split = 0; split <= input_len; split++) {
+            linebuf_t lb;
+            assert_int_equal(linebuf_init(&lb, 256, 128), 0);
+            int count = 0;
+            size_t pos = 0;
+            size_t pieces[2] = {split, input_len - split};
+            for (int p = 0; p < 2; p++) {
+                size_t avail;
+                char *dest = linebuf_write_ptr(&lb, &avail);
+                assert_true(avail >= pieces[p]);
+                memcpy(dest, input + pos, pieces[p]);
+                linebuf_commit(&lb, pieces[p]);
+                pos += pieces[p];
+
+                char *line;
+                size_t line_len;
+                while ((line = linebuf_next_line(&lb, &line_len)) != NULL) {
+                    assert_true(count < expected_count);
+                    assert_int_equal(line_len, strlen(expected[count]));
+                    assert_string_equal(line, expected[count]);
+                    count++;
+                }
+            }
+            assert_int_equal(count, expected_count);
+            linebuf_free(&lb);
+        }
+    }
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_find_newline_agrees),
+        cmocka_unit_test(test_framing_agrees),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,165 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <members.h>
+
+#define PREFIX_OP 1u     // '@', the first of the "@+" prefix symbols
+#define PREFIX_VOICE 2u  // '+'
+
+typedef struct {
+    intern_pool_t pool;
+    members_t members;
+    member_channel_t *channel;
+} fixture_t;
+
+static int setup(void **state) {
+    static fixture_t fixture;
+    intern_init(&fixture.pool, CASEMAP_RFC1459);
+    members_init(&fixture.members, &fixture.pool);
+    fixture.channel = members_add_channel(&fixture.members, "#chan", 5);
+    *state = &fixture;
+    return fixture.channel ? 0 : -1;
+}
+
+static int teardown(void **state) {
+    fixture_t *fixture = (fixture_t *)*state;
+    members_clear(&fixture->members);
+    // Every name is released once nothing refers to it
+    int live = fixture->pool.live;
+    intern_clear(&fixture->pool);
+    return live == 0 ? 0 : -1;
+}
+
+static member_user_t* find(fixture_t *fixture, const char *nick) {
+    return members_find_user(&fixture->members, nick, strlen(nick));
+}
+
+static void stage(fixture_t *fixture, const char *names, int expected) {
+    assert_int_equal(members_stage_names(&fixture->members, fixture->channel, names, strlen(names), "@+"), expected);
+}
+
+static void test_names_are_staged_until_commit(void **state) {
+    fixture_t *fixture = (fixture_t *)*state;
+    stage(fixture, "@alice +bob carol", 3);
+    assert_true(fixture->channel->staging);
+    assert_int_equal(fixture->channel->members.count, 0);
+
+    members_commit(&fixture->members, fixture->channel);
+    assert_false(fixture->channel->staging);
+    assert_true(fixture->channel->synced);
+    assert_int_equal(fixture->channel->members.count, 3);
+    assert_int_equal(members_prefixes(fixture->channel, find(fixture, "alice")), PREFIX_OP);
+    assert_int_equal(members_prefixes(fixture->channel, find(fixture, "BOB")), PREFIX_VOICE);
+    assert_int_equal(members_prefixes(fixture->channel, find(fixture, "carol")), 0);
+}
+
+static void test_multi_prefix_and_userhost(void **state) {
+    fixture_t *fixture = (fixture_t *)*state;
+    stage(fixture, "@+alice!a@example.org +bob!b@host", 2);
+    members_commit(&fixture->members, fixture->channel);
+
+    member_user_t *alice = find(fixture, "Alice");
+    assert_non_null(alice);
+    assert_int_equal(members_prefixes(fixture->channel, alice), PREFIX_OP | PREFIX_VOICE);
+    assert_string_equal(members_nick(&fixture->members, alice), "alice");
+    assert_string_equal(intern_str(&fixture->pool, alice->userhost), "a@example.org");
+    assert_string_equal(intern_str(&fixture->pool, find(fixture, "bob")->userhost), "b@host");
+}
+
+static void test_names_span_several_replies(void **state) {
+    fixture_t *fixture = (fixture_t *)*state;
+    // More names than one lookup batch, split over two 353 lines
+    char names[2][4096];
+    size_t len[2] = {0, 0};
+    for (int i = 0; i < 300; i++) {
+        len[i % 2] += (size_t)snprintf(names[i % 2] + len[i % 2], sizeof(names[0]) - len[i % 2], "%snick%d",
+                                       len[i % 2] ? " " : "", i);
+    }
+    stage(fixture, names[0], 150);
+    stage(fixture, names[1], 150);
+    members_commit(&fixture->members, fixture->channel);
+    assert_int_equal(fixture->channel->members.count, 300);
+    assert_int_equal(fixture->members.user_count, 300);
+    assert_non_null(find(fixture, "NICK299"));
+}
+
+static void test_relist_drops_missed_departures(void **state) {
+    fixture_t *fixture = (fixture_t *)*state;
+    stage(fixture, "@alice bob carol", 3);
+    members_commit(&fixture->members, fixture->channel);
+    member_user_t *alice = find(fixture, "alice");
+
+    // bob left without us seeing it; alice lost op
+    stage(fixture, "alice carol dave", 3);
+    members_commit(&fixture->members, fixture->channel);
+    assert_int_equal(fixture->channel->members.count, 3);
+    assert_null(find(fixture, "bob"));
+    assert_ptr_equal(find(fixture, "alice"), alice);
+    assert_int_equal(members_prefixes(fixture->channel, alice), 0);
+    assert_int_equal(alice->channel_count, 1);
+}
+
+static void test_changes_while_staging(void **state) {
+    fixture_t *fixture = (fixture_t *)*state;
+    stage(fixture, "alice bob", 2);
+    // A JOIN during the listing belongs in the new list; a PART does not
+    members_join(&fixture->members, fixture->channel, "erin", 4);
+    members_part(&fixture->members, fixture->channel, find(fixture, "bob"));
+    assert_null(find(fixture, "bob"));
+
+    members_commit(&fixture->members, fixture->channel);
+    assert_int_equal(fixture->channel->members.count, 2);
+    assert_non_null(find(fixture, "erin"));
+    assert_true(members_contains(fixture->channel, find(fixture, "alice")));
+}
+
+static void test_empty_and_prefix_only_names(void **state) {
+    fixture_t *fixture = (fixture_t *)*state;
+    // Doubled spaces and a lone symbol are skipped, not staged as names
+    stage(fixture, "  @ alice  ", 1);
+    members_commit(&fixture->members, fixture->channel);
+    assert_int_equal(fixture->channel->members.count, 1);
+}
+
+static void test_commit_without_names(void **state) {
+    fixture_t *fixture = (fixture_t *)*state;
+    members_join(&fixture->members, fixture->channel, "alice", 5);
+    // A 366 with no 353 before it changes nothing
+    members_commit(&fixture->members, fixture->channel);
+    assert_int_equal(fixture->channel->members.count, 1);
+    assert_false(fixture->channel->synced);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_names_are_staged_until_commit, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_multi_prefix_and_userhost, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_names_span_several_replies, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_relist_drops_missed_departures, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_changes_while_staging, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_empty_and_prefix_only_names, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_commit_without_names, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
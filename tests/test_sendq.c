@@ -0,0 +1,211 @@
+/*
+ * chatter - A simple IRC client written in C.
+ * Copyright (C) 2025 Doug Miller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <cmocka.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <sendq.h>
+
+#define LINE_COUNT 500
+
+/**
+ * @brief Queues LINE_COUNT numbered lines and keeps a copy of what was queued.
+ * @return The number of bytes queued.
+ */
+static size_t push_lines(sendq_t *q, char *copy) {
+    size_t total = 0;
+    for (int i = 0; i < LINE_COUNT; i++) {
+        char line[128];
+        int len = snprintf(line, sizeof(line), "PRIVMSG #c :line %d of a backlog long enough to fill a buffer\r\n", i);
+        assert_int_equal(sendq_push(q, line, (size_t)len), 0);
+        memcpy(copy + total, line, (size_t)len);
+        total += (size_t)len;
+    }
+    return total;
+}
+
+static int lines_in(const char *data, size_t len) {
+    int lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        lines += data[i] == '\n';
+    }
+    return lines;
+}
+
+/**
+ * @brief A socket that fills up leaves the rest queued, resuming exactly
+ * where the short write stopped.
+ */
+static void test_plain_short_writes(void **state) {
+    (void) state;
+    static char sent[LINE_COUNT * 128];
+    static char received[LINE_COUNT * 128];
+    int fds[2];
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int small = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    sendq_t q;
+    sendq_init(&q);
+    assert_true(sendq_empty(&q));
+    size_t total = push_lines(&q, sent);
+    assert_int_equal(sendq_depth(&q), LINE_COUNT);
+
+    size_t got = 0;
+    int writes = 0;
+    int result;
+    bool went_short = false;
+    while ((result = sendq_flush(&q, fds[0], NULL, &writes)) == SENDQ_PENDING) {
+        went_short = true;
+        // Every line not fully written is still counted
+        size_t written = total - q.bytes;
+        assert_int_equal(sendq_depth(&q), LINE_COUNT - lines_in(sent, written));
+        ssize_t n;
+        while ((n = read(fds[1], received + got, sizeof(received) - got)) > 0) {
+            got += (size_t)n;
+        }
+    }
+    assert_int_equal(result, 0);
+    assert_true(went_short);
+    assert_true(sendq_empty(&q));
+    assert_int_equal(sendq_depth(&q), 0);
+
+    ssize_t n;
+    while ((n = read(fds[1], received + got, sizeof(received) - got)) > 0) {
+        got += (size_t)n;
+    }
+    assert_int_equal(got, total);
+    assert_memory_equal(received, sent, total);
+    // One sendmsg() carries up to SENDQ_MAX_IOV lines
+    assert_true(writes < LINE_COUNT);
+
+    sendq_clear(&q);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/**
+ * @brief Makes a throwaway self-signed certificate for the server end.
+ */
+static SSL_CTX *server_ctx_new(void) {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    assert_non_null(key);
+    assert_non_null(cert);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC, (const unsigned char *)"test", -1,
+                               -1, 0);
+    X509_set_issuer_name(cert, X509_get_subject_name(cert));
+    assert_true(X509_sign(cert, key, EVP_sha256()) > 0);
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    assert_non_null(ctx);
+    assert_int_equal(SSL_CTX_use_certificate(ctx, cert), 1);
+    assert_int_equal(SSL_CTX_use_PrivateKey(ctx, key), 1);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ctx;
+}
+
+static void read_all(SSL *ssl, char *buf, size_t size, size_t *got) {
+    int n;
+    while ((n = SSL_read(ssl, buf + *got, (int)(size - *got))) > 0) {
+        *got += (size_t)n;
+    }
+}
+
+/**
+ * @brief Lines moved into the TLS staging buffer still count towards the
+ * depth until SSL_write() takes them, and arrive intact and in order.
+ */
+static void test_tls_staging(void **state) {
+    (void) state;
+    static char sent[LINE_COUNT * 128];
+    static char received[LINE_COUNT * 128];
+    SSL_CTX *server_ctx = server_ctx_new();
+    SSL_CTX *client_ctx = SSL_CTX_new(TLS_client_method());
+    assert_non_null(client_ctx);
+    // As tls.c sets up client connections
+    SSL_CTX_set_mode(client_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+    SSL *server = SSL_new(server_ctx);
+    SSL *client = SSL_new(client_ctx);
+    BIO *client_bio;
+    BIO *server_bio;
+    // Smaller than one record, so SSL_write() has to wait for the reader
+    assert_int_equal(BIO_new_bio_pair(&client_bio, 4096, &server_bio, 4096), 1);
+    SSL_set_bio(client, client_bio, client_bio);
+    SSL_set_bio(server, server_bio, server_bio);
+    SSL_set_connect_state(client);
+    SSL_set_accept_state(server);
+    for (int i = 0; i < 100 && !(SSL_is_init_finished(client) && SSL_is_init_finished(server)); i++) {
+        SSL_do_handshake(client);
+        SSL_do_handshake(server);
+    }
+    assert_true(SSL_is_init_finished(client));
+    size_t got = 0;
+    read_all(server, received, sizeof(received), &got);
+    assert_int_equal(got, 0);
+
+    sendq_t q;
+    sendq_init(&q);
+    size_t total = push_lines(&q, sent);
+    assert_int_equal(sendq_flush(&q, -1, client, NULL), SENDQ_PENDING);
+    assert_true(q.staged_lines > 0);
+    assert_int_equal(sendq_depth(&q), LINE_COUNT - lines_in(sent, total - q.bytes));
+
+    int result;
+    while ((result = sendq_flush(&q, -1, client, NULL)) == SENDQ_PENDING) {
+        assert_int_equal(sendq_depth(&q), LINE_COUNT - lines_in(sent, total - q.bytes));
+        read_all(server, received, sizeof(received), &got);
+    }
+    assert_int_equal(result, 0);
+    assert_int_equal(sendq_depth(&q), 0);
+    assert_int_equal(q.staged_lines, 0);
+    read_all(server, received, sizeof(received), &got);
+    assert_int_equal(got, total);
+    assert_memory_equal(received, sent, total);
+
+    sendq_clear(&q);
+    SSL_free(client);
+    SSL_free(server);
+    SSL_CTX_free(client_ctx);
+    SSL_CTX_free(server_ctx);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_plain_short_writes),
+        cmocka_unit_test(test_tls_staging),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}